@@ -0,0 +1,82 @@
+#pragma once
+
+#include "archive.h"
+
+// Maps a packed archive, see archive.h. Returns NULL when the file is
+// missing or not an archive of this version
+archive *A_OpenArchive(char *Filename)
+{
+    Assert(Filename);
+
+    archive *Result = (archive*)Malloc(sizeof(archive)); Assert(Result);
+    if(!P_MapFile(&Result->File, Filename))
+    {
+        Free(Result);
+        return NULL;
+    }
+
+    archive_header *Header = (archive_header*)Result->File.Data;
+    if(Result->File.Size < sizeof(archive_header) ||
+       Header->Magic != ARCHIVE_MAGIC ||
+       Header->Version != ARCHIVE_VERSION ||
+       Header->EntryOffset > Result->File.Size ||
+       Header->EntryCount > (Result->File.Size - Header->EntryOffset) / sizeof(archive_entry))
+    {
+        printf("%s is not a version %d asset archive\n", Filename, ARCHIVE_VERSION);
+        P_UnmapFile(&Result->File);
+        Free(Result);
+        return NULL;
+    }
+
+    Result->Header = Header;
+    Result->Entries = (archive_entry*)(Result->File.Data + Header->EntryOffset);
+    return (Result);
+}
+
+void A_CloseArchive(archive *Archive)
+{
+    Assert(Archive);
+
+    P_UnmapFile(&Archive->File);
+    Free(Archive);
+}
+
+// Binary search, the entries are sorted by name
+asset_handle A_FindAsset(archive *Archive, char *Name)
+{
+    Assert(Archive);
+    Assert(Name);
+
+    asset_handle Result = {};
+    u32 Low = 0;
+    u32 High = Archive->Header->EntryCount;
+    while(Low < High)
+    {
+        u32 Middle = Low + (High - Low) / 2;
+        i32 Compare = strncmp(Name, Archive->Entries[Middle].Name, ARCHIVE_MAX_NAME);
+        if(Compare == 0)
+        {
+            archive_entry *Entry = &Archive->Entries[Middle];
+            if(Entry->Offset > Archive->File.Size || Entry->Size > Archive->File.Size - Entry->Offset)
+            {
+                printf("%s is past the end of the asset archive\n", Name);
+                return (Result);
+            }
+
+            Result.Entry = Entry;
+            Result.Data = Archive->File.Data + Entry->Offset;
+            return (Result);
+        }
+        else if(Compare < 0)
+        {
+            High = Middle;
+        }
+        else
+        {
+            Low = Middle + 1;
+        }
+    }
+
+    printf("%s is not in the asset archive\n", Name);
+    return (Result);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "shared.h"
+
+/*
+  Packed asset archive, written by pack.cpp and mapped by A_OpenArchive,
+  all values little endian
+
+    archive_header
+    Asset data       Every asset ARCHIVE_ALIGNMENT aligned
+    Entry table      EntryCount archive_entry, sorted by name
+
+  Assets are stored in the layout the runtime hands to GL and
+  SDL_mixer, so they are used straight from the mapping:
+
+    Texture  Decoded, flipped vertically, 8 bits per channel, rows
+             tightly packed. Every mip level down to 1x1 follows the
+             one before, filtered in linear space
+    Font     The TrueType file as is, FreeType reads it from memory
+    Sound    Signed 16 bit stereo samples at 44100 Hz, the format the
+             mixer asks for, see S_CreateSoundSystem. Devices that
+             open with another one get them converted at load, see
+             S_CreateSoundEffect
+    Shader   The glsl source without comments, lines kept so compile
+             errors point at the right line, NUL terminated
+    Glyphs   Distance field glyphs of a font rasterized ahead of time,
+             stored under the font name plus ".sdf". An
+             archive_glyph_set, GlyphCount archive_glyph and then
+             GlyphCount cells of CellWidth x CellHeight pixels, see
+             R_LoadGlyphSet
+*/
+
+#define ARCHIVE_MAGIC 0x4B415047 // "GPAK"
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_ALIGNMENT 64
+#define ARCHIVE_MAX_NAME 64
+#define ARCHIVE_SOUND_FREQUENCY 44100
+#define ARCHIVE_SOUND_CHANNELS 2
+
+enum archive_entry_type
+{
+    ArchiveEntry_Texture,
+    ArchiveEntry_Font,
+    ArchiveEntry_Sound,
+    ArchiveEntry_Shader,
+    ArchiveEntry_Glyphs,
+};
+
+struct archive_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 EntryCount;
+    u32 Reserved;
+    u64 EntryOffset; // Of the entry table
+};
+
+struct archive_entry
+{
+    char Name[ARCHIVE_MAX_NAME]; // Path the asset was packed from, relative to build/
+    u32 Type; // archive_entry_type
+    u32 Reserved;
+    u64 Offset;
+    u64 Size;
+
+    // ArchiveEntry_Texture
+    i32 Width;
+    i32 Height;
+    i32 ChannelCount;
+    i32 MipCount;
+};
+
+// An asset inside a mapped archive, see A_FindAsset
+struct asset_handle
+{
+    archive_entry *Entry; // NULL when the asset is not in the archive
+    u8 *Data; // Entry->Size bytes inside the mapping
+};
+
+// Rasterized with the settings of glyph.cpp, fonts made with other
+// settings ignore the set and rasterize on demand
+struct archive_glyph_set
+{
+    i32 GlyphSize;
+    i32 Spread;
+    i32 Oversample;
+    i32 CellWidth;
+    i32 CellHeight;
+    u32 GlyphCount;
+};
+
+struct archive_glyph
+{
+    u32 Codepoint;
+    u32 Advance;
+    i32 Width;
+    i32 Height;
+    i32 BearingX;
+    i32 BearingY;
+};
+
+// The pack tool has no platform layer
+#ifndef GLOW_HEADLESS
+#include "platform.h"
+
+// A packed archive mapped into memory, assets are found by the path
+// they were packed from with A_FindAsset
+struct archive
+{
+    mapped_file File;
+    archive_header *Header;
+    archive_entry *Entries;
+};
+#endif
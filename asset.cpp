@@ -0,0 +1,241 @@
+#pragma once
+
+#include "asset.h"
+
+asset_loader *A_CreateAssetLoader()
+{
+    asset_loader *Result = (asset_loader*)Malloc(sizeof(asset_loader));
+    Assert(Result);
+
+    // Every image is flipped, stb_image keeps the setting in a global
+    // so it is set once here and not from the workers
+    i32 FlipVertically = 1;
+    stbi_set_flip_vertically_on_load(FlipVertically);
+
+    return (Result);
+}
+
+// *Texture is set once the texture is uploaded, like R_CreateTexture
+// it has no GL texture when the file can not be read or is not RGB or
+// RGBA
+void A_LoadTexture(asset_loader *Loader, texture **Texture, char *Filename)
+{
+    Assert(Loader);
+    Assert(Loader->JobCount < ASSET_MAX_JOBS);
+    Assert(Texture);
+    Assert(Filename);
+
+    *Texture = NULL;
+    asset_job *Job = &Loader->Jobs[Loader->JobCount++];
+    Job->Type = Asset_Texture;
+    Job->Filename = Filename;
+    Job->Texture = Texture;
+
+    // Only the header is read here, the size of the pixel buffer is
+    // needed before the worker decodes into it
+    if(!stbi_info(Filename, &Job->Width, &Job->Height, &Job->ChannelCount))
+    {
+        printf("Could not load image file: %s\n", Filename);
+        Job->Failed = true;
+        return;
+    }
+    if(Job->ChannelCount != 3 && Job->ChannelCount != 4)
+    {
+        fprintf(stderr, "%s Texture format is not GL_RGB or GL_RGBA\n", Filename);
+        Job->Failed = true;
+        return;
+    }
+
+    i32 Size = (i32)R_MipChainSize(Job->Width, Job->Height, Job->ChannelCount, &Job->MipCount);
+    glGenBuffers(1, &Job->PixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Job->PixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, Size, NULL, GL_STREAM_DRAW);
+    Job->Pixels = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if(!Job->Pixels)
+    {
+        printf("Could not map the pixel buffer of %s\n", Filename);
+        Job->Failed = true;
+    }
+}
+
+// *SoundEffect is set once the sound is decoded
+void A_LoadSoundEffect(asset_loader *Loader, sound_effect **SoundEffect, char *Filename)
+{
+    Assert(Loader);
+    Assert(Loader->JobCount < ASSET_MAX_JOBS);
+    Assert(SoundEffect);
+    Assert(Filename);
+
+    *SoundEffect = NULL;
+    asset_job *Job = &Loader->Jobs[Loader->JobCount++];
+    Job->Type = Asset_SoundEffect;
+    Job->Filename = Filename;
+    Job->SoundEffect = SoundEffect;
+}
+
+void A_RunJob(asset_job *Job)
+{
+    switch(Job->Type)
+    {
+        case Asset_Texture:
+        {
+            i32 Width, Height, ChannelCount;
+            u8 *Data = stbi_load(Job->Filename, &Width, &Height, &ChannelCount, Job->ChannelCount);
+            if(Data && Width == Job->Width && Height == Job->Height)
+            {
+                // The chain is built in memory of our own, the mapping is
+                // write only and reading levels back from it is slow
+                i32 MipCount;
+                u64 Size = R_MipChainSize(Width, Height, Job->ChannelCount, &MipCount);
+                u8 *Chain = (u8*)Malloc(Size);
+                memcpy(Chain, Data, (u64)Width * Height * Job->ChannelCount);
+                R_BuildMipChain(Chain, Width, Height, Job->ChannelCount, MipCount);
+                memcpy(Job->Pixels, Chain, Size);
+                Free(Chain);
+            }
+            else
+            {
+                printf("Could not load image file: %s\n", Job->Filename);
+                Job->Failed = true;
+            }
+            stbi_image_free(Data);
+            break;
+        }
+        case Asset_SoundEffect:
+        {
+            // Decoding and converting to the device format does not
+            // touch the mixer channels, it is safe off the main thread
+            Job->DecodedSound = S_CreateSoundEffect(Job->Filename);
+            break;
+        }
+        default:
+        {
+            InvalidCodePath;
+            break;
+        }
+    }
+}
+
+// Runs the next job nobody took yet, returns false when there is none
+b32 A_RunNextJob(asset_loader *Loader)
+{
+    u32 Index = (u32)SDL_AtomicAdd(&Loader->NextJob, 1);
+    if(Index >= Loader->JobCount)
+    {
+        return false;
+    }
+
+    asset_job *Job = &Loader->Jobs[Index];
+    if(!Job->Failed)
+    {
+        A_RunJob(Job);
+    }
+    SDL_AtomicSet(&Job->Done, 1);
+    return true;
+}
+
+int SDLCALL A_WorkerThread(void *Data)
+{
+    asset_loader *Loader = (asset_loader*)Data;
+    while(A_RunNextJob(Loader))
+    {
+    }
+
+    return 0;
+}
+
+// No more jobs can be queued after this
+void A_StartLoading(asset_loader *Loader)
+{
+    Assert(Loader);
+
+    // The main thread keeps a core to upload and draw
+    i32 CPUCount = SDL_GetCPUCount();
+    u32 WorkerCount = (CPUCount > 1) ? CPUCount - 1 : 0;
+    if(WorkerCount > ASSET_MAX_WORKERS)
+    {
+        WorkerCount = ASSET_MAX_WORKERS;
+    }
+    if(WorkerCount > Loader->JobCount)
+    {
+        WorkerCount = Loader->JobCount;
+    }
+
+    for(u32 i = 0; i < WorkerCount; i++)
+    {
+        SDL_Thread *Worker = SDL_CreateThread(A_WorkerThread, "AssetWorker", Loader);
+        if(!Worker)
+        {
+            printf("SDL_CreateThread failed: %s\n", SDL_GetError());
+            break;
+        }
+        Loader->Workers[Loader->WorkerCount++] = Worker;
+    }
+}
+
+// Uploads and stores the assets the workers are done with, returns
+// true once every asset is finished
+b32 A_UpdateLoading(asset_loader *Loader)
+{
+    Assert(Loader);
+
+    // Without workers the main thread decodes one asset per update, so
+    // the loading frame is still drawn between them
+    if(Loader->WorkerCount == 0)
+    {
+        A_RunNextJob(Loader);
+    }
+
+    for(u32 i = 0; i < Loader->JobCount; i++)
+    {
+        asset_job *Job = &Loader->Jobs[i];
+        if(Job->Finished || !SDL_AtomicGet(&Job->Done))
+        {
+            continue;
+        }
+
+        if(Job->Type == Asset_Texture)
+        {
+            texture *Texture = (texture*)Malloc(sizeof(texture));
+            if(Job->PixelBuffer)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Job->PixelBuffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                if(!Job->Failed)
+                {
+                    Texture->Width = Job->Width;
+                    Texture->Height = Job->Height;
+                    Texture->ChannelCount = Job->ChannelCount;
+                    R_SetTextureFormat(Texture, Job->Filename);
+                    R_UploadTexture(Texture, (u8*)0, Job->MipCount);
+                }
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                // The driver keeps the buffer alive until the upload is done
+                glDeleteBuffers(1, &Job->PixelBuffer);
+            }
+            *Job->Texture = Texture;
+        }
+        else if(Job->Type == Asset_SoundEffect)
+        {
+            *Job->SoundEffect = Job->DecodedSound;
+        }
+
+        Job->Finished = true;
+        Loader->JobsFinished++;
+    }
+
+    return (Loader->JobsFinished == Loader->JobCount);
+}
+
+// Waits for the workers to exit, call after A_UpdateLoading returned true
+void A_DestroyAssetLoader(asset_loader *Loader)
+{
+    Assert(Loader);
+
+    for(u32 i = 0; i < Loader->WorkerCount; i++)
+    {
+        SDL_WaitThread(Loader->Workers[i], NULL);
+    }
+    Free(Loader);
+}
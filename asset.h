@@ -0,0 +1,62 @@
+#pragma once
+
+#include "shared.h"
+#include "renderer.h"
+#include "sound.h"
+#include "archive.h"
+
+/*
+  Startup asset loading. Textures and sound effects are queued with
+  A_LoadTexture and A_LoadSoundEffect, A_StartLoading hands them to a
+  pool of worker threads that read and decode the files, and the main
+  thread calls A_UpdateLoading every frame until everything is done.
+
+  Every texture gets a pixel buffer object mapped by the main thread
+  when it is queued. The worker decodes the image, builds its mip
+  chain and copies the whole chain into the mapping, the main thread
+  only unmaps it and starts the upload of every level, the driver
+  copies the pixels to the texture without blocking the main thread.
+*/
+
+#define ASSET_MAX_JOBS 32
+#define ASSET_MAX_WORKERS 8
+
+enum asset_type
+{
+    Asset_Texture,
+    Asset_SoundEffect,
+};
+
+struct asset_job
+{
+    u32 Type; // asset_type
+    char *Filename;
+
+    // Asset_Texture
+    texture **Texture;
+    u32 PixelBuffer;
+    u8 *Pixels; // Mapped PixelBuffer, written by the worker
+    i32 MipCount;
+    i32 Width;
+    i32 Height;
+    i32 ChannelCount;
+
+    // Asset_SoundEffect
+    sound_effect **SoundEffect;
+    sound_effect *DecodedSound;
+
+    SDL_atomic_t Done; // Set by the worker
+    b32 Failed;
+    b32 Finished; // Uploaded/stored by the main thread
+};
+
+struct asset_loader
+{
+    asset_job Jobs[ASSET_MAX_JOBS];
+    u32 JobCount;
+    u32 JobsFinished;
+    SDL_atomic_t NextJob;
+
+    SDL_Thread *Workers[ASSET_MAX_WORKERS];
+    u32 WorkerCount;
+};
@@ -20,7 +20,25 @@ REM set CompilerFlags= -DDEBUG -nologo -W4 -WX -Ot -FS %IncludeDirectories% -Zi
 set CompilerFlags= -nologo -W4 -Ot -FS %IncludeDirectories% -Zi -EHsc -MD /D "_WINDOWS"
 set LinkerFlags=-nologo -DEBUG %LibDirectories%
 
+REM build.bat headless builds the simulation only, no SDL, GL or SDL_mixer, see headless.cpp
+if "%1"=="headless" goto headless
+REM build.bat pack builds only the asset cooker, see pack.cpp
+if "%1"=="pack" goto pack
+
 REM cl ..\main.cpp %CompilerFlags% /link %LinkerFlags% -SUBSYSTEM:CONSOLE SDL2.lib SDL2main.lib SDL2_mixer.lib freetype.lib
 cl ..\main.cpp %CompilerFlags% /link %LinkerFlags% -SUBSYSTEM:WINDOWS SDL2.lib SDL2main.lib SDL2_mixer.lib freetype.lib
 
+REM The asset cooker is built with the game
+goto pack
+
+:headless
+cl ..\headless.cpp -nologo -W4 -O2 -FS -I%GLM% -Zi -EHsc -MD /link -nologo -SUBSYSTEM:CONSOLE
+goto end
+
+:pack
+cl ..\pack.cpp -nologo -W4 -O2 -FS -I%GLM% -I%FREETYPEINCLUDE% -Zi -EHsc -MD /link -nologo -LIBPATH:%FREETYPELIB% -SUBSYSTEM:CONSOLE freetype.lib
+goto end
+
+:end
+
 popd
@@ -16,6 +16,18 @@ WARNING_DISABLES="-Wno-writable-strings -Wno-char-subscripts -Wno-unused-value"
 
 echo "------ Compiling ------"
 
-$COMPILER ../main.cpp $INCLUDE_DIRECTORIES $COMPILER_FLAGS $WARNING_DISABLES $LINKER_FLAGS -o Untitled
+# ./build.sh headless builds the simulation only, no SDL, GL or
+# SDL_mixer, see headless.cpp
+if [ "$1" == "headless" ]; then
+    HEADLESS_INCLUDE_DIRECTORIES="-I../external/glm-0.9.9.6/glm-0.9.9.6"
+    $COMPILER ../headless.cpp $HEADLESS_INCLUDE_DIRECTORIES -std=c++17 -O2 -g -Wall $WARNING_DISABLES -o Headless
+else
+    # ./build.sh pack builds only the asset cooker, see pack.cpp
+    if [ "$1" != "pack" ]; then
+        $COMPILER ../main.cpp $INCLUDE_DIRECTORIES $COMPILER_FLAGS $WARNING_DISABLES $LINKER_FLAGS -o Untitled
+    fi
+    PACK_INCLUDE_DIRECTORIES="-I../external/glm-0.9.9.6/glm-0.9.9.6 -I/usr/local/opt/freetype/include/freetype2"
+    $COMPILER ../pack.cpp $PACK_INCLUDE_DIRECTORIES -std=c++17 -O2 -g -Wall $WARNING_DISABLES -lfreetype -o Pack
+fi
 
 popd > /dev/null
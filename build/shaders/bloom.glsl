@@ -1,3 +1,6 @@
+// Tonemaps the HDR scene, with BLOOM the blurred bright pixels are
+// added first
+#pragma keywords BLOOM
 #ifdef VERTEX_SHADER
 
 layout (location = 0) in vec3 Position;
@@ -17,20 +20,21 @@ out vec4 FragmentColor;
 in vec2 TexCoords;
 
 uniform sampler2D Scene;
+#ifdef BLOOM
 uniform sampler2D BloomBlur;
-uniform bool Bloom;
+uniform float BloomStrength;
+#endif
 uniform float Exposure;
 
 void main()
 {
     const float Gamma = 2.2;
     vec3 HDRColor = texture(Scene, TexCoords).rgb;
-    vec3 BloomColor = texture(BloomBlur, TexCoords).rgb;
 
-    if(Bloom)
-    {
-        HDRColor += BloomColor; // additive blending
-    }
+#ifdef BLOOM
+    vec3 BloomColor = texture(BloomBlur, TexCoords).rgb;
+    HDRColor += BloomColor * BloomStrength; // additive blending
+#endif
 
     // tone mapping
     vec3 Result = vec3(1.0) - exp(-HDRColor * Exposure);
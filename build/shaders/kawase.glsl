@@ -0,0 +1,72 @@
+// Dual filter (Kawase) bloom, one file for the three passes over the
+// bloom mip chain. THRESHOLD extracts the bright pixels of the scene
+// into the first mip at half resolution, DOWNSAMPLE blurs a mip into
+// the next smaller one, UPSAMPLE blurs a mip back into the one above
+// it, where it is added to what the downsample left there
+#pragma keywords THRESHOLD DOWNSAMPLE UPSAMPLE
+#ifdef VERTEX_SHADER
+
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec2 UV;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = UV;
+    gl_Position = vec4(Position, 1.0);
+}
+#endif
+
+#ifdef FRAGMENT_SHADER
+
+layout (location = 0) out vec4 FragmentColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D Image;
+
+#ifdef THRESHOLD
+uniform float BrightnessThreshold;
+
+vec3 Bright(ivec2 Texel)
+{
+    vec3 Color = texelFetch(Image, Texel, 0).rgb;
+    float Brightness = dot(Color, vec3(0.2126, 0.7152, 0.0722));
+    return Brightness > BrightnessThreshold ? Color : vec3(0.0);
+}
+#else
+uniform vec2 HalfPixel; // Half a texel of the mip written to
+#endif
+
+void main()
+{
+#if defined(THRESHOLD)
+    // Every pixel is thresholded before the 2x2 average, like the old
+    // full resolution bright pass followed by a downsample
+    ivec2 Texel = ivec2(gl_FragCoord.xy) * 2;
+    vec3 Sum = Bright(Texel);
+    Sum += Bright(Texel + ivec2(1, 0));
+    Sum += Bright(Texel + ivec2(0, 1));
+    Sum += Bright(Texel + ivec2(1, 1));
+    FragmentColor = vec4(Sum * 0.25, 1.0);
+#elif defined(DOWNSAMPLE)
+    vec3 Sum = texture(Image, TexCoords).rgb * 4.0;
+    Sum += texture(Image, TexCoords - HalfPixel).rgb;
+    Sum += texture(Image, TexCoords + HalfPixel).rgb;
+    Sum += texture(Image, TexCoords + vec2(HalfPixel.x, -HalfPixel.y)).rgb;
+    Sum += texture(Image, TexCoords - vec2(HalfPixel.x, -HalfPixel.y)).rgb;
+    FragmentColor = vec4(Sum / 8.0, 1.0);
+#elif defined(UPSAMPLE)
+    vec3 Sum = texture(Image, TexCoords + vec2(-HalfPixel.x * 2.0, 0.0)).rgb;
+    Sum += texture(Image, TexCoords + vec2(-HalfPixel.x, HalfPixel.y)).rgb * 2.0;
+    Sum += texture(Image, TexCoords + vec2(0.0, HalfPixel.y * 2.0)).rgb;
+    Sum += texture(Image, TexCoords + vec2(HalfPixel.x, HalfPixel.y)).rgb * 2.0;
+    Sum += texture(Image, TexCoords + vec2(HalfPixel.x * 2.0, 0.0)).rgb;
+    Sum += texture(Image, TexCoords + vec2(HalfPixel.x, -HalfPixel.y)).rgb * 2.0;
+    Sum += texture(Image, TexCoords + vec2(0.0, -HalfPixel.y * 2.0)).rgb;
+    Sum += texture(Image, TexCoords + vec2(-HalfPixel.x, -HalfPixel.y)).rgb * 2.0;
+    FragmentColor = vec4(Sum / 12.0, 1.0);
+#endif
+}
+#endif
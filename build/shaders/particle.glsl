@@ -0,0 +1,46 @@
+#ifdef VERTEX_SHADER
+
+layout (location = 0) in vec3 Vertices;
+layout (location = 1) in vec2 TexCoords;
+
+// Per instance attributes, see particle_instance in particle.h
+layout (location = 2) in vec3 Instance; // Position in xy, size in z
+layout (location = 3) in vec4 InstanceColor; // Alpha is the life left
+
+//  Variables in a uniform block can be directly accessed without the
+//  block name as a prefix.
+layout (std140) uniform CameraMatrices
+{
+    mat4 Projection;
+    mat4 Orthographic;
+    mat4 View;
+};
+
+out vec2 Offset; // From the center of the particle, -1 to 1
+out vec4 Color;
+
+void main()
+{
+    Offset = TexCoords * 2.0 - 1.0;
+    Color = InstanceColor;
+    gl_Position = Projection * View * vec4(Instance.xy + Vertices.xy * Instance.z, 0.0, 1.0);
+}
+
+#endif
+
+#ifdef FRAGMENT_SHADER
+
+layout (location = 0) out vec4 FragmentColor;
+
+in vec2 Offset;
+in vec4 Color;
+
+uniform float Brightness;
+
+// A round dot that fades to the edge, added to the scene
+void main()
+{
+    float Falloff = max(1.0 - dot(Offset, Offset), 0.0);
+    FragmentColor = vec4(Color.rgb * (Brightness * Color.a * Falloff * Falloff), 0.0);
+}
+#endif
@@ -0,0 +1,48 @@
+#ifdef VERTEX_SHADER
+
+layout (location = 0) in vec3 Vertices;
+layout (location = 1) in vec2 TexCoords;
+
+// Per instance attributes, see sprite_instance in renderer.h
+layout (location = 2) in vec3 InstancePosition;
+layout (location = 3) in vec2 InstanceSize;
+layout (location = 4) in vec2 InstanceRotation; // (cos, sin)
+layout (location = 5) in vec4 InstanceUVRect;   // Offset in xy, size in zw
+
+//  Variables in a uniform block can be directly accessed without the
+//  block name as a prefix.
+layout (std140) uniform CameraMatrices
+{
+    mat4 Projection;
+    mat4 Orthographic;
+    mat4 View;
+};
+
+out vec2 TextureCoordinates;
+
+void main()
+{
+    TextureCoordinates = InstanceUVRect.xy + TexCoords * InstanceUVRect.zw;
+
+    vec2 Scaled = Vertices.xy * InstanceSize;
+    vec2 Rotated = vec2(Scaled.x * InstanceRotation.x - Scaled.y * InstanceRotation.y,
+                        Scaled.x * InstanceRotation.y + Scaled.y * InstanceRotation.x);
+    gl_Position = Projection * View * vec4(InstancePosition + vec3(Rotated, 0.0), 1.0);
+}
+
+#endif
+
+#ifdef FRAGMENT_SHADER
+
+layout (location = 0) out vec4 FragmentColor;
+
+in vec2 TextureCoordinates;
+uniform sampler2D Image;
+
+// The bright pixels are extracted from the scene afterwards, see
+// kawase.glsl
+void main()
+{
+    FragmentColor = texture(Image, TextureCoordinates);
+}
+#endif
@@ -1,7 +1,9 @@
+#pragma keywords DISTANCE_FIELD
 #ifdef VERTEX_SHADER
 
-layout(location = 0) in vec3 Vertices;
+layout(location = 0) in vec2 Vertices; // Screen position in pixels
 layout(location = 1) in vec2 TexCoords;
+layout(location = 2) in vec3 Color;
 
 //  Variables in a uniform block can be directly accessed without the
 //  block name as a prefix.
@@ -11,14 +13,19 @@ layout (std140) uniform CameraMatrices
     mat4 CameraOrthographic;
     mat4 CameraView;
 };
-uniform mat4 Model;
+
+// Screen position of retained text meshes, which are laid out at the
+// origin. Zero for the text batch
+uniform vec2 Offset;
 
 out vec2 UV;
+out vec3 TextColor;
 
 void main()
 {
-    gl_Position = CameraOrthographic * Model * vec4(Vertices, 1.0);
+    gl_Position = CameraOrthographic * vec4(Vertices + Offset, 0.0, 1.0);
     UV = TexCoords;
+    TextColor = Color;
 }
 
 #endif
@@ -26,30 +33,26 @@ void main()
 #ifdef FRAGMENT_SHADER
 
 layout (location = 0) out vec4 FragmentColor;
-layout (location = 1) out vec4 BrightnessColor;
 
 in vec2 UV;
+in vec3 TextColor;
 uniform sampler2D Text;
-uniform vec3 TextColor;
-uniform float BrightnessThreshold;
-
-// IMPORTANT: The shaders _needs_ to write to Brightness color in
-// order to show anything on the screen. Wasted a lot of time on this.
 
 void main()
 {
-    vec4 Sampled = vec4(1.0, 1.0, 1.0, texture(Text, UV).r);
-    FragmentColor = vec4(TextColor, 1.0) * Sampled;
+#ifdef DISTANCE_FIELD
+    // The atlas stores the distance to the glyph outline, 0.5 on it.
+    // fwidth is how much it changes over one screen pixel, so the edge
+    // is antialiased over about a pixel at any scale
+    float Distance = texture(Text, UV).r;
+    float EdgeWidth = max(fwidth(Distance) * 0.7, 0.0001);
+    float Alpha = smoothstep(0.5 - EdgeWidth, 0.5 + EdgeWidth, Distance);
+#else
+    float Alpha = texture(Text, UV).r;
+#endif
 
-    float Brightness = dot(FragmentColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    if(Brightness > BrightnessThreshold)
-    {
-        BrightnessColor = FragmentColor;
-    }
-    else
-    {
-        BrightnessColor = vec4(0.0, 0.0, 0.0, 1.0);
-    }
+    vec4 Sampled = vec4(1.0, 1.0, 1.0, Alpha);
+    FragmentColor = vec4(TextColor, 1.0) * Sampled;
 }
 
 #endif
@@ -73,24 +73,26 @@ void C_RectangleVertices(rectangle RectangleInput, glm::vec2 *OutputArray)
     OutputArray[3] = {+RectangleInput.HalfWidth, -RectangleInput.HalfHeight};
 
     // Rotate the vertices and add the RectangleInput.Center, translating the vertices to the correct world position.
-    OutputArray[0] = RectangleInput.Center + glm::rotate(OutputArray[0], glm::radians(RectangleInput.Angle));
-    OutputArray[1] = RectangleInput.Center + glm::rotate(OutputArray[1], glm::radians(RectangleInput.Angle));
-    OutputArray[2] = RectangleInput.Center + glm::rotate(OutputArray[2], glm::radians(RectangleInput.Angle));
-    OutputArray[3] = RectangleInput.Center + glm::rotate(OutputArray[3], glm::radians(RectangleInput.Angle));
+    OutputArray[0] = RectangleInput.Center + Rotate(OutputArray[0], RectangleInput.Rotation);
+    OutputArray[1] = RectangleInput.Center + Rotate(OutputArray[1], RectangleInput.Rotation);
+    OutputArray[2] = RectangleInput.Center + Rotate(OutputArray[2], RectangleInput.Rotation);
+    OutputArray[3] = RectangleInput.Center + Rotate(OutputArray[3], RectangleInput.Rotation);
 }
 
 rectangle_collision_data C_GenerateRectangleCollisionData(rectangle Input)
 {
     rectangle_collision_data Result = {};
     C_RectangleVertices(Input, Result.Vertices);
-    // Get the separation Axes and Normalize them so we can project vectors onto them
-    Result.SeparationAxes[0] = glm::normalize(C_RighthandNormal(Result.Vertices[2] - Result.Vertices[0]));
-    Result.SeparationAxes[1] = glm::normalize(C_RighthandNormal(Result.Vertices[0] - Result.Vertices[1]));
+    // The separation axes are the normals of the edges, which for a
+    // unit rotation (c, s) are (c, s) and (s, -c) already normalized
+    glm::vec2 Rotation = Input.Rotation;
+    Result.SeparationAxes[0] = Rotation;
+    Result.SeparationAxes[1] = glm::vec2(Rotation.y, -Rotation.x);
 
     return (Result);
 }
 
-void C_ProjectRectangleVertices(rectangle_collision_data Rectangle, glm::vec2 Axis, f32 *Min, f32 *Max)
+void C_ProjectRectangleVertices(rectangle_collision_data *Rectangle, glm::vec2 Axis, f32 *Min, f32 *Max)
 {
     *Min = 0.0f;
     *Max = 0.0f;
@@ -100,7 +102,7 @@ void C_ProjectRectangleVertices(rectangle_collision_data Rectangle, glm::vec2 Ax
     // Loop through the vertices, since we only support OBB we only need 4 loops.
     for(int i = 0; i < 4; i++)
     {
-        f32 P = glm::dot(Rectangle.Vertices[i], Axis);
+        f32 P = glm::dot(Rectangle->Vertices[i], Axis);
 
         if(FirstIteration)
         {
@@ -166,20 +168,21 @@ b32 C_CollisionCircleCircle(circle A, circle B, glm::vec2 *ResolutionDirection,
     }
 }
 
-b32 C_CollisionRectangleRectangle(rectangle A, rectangle B, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
+// SAT test between two rectangles whose vertices and axes are already
+// computed, see C_UpdateCollider
+b32 C_SATRectangleRectangle(rectangle_collision_data *DataA, rectangle_collision_data *DataB, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
 {
+    Assert(DataA);
+    Assert(DataB);
     Assert(ResolutionDirection);
-        Assert(ResolutionOverlap);
-
-    rectangle_collision_data DataA = C_GenerateRectangleCollisionData(A);
-    rectangle_collision_data DataB = C_GenerateRectangleCollisionData(B);
+    Assert(ResolutionOverlap);
 
     glm::vec2 Axes[4] =
     {
-        DataA.SeparationAxes[0],
-        DataA.SeparationAxes[1],
-        DataB.SeparationAxes[0],
-        DataB.SeparationAxes[1],
+        DataA->SeparationAxes[0],
+        DataA->SeparationAxes[1],
+        DataB->SeparationAxes[0],
+        DataB->SeparationAxes[1],
     };
 
     f32 HugeNumber = 999999999999.9f;
@@ -208,7 +211,7 @@ b32 C_CollisionRectangleRectangle(rectangle A, rectangle B, glm::vec2 *Resolutio
             if(Overlap < SmallestOverlap)
             {
                 SmallestOverlap = Overlap;
-                SmallestAxis = glm::normalize(Axes[i]);
+                SmallestAxis = Axes[i];
 
                 // This if checks the direction in which the obb has
                 // to be displaced Got it from:
@@ -227,16 +230,28 @@ b32 C_CollisionRectangleRectangle(rectangle A, rectangle B, glm::vec2 *Resolutio
     return true;
 }
 
-b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
+b32 C_CollisionRectangleRectangle(rectangle A, rectangle B, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
+{
+    Assert(ResolutionDirection);
+    Assert(ResolutionOverlap);
+
+    rectangle_collision_data DataA = C_GenerateRectangleCollisionData(A);
+    rectangle_collision_data DataB = C_GenerateRectangleCollisionData(B);
+
+    return C_SATRectangleRectangle(&DataA, &DataB, ResolutionDirection, ResolutionOverlap);
+}
+
+// SAT test between a rectangle whose vertices and axes are already
+// computed and a circle, see C_UpdateCollider
+b32 C_SATRectangleCircle(rectangle_collision_data *RectangleCollisionData, circle InputCircle, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
 {
+    Assert(RectangleCollisionData);
     Assert(ResolutionDirection);
     Assert(ResolutionOverlap);
 
     f32 SmallestOverlap = FLT_MAX;
     glm::vec2 SmallestAxis = {};
 
-    rectangle_collision_data RectangleCollisionData = C_GenerateRectangleCollisionData(InputRectangle);
-
     // Test collision on the rectangle axes
     // Now we have the rectangle vertices, the rectangle SAT axes and the Circle Vertices in world space, let's do this.
     for(i32 i = 0; i < 2; i++)
@@ -244,10 +259,10 @@ b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm
         // Project all vertices of obb onto one axis
         f32 MinA = 0.0f;
         f32 MaxA = 0.0f;
-        C_ProjectRectangleVertices(RectangleCollisionData, RectangleCollisionData.SeparationAxes[i], &MinA, &MaxA);
+        C_ProjectRectangleVertices(RectangleCollisionData, RectangleCollisionData->SeparationAxes[i], &MinA, &MaxA);
 
         // Project the circle center on the obb separation axes, add and substract radius to get min,max
-        f32 CircleCenter = dot(InputCircle.Center, RectangleCollisionData.SeparationAxes[i]);
+        f32 CircleCenter = dot(InputCircle.Center, RectangleCollisionData->SeparationAxes[i]);
         f32 MinB = CircleCenter - InputCircle.Radius;
         f32 MaxB = CircleCenter + InputCircle.Radius;
 
@@ -266,7 +281,7 @@ b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm
             if(Overlap < SmallestOverlap)
             {
                 SmallestOverlap = Overlap;
-                SmallestAxis = glm::normalize(RectangleCollisionData.SeparationAxes[i]);
+                SmallestAxis = RectangleCollisionData->SeparationAxes[i];
 
                 // This if checks the direction in which the obb
                 // has to be displaced Got it from:
@@ -283,9 +298,7 @@ b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm
     *ResolutionDirection = SmallestAxis;
 
     // Find the closest vertex of the rectangle to the center of the circle
-    glm::vec2 Vertices[4];
-    C_RectangleVertices(InputRectangle, Vertices);
-    glm::vec2 ClosestVertex = C_ClosestVertexToPoint(Vertices, InputCircle.Center);
+    glm::vec2 ClosestVertex = C_ClosestVertexToPoint(RectangleCollisionData->Vertices, InputCircle.Center);
 
     // Get the axis to test
     glm::vec2 Axis = glm::normalize(ClosestVertex - InputCircle.Center);
@@ -332,26 +345,122 @@ b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm
     return true;
 }
 
-b32 C_Collision(collider A, collider B, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
+b32 C_CollisionRectangleCircle(rectangle InputRectangle, circle InputCircle, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
 {
     Assert(ResolutionDirection);
     Assert(ResolutionOverlap);
 
-    if(A.Type == Collider_Rectangle && B.Type == Collider_Rectangle)
+    rectangle_collision_data RectangleCollisionData = C_GenerateRectangleCollisionData(InputRectangle);
+
+    return C_SATRectangleCircle(&RectangleCollisionData, InputCircle, ResolutionDirection, ResolutionOverlap);
+}
+
+glm::vec2 C_ColliderCenter(collider *Collider)
+{
+    Assert(Collider);
+
+    switch(Collider->Type)
     {
-        return C_CollisionRectangleRectangle(A.Rectangle, B.Rectangle, ResolutionDirection, ResolutionOverlap);
+        case Collider_Rectangle: { return Collider->Rectangle.Center; }
+        case Collider_Circle:    { return Collider->Circle.Center; }
+        default:
+        {
+            InvalidCodePath;
+            return glm::vec2(0.0f);
+        }
     }
-    else if(A.Type == Collider_Rectangle && B.Type == Collider_Circle)
+}
+
+// Radius of the smallest circle centered on the collider that contains it
+f32 C_BoundingRadius(collider *Collider)
+{
+    Assert(Collider);
+
+    return Collider->BoundingRadius;
+}
+
+// Recomputes the derived data of the collider (world vertices, SAT
+// axes, AABB and bounding radius). Call it after changing the shape.
+void C_UpdateCollider(collider *Collider)
+{
+    Assert(Collider);
+
+    switch(Collider->Type)
     {
-        return C_CollisionRectangleCircle(A.Rectangle, B.Circle, ResolutionDirection, ResolutionOverlap);
+        case Collider_Rectangle:
+        {
+            Collider->RectangleData = C_GenerateRectangleCollisionData(Collider->Rectangle);
+
+            glm::vec2 *Vertices = Collider->RectangleData.Vertices;
+            Collider->AABBMin = glm::min(glm::min(Vertices[0], Vertices[1]), glm::min(Vertices[2], Vertices[3]));
+            Collider->AABBMax = glm::max(glm::max(Vertices[0], Vertices[1]), glm::max(Vertices[2], Vertices[3]));
+
+            f32 HalfWidth = Collider->Rectangle.HalfWidth;
+            f32 HalfHeight = Collider->Rectangle.HalfHeight;
+            Collider->BoundingRadius = sqrtf(HalfWidth * HalfWidth + HalfHeight * HalfHeight);
+            break;
+        }
+        case Collider_Circle:
+        {
+            glm::vec2 Radius = glm::vec2(Collider->Circle.Radius);
+            Collider->AABBMin = Collider->Circle.Center - Radius;
+            Collider->AABBMax = Collider->Circle.Center + Radius;
+            Collider->BoundingRadius = Collider->Circle.Radius;
+            break;
+        }
+        default:
+        {
+            InvalidCodePath;
+            break;
+        }
     }
-    else if(A.Type == Collider_Circle && B.Type == Collider_Rectangle)
+}
+
+// Cheap rejection before any SAT work, false means the colliders can
+// not be touching. Uses the cached AABBs and bounding radii.
+b32 C_BoundsOverlap(collider *A, collider *B)
+{
+    if(A->AABBMax.x < B->AABBMin.x || B->AABBMax.x < A->AABBMin.x ||
+       A->AABBMax.y < B->AABBMin.y || B->AABBMax.y < A->AABBMin.y)
     {
-        return C_CollisionRectangleCircle(B.Rectangle, A.Circle, ResolutionDirection, ResolutionOverlap);
+        return false;
     }
-    else if(A.Type == Collider_Circle && B.Type == Collider_Circle)
+
+    glm::vec2 Delta = C_ColliderCenter(A) - C_ColliderCenter(B);
+    f32 RadiiSum = A->BoundingRadius + B->BoundingRadius;
+
+    return glm::dot(Delta, Delta) <= RadiiSum * RadiiSum;
+}
+
+b32 C_Collision(collider *A, collider *B, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
+{
+    Assert(A);
+    Assert(B);
+    Assert(ResolutionDirection);
+    Assert(ResolutionOverlap);
+
+    if(!C_BoundsOverlap(A, B))
     {
-        return C_CollisionCircleCircle(A.Circle, B.Circle, ResolutionDirection, ResolutionOverlap);
+        *ResolutionDirection = {};
+        *ResolutionOverlap = 0.0f;
+        return false;
+    }
+
+    if(A->Type == Collider_Rectangle && B->Type == Collider_Rectangle)
+    {
+        return C_SATRectangleRectangle(&A->RectangleData, &B->RectangleData, ResolutionDirection, ResolutionOverlap);
+    }
+    else if(A->Type == Collider_Rectangle && B->Type == Collider_Circle)
+    {
+        return C_SATRectangleCircle(&A->RectangleData, B->Circle, ResolutionDirection, ResolutionOverlap);
+    }
+    else if(A->Type == Collider_Circle && B->Type == Collider_Rectangle)
+    {
+        return C_SATRectangleCircle(&B->RectangleData, A->Circle, ResolutionDirection, ResolutionOverlap);
+    }
+    else if(A->Type == Collider_Circle && B->Type == Collider_Circle)
+    {
+        return C_CollisionCircleCircle(A->Circle, B->Circle, ResolutionDirection, ResolutionOverlap);
     }
     else
     {
@@ -359,3 +468,599 @@ b32 C_Collision(collider A, collider B, glm::vec2 *ResolutionDirection, f32 *Res
         return false;
     }
 }
+
+collision_grid *C_CreateGrid(f32 Left, f32 Right, f32 Bottom, f32 Top, f32 CellSize, u32 InitialCapacity)
+{
+    Assert(Left < Right);
+    Assert(Bottom < Top);
+    Assert(CellSize > 0.0f);
+    Assert(InitialCapacity > 0);
+
+    collision_grid *Result = (collision_grid*)Malloc(sizeof(collision_grid)); Assert(Result);
+
+    Result->Min = glm::vec2(Left, Bottom);
+    Result->CellSize = CellSize;
+    Result->InverseCellSize = 1.0f / CellSize;
+    Result->CellsX = (i32)ceilf((Right - Left) / CellSize);
+    Result->CellsY = (i32)ceilf((Top - Bottom) / CellSize);
+
+    u32 CellCount = Result->CellsX * Result->CellsY;
+    Result->CellStart = (u32*)Malloc(sizeof(u32) * (CellCount + 1)); Assert(Result->CellStart);
+
+    Result->Count = 0;
+    Result->Capacity = InitialCapacity;
+    Result->MaxRadius = 0.0f;
+    Result->SortedIds = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->SortedIds);
+    Result->ItemIds = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->ItemIds);
+    Result->ItemCells = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->ItemCells);
+    Result->QueryIds = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->QueryIds);
+
+    return (Result);
+}
+
+i32 C_GridCellX(collision_grid *Grid, f32 X)
+{
+    i32 Result = (i32)floorf((X - Grid->Min.x) * Grid->InverseCellSize);
+    if(Result < 0) { Result = 0; }
+    if(Result >= Grid->CellsX) { Result = Grid->CellsX - 1; }
+    return Result;
+}
+
+i32 C_GridCellY(collision_grid *Grid, f32 Y)
+{
+    i32 Result = (i32)floorf((Y - Grid->Min.y) * Grid->InverseCellSize);
+    if(Result < 0) { Result = 0; }
+    if(Result >= Grid->CellsY) { Result = Grid->CellsY - 1; }
+    return Result;
+}
+
+void C_GridBegin(collision_grid *Grid)
+{
+    Assert(Grid);
+
+    Grid->Count = 0;
+    Grid->MaxRadius = 0.0f;
+}
+
+void C_GridInsert(collision_grid *Grid, u32 Id, glm::vec2 Center, f32 Radius)
+{
+    Assert(Grid);
+
+    if(Grid->Count == Grid->Capacity)
+    {
+        u32 NewCapacity = Grid->Capacity * 2;
+        Grid->SortedIds = (u32*)Realloc(Grid->SortedIds, sizeof(u32) * NewCapacity); Assert(Grid->SortedIds);
+        Grid->ItemIds = (u32*)Realloc(Grid->ItemIds, sizeof(u32) * NewCapacity); Assert(Grid->ItemIds);
+        Grid->ItemCells = (u32*)Realloc(Grid->ItemCells, sizeof(u32) * NewCapacity); Assert(Grid->ItemCells);
+        Grid->QueryIds = (u32*)Realloc(Grid->QueryIds, sizeof(u32) * NewCapacity); Assert(Grid->QueryIds);
+        Grid->Capacity = NewCapacity;
+    }
+
+    i32 CellX = C_GridCellX(Grid, Center.x);
+    i32 CellY = C_GridCellY(Grid, Center.y);
+
+    Grid->ItemIds[Grid->Count] = Id;
+    Grid->ItemCells[Grid->Count] = CellY * Grid->CellsX + CellX;
+    Grid->Count++;
+
+    if(Radius > Grid->MaxRadius)
+    {
+        Grid->MaxRadius = Radius;
+    }
+}
+
+// Counting sort of the inserted items by cell
+void C_GridEnd(collision_grid *Grid)
+{
+    Assert(Grid);
+
+    u32 CellCount = Grid->CellsX * Grid->CellsY;
+    memset(Grid->CellStart, 0, sizeof(u32) * (CellCount + 1));
+
+    // Count items per cell, shifted by one so the prefix sum below
+    // leaves the start of every cell in CellStart
+    for(u32 i = 0; i < Grid->Count; i++)
+    {
+        Grid->CellStart[Grid->ItemCells[i] + 1]++;
+    }
+
+    for(u32 Cell = 0; Cell < CellCount; Cell++)
+    {
+        Grid->CellStart[Cell + 1] += Grid->CellStart[Cell];
+    }
+
+    // Scatter, CellStart[Cell] is used as the write cursor and ends
+    // up pointing at the start of the next cell, shift it back after.
+    for(u32 i = 0; i < Grid->Count; i++)
+    {
+        Grid->SortedIds[Grid->CellStart[Grid->ItemCells[i]]++] = Grid->ItemIds[i];
+    }
+    for(u32 Cell = CellCount; Cell > 0; Cell--)
+    {
+        Grid->CellStart[Cell] = Grid->CellStart[Cell - 1];
+    }
+    Grid->CellStart[0] = 0;
+}
+
+// Collects the ids of every item whose cell can hold something that
+// overlaps the circle (Center, Radius) into Grid->QueryIds and returns
+// how many there are. These are candidates only, the caller still has
+// to run the narrowphase (C_Collision) on them.
+u32 C_GridQuery(collision_grid *Grid, glm::vec2 Center, f32 Radius)
+{
+    Assert(Grid);
+
+    // Items are bucketed by their center only, grow the search area
+    // by the biggest radius inserted so nothing is missed.
+    f32 Reach = Radius + Grid->MaxRadius;
+    i32 MinX = C_GridCellX(Grid, Center.x - Reach);
+    i32 MaxX = C_GridCellX(Grid, Center.x + Reach);
+    i32 MinY = C_GridCellY(Grid, Center.y - Reach);
+    i32 MaxY = C_GridCellY(Grid, Center.y + Reach);
+
+    u32 Result = 0;
+    for(i32 Y = MinY; Y <= MaxY; Y++)
+    {
+        // Cells of a row are contiguous in SortedIds
+        u32 First = Grid->CellStart[Y * Grid->CellsX + MinX];
+        u32 Last = Grid->CellStart[Y * Grid->CellsX + MaxX + 1];
+        for(u32 i = First; i < Last; i++)
+        {
+            Grid->QueryIds[Result++] = Grid->SortedIds[i];
+        }
+    }
+
+    return (Result);
+}
+
+//
+// Batched narrowphase
+//
+
+// The kernels need SSE2, which every x64 compiler enables by
+// default. Everywhere else C_BatchRun falls back to C_Collision.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISION_SIMD 1
+#include <emmintrin.h>
+#else
+#define COLLISION_SIMD 0
+#endif
+
+collision_batch *C_CreateCollisionBatch(u32 InitialCapacity)
+{
+    Assert(InitialCapacity > 0);
+
+    collision_batch *Result = (collision_batch*)Malloc(sizeof(collision_batch)); Assert(Result);
+
+    Result->Count = 0;
+    Result->Capacity = InitialCapacity;
+    Result->Pairs = (collision_pair*)Malloc(sizeof(collision_pair) * InitialCapacity); Assert(Result->Pairs);
+    Result->Results = (collision_result*)Malloc(sizeof(collision_result) * InitialCapacity); Assert(Result->Results);
+    Result->RectangleRectangle = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->RectangleRectangle);
+    Result->RectangleCircle = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->RectangleCircle);
+    Result->CircleCircle = (u32*)Malloc(sizeof(u32) * InitialCapacity); Assert(Result->CircleCircle);
+
+    return (Result);
+}
+
+void C_BatchClear(collision_batch *Batch)
+{
+    Assert(Batch);
+
+    Batch->Count = 0;
+}
+
+// Returns the index of the pair, which is also the index of its result
+u32 C_BatchAddPair(collision_batch *Batch, collider *A, collider *B, u32 IdA, u32 IdB)
+{
+    Assert(Batch);
+    Assert(A);
+    Assert(B);
+
+    if(Batch->Count == Batch->Capacity)
+    {
+        u32 NewCapacity = Batch->Capacity * 2;
+        Batch->Pairs = (collision_pair*)Realloc(Batch->Pairs, sizeof(collision_pair) * NewCapacity); Assert(Batch->Pairs);
+        Batch->Results = (collision_result*)Realloc(Batch->Results, sizeof(collision_result) * NewCapacity); Assert(Batch->Results);
+        Batch->RectangleRectangle = (u32*)Realloc(Batch->RectangleRectangle, sizeof(u32) * NewCapacity); Assert(Batch->RectangleRectangle);
+        Batch->RectangleCircle = (u32*)Realloc(Batch->RectangleCircle, sizeof(u32) * NewCapacity); Assert(Batch->RectangleCircle);
+        Batch->CircleCircle = (u32*)Realloc(Batch->CircleCircle, sizeof(u32) * NewCapacity); Assert(Batch->CircleCircle);
+        Batch->Capacity = NewCapacity;
+    }
+
+    u32 Result = Batch->Count++;
+    Batch->Pairs[Result].A = A;
+    Batch->Pairs[Result].B = B;
+    Batch->Pairs[Result].IdA = IdA;
+    Batch->Pairs[Result].IdB = IdB;
+
+    return (Result);
+}
+
+#if COLLISION_SIMD
+
+// Lane helpers, every __m128 holds the same value for 4 different pairs
+#define C_Lanes(Expr) _mm_setr_ps(Lane[0]->Expr, Lane[1]->Expr, Lane[2]->Expr, Lane[3]->Expr)
+
+inline __m128 C_Abs4(__m128 A)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), A);
+}
+
+inline __m128 C_Select4(__m128 Mask, __m128 A, __m128 B)
+{
+    // Mask ? A : B
+    return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+}
+
+// Same math as C_GetOverlap, in the same order so the results match
+inline __m128 C_GetOverlap4(__m128 MinA, __m128 MaxA, __m128 MinB, __m128 MaxB)
+{
+    __m128 TotalLength = _mm_add_ps(C_Abs4(_mm_sub_ps(MaxA, MinA)), C_Abs4(_mm_sub_ps(MaxB, MinB)));
+    __m128 Length = C_Abs4(_mm_sub_ps(_mm_max_ps(MaxA, MaxB), _mm_min_ps(MinA, MinB)));
+    return C_Abs4(_mm_sub_ps(Length, TotalLength));
+}
+
+// Projects 4 vertices (per lane) onto an axis (per lane)
+inline void C_Project4(__m128 *VerticesX, __m128 *VerticesY, __m128 AxisX, __m128 AxisY, __m128 *Min, __m128 *Max)
+{
+    __m128 P = _mm_add_ps(_mm_mul_ps(VerticesX[0], AxisX), _mm_mul_ps(VerticesY[0], AxisY));
+    *Min = P;
+    *Max = P;
+    for(u32 i = 1; i < 4; i++)
+    {
+        P = _mm_add_ps(_mm_mul_ps(VerticesX[i], AxisX), _mm_mul_ps(VerticesY[i], AxisY));
+        *Min = _mm_min_ps(*Min, P);
+        *Max = _mm_max_ps(*Max, P);
+    }
+}
+
+// glm::normalize does V * inversesqrt(dot(V, V)), do the same
+inline void C_Normalize4(__m128 *X, __m128 *Y)
+{
+    __m128 InverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(*X, *X), _mm_mul_ps(*Y, *Y))));
+    *X = _mm_mul_ps(*X, InverseLength);
+    *Y = _mm_mul_ps(*Y, InverseLength);
+}
+
+inline void C_StoreResults4(collision_batch *Batch, u32 *Indices, u32 LaneCount, __m128 Colliding, __m128 DirectionX, __m128 DirectionY, __m128 Overlap)
+{
+    // Non colliding lanes report a zero direction and overlap
+    DirectionX = _mm_and_ps(Colliding, DirectionX);
+    DirectionY = _mm_and_ps(Colliding, DirectionY);
+    Overlap = _mm_and_ps(Colliding, Overlap);
+
+    i32 Mask = _mm_movemask_ps(Colliding);
+    f32 X[4], Y[4], O[4];
+    _mm_storeu_ps(X, DirectionX);
+    _mm_storeu_ps(Y, DirectionY);
+    _mm_storeu_ps(O, Overlap);
+
+    for(u32 i = 0; i < LaneCount; i++)
+    {
+        collision_result *Result = &Batch->Results[Indices[i]];
+        Result->Colliding = (Mask >> i) & 1;
+        Result->ResolutionDirection = glm::vec2(X[i], Y[i]);
+        Result->ResolutionOverlap = O[i];
+    }
+}
+
+// SIMD version of C_SATRectangleRectangle
+void C_BatchRectangleRectangle(collision_batch *Batch, u32 *Indices, u32 LaneCount)
+{
+    rectangle_collision_data *A[4];
+    rectangle_collision_data *B[4];
+    for(u32 i = 0; i < 4; i++)
+    {
+        // Unused lanes repeat the last pair, their results are dropped
+        collision_pair *Pair = &Batch->Pairs[Indices[i < LaneCount ? i : LaneCount - 1]];
+        A[i] = &Pair->A->RectangleData;
+        B[i] = &Pair->B->RectangleData;
+    }
+
+    __m128 AVerticesX[4], AVerticesY[4], BVerticesX[4], BVerticesY[4];
+    rectangle_collision_data **Lane = A;
+    for(u32 v = 0; v < 4; v++)
+    {
+        AVerticesX[v] = C_Lanes(Vertices[v].x);
+        AVerticesY[v] = C_Lanes(Vertices[v].y);
+    }
+    __m128 AxesX[4] = { C_Lanes(SeparationAxes[0].x), C_Lanes(SeparationAxes[1].x) };
+    __m128 AxesY[4] = { C_Lanes(SeparationAxes[0].y), C_Lanes(SeparationAxes[1].y) };
+
+    Lane = B;
+    for(u32 v = 0; v < 4; v++)
+    {
+        BVerticesX[v] = C_Lanes(Vertices[v].x);
+        BVerticesY[v] = C_Lanes(Vertices[v].y);
+    }
+    AxesX[2] = C_Lanes(SeparationAxes[0].x);
+    AxesX[3] = C_Lanes(SeparationAxes[1].x);
+    AxesY[2] = C_Lanes(SeparationAxes[0].y);
+    AxesY[3] = C_Lanes(SeparationAxes[1].y);
+
+    __m128 Colliding = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 SmallestOverlap = _mm_set1_ps(FLT_MAX);
+    __m128 SmallestX = _mm_setzero_ps();
+    __m128 SmallestY = _mm_setzero_ps();
+
+    for(u32 i = 0; i < 4; i++)
+    {
+        __m128 MinA, MaxA, MinB, MaxB;
+        C_Project4(AVerticesX, AVerticesY, AxesX[i], AxesY[i], &MinA, &MaxA);
+        C_Project4(BVerticesX, BVerticesY, AxesX[i], AxesY[i], &MinB, &MaxB);
+
+        // A separating axis means no collision for that lane, the
+        // remaining axes do not matter for it anymore
+        __m128 Overlapping = _mm_and_ps(_mm_cmple_ps(MinB, MaxA), _mm_cmple_ps(MinA, MaxB));
+        Colliding = _mm_and_ps(Colliding, Overlapping);
+        if(_mm_movemask_ps(Colliding) == 0) { break; }
+
+        __m128 Overlap = C_GetOverlap4(MinA, MaxA, MinB, MaxB);
+        __m128 Smaller = _mm_cmplt_ps(Overlap, SmallestOverlap);
+
+        __m128 AxisX = AxesX[i];
+        __m128 AxisY = AxesY[i];
+        __m128 Flip = _mm_and_ps(_mm_cmplt_ps(MinA, MinB), _mm_set1_ps(-0.0f));
+        AxisX = _mm_xor_ps(AxisX, Flip);
+        AxisY = _mm_xor_ps(AxisY, Flip);
+
+        SmallestOverlap = C_Select4(Smaller, Overlap, SmallestOverlap);
+        SmallestX = C_Select4(Smaller, AxisX, SmallestX);
+        SmallestY = C_Select4(Smaller, AxisY, SmallestY);
+    }
+
+    C_StoreResults4(Batch, Indices, LaneCount, Colliding, SmallestX, SmallestY, SmallestOverlap);
+}
+
+// SIMD version of C_SATRectangleCircle
+void C_BatchRectangleCircle(collision_batch *Batch, u32 *Indices, u32 LaneCount)
+{
+    rectangle_collision_data *R[4];
+    circle *C[4];
+    for(u32 i = 0; i < 4; i++)
+    {
+        collision_pair *Pair = &Batch->Pairs[Indices[i < LaneCount ? i : LaneCount - 1]];
+        collider *Rectangle = Pair->A->Type == Collider_Rectangle ? Pair->A : Pair->B;
+        collider *Circle = Pair->A->Type == Collider_Rectangle ? Pair->B : Pair->A;
+        R[i] = &Rectangle->RectangleData;
+        C[i] = &Circle->Circle;
+    }
+
+    __m128 VerticesX[4], VerticesY[4];
+    rectangle_collision_data **Lane = R;
+    for(u32 v = 0; v < 4; v++)
+    {
+        VerticesX[v] = C_Lanes(Vertices[v].x);
+        VerticesY[v] = C_Lanes(Vertices[v].y);
+    }
+    __m128 AxesX[2] = { C_Lanes(SeparationAxes[0].x), C_Lanes(SeparationAxes[1].x) };
+    __m128 AxesY[2] = { C_Lanes(SeparationAxes[0].y), C_Lanes(SeparationAxes[1].y) };
+
+    __m128 CenterX = _mm_setr_ps(C[0]->Center.x, C[1]->Center.x, C[2]->Center.x, C[3]->Center.x);
+    __m128 CenterY = _mm_setr_ps(C[0]->Center.y, C[1]->Center.y, C[2]->Center.y, C[3]->Center.y);
+    __m128 Radius = _mm_setr_ps(C[0]->Radius, C[1]->Radius, C[2]->Radius, C[3]->Radius);
+
+    __m128 Colliding = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 SmallestOverlap = _mm_set1_ps(FLT_MAX);
+    __m128 SmallestX = _mm_setzero_ps();
+    __m128 SmallestY = _mm_setzero_ps();
+
+    // Rectangle axes
+    for(u32 i = 0; i < 2; i++)
+    {
+        __m128 MinA, MaxA;
+        C_Project4(VerticesX, VerticesY, AxesX[i], AxesY[i], &MinA, &MaxA);
+
+        __m128 CircleCenter = _mm_add_ps(_mm_mul_ps(CenterX, AxesX[i]), _mm_mul_ps(CenterY, AxesY[i]));
+        __m128 MinB = _mm_sub_ps(CircleCenter, Radius);
+        __m128 MaxB = _mm_add_ps(CircleCenter, Radius);
+
+        __m128 Overlapping = _mm_and_ps(_mm_cmple_ps(MinB, MaxA), _mm_cmple_ps(MinA, MaxB));
+        Colliding = _mm_and_ps(Colliding, Overlapping);
+
+        __m128 Overlap = C_GetOverlap4(MinA, MaxA, MinB, MaxB);
+        __m128 Smaller = _mm_cmplt_ps(Overlap, SmallestOverlap);
+
+        __m128 AxisX = AxesX[i];
+        __m128 AxisY = AxesY[i];
+        __m128 Flip = _mm_and_ps(_mm_cmplt_ps(MinA, MinB), _mm_set1_ps(-0.0f));
+        AxisX = _mm_xor_ps(AxisX, Flip);
+        AxisY = _mm_xor_ps(AxisY, Flip);
+
+        SmallestOverlap = C_Select4(Smaller, Overlap, SmallestOverlap);
+        SmallestX = C_Select4(Smaller, AxisX, SmallestX);
+        SmallestY = C_Select4(Smaller, AxisY, SmallestY);
+    }
+
+    if(_mm_movemask_ps(Colliding) != 0)
+    {
+        // Closest rectangle vertex to the circle center, first one wins on ties like C_ClosestVertexToPoint
+        __m128 ClosestDistance = _mm_set1_ps(FLT_MAX);
+        __m128 ClosestX = _mm_setzero_ps();
+        __m128 ClosestY = _mm_setzero_ps();
+        for(u32 v = 0; v < 4; v++)
+        {
+            __m128 DeltaX = _mm_sub_ps(CenterX, VerticesX[v]);
+            __m128 DeltaY = _mm_sub_ps(CenterY, VerticesY[v]);
+            __m128 Distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(DeltaX, DeltaX), _mm_mul_ps(DeltaY, DeltaY)));
+            __m128 Closer = _mm_cmplt_ps(Distance, ClosestDistance);
+            ClosestDistance = C_Select4(Closer, Distance, ClosestDistance);
+            ClosestX = C_Select4(Closer, VerticesX[v], ClosestX);
+            ClosestY = C_Select4(Closer, VerticesY[v], ClosestY);
+        }
+
+        __m128 AxisX = _mm_sub_ps(ClosestX, CenterX);
+        __m128 AxisY = _mm_sub_ps(ClosestY, CenterY);
+        C_Normalize4(&AxisX, &AxisY);
+
+        __m128 CircleCenter = _mm_add_ps(_mm_mul_ps(CenterX, AxisX), _mm_mul_ps(CenterY, AxisY));
+        __m128 CircleMin = _mm_sub_ps(CircleCenter, Radius);
+        __m128 CircleMax = _mm_add_ps(CircleCenter, Radius);
+
+        __m128 RectMin, RectMax;
+        C_Project4(VerticesX, VerticesY, AxisX, AxisY, &RectMin, &RectMax);
+
+        __m128 Overlapping = _mm_and_ps(_mm_cmple_ps(CircleMin, RectMax), _mm_cmple_ps(RectMin, CircleMax));
+        Colliding = _mm_and_ps(Colliding, Overlapping);
+
+        __m128 Overlap = C_GetOverlap4(RectMin, RectMax, CircleMin, CircleMax);
+        __m128 Smaller = _mm_cmplt_ps(Overlap, SmallestOverlap);
+
+        __m128 Flip = _mm_and_ps(_mm_cmplt_ps(RectMin, CircleMin), _mm_set1_ps(-0.0f));
+        AxisX = _mm_xor_ps(AxisX, Flip);
+        AxisY = _mm_xor_ps(AxisY, Flip);
+
+        SmallestOverlap = C_Select4(Smaller, Overlap, SmallestOverlap);
+        SmallestX = C_Select4(Smaller, AxisX, SmallestX);
+        SmallestY = C_Select4(Smaller, AxisY, SmallestY);
+    }
+
+    C_StoreResults4(Batch, Indices, LaneCount, Colliding, SmallestX, SmallestY, SmallestOverlap);
+}
+
+// SIMD version of C_CollisionCircleCircle
+void C_BatchCircleCircle(collision_batch *Batch, u32 *Indices, u32 LaneCount)
+{
+    circle *A[4];
+    circle *B[4];
+    for(u32 i = 0; i < 4; i++)
+    {
+        collision_pair *Pair = &Batch->Pairs[Indices[i < LaneCount ? i : LaneCount - 1]];
+        A[i] = &Pair->A->Circle;
+        B[i] = &Pair->B->Circle;
+    }
+
+    circle **Lane = A;
+    __m128 AX = C_Lanes(Center.x);
+    __m128 AY = C_Lanes(Center.y);
+    __m128 RadiiSum = C_Lanes(Radius);
+    Lane = B;
+    __m128 BX = C_Lanes(Center.x);
+    __m128 BY = C_Lanes(Center.y);
+    RadiiSum = _mm_add_ps(RadiiSum, C_Lanes(Radius));
+
+    __m128 DeltaX = _mm_sub_ps(AX, BX);
+    __m128 DeltaY = _mm_sub_ps(AY, BY);
+    __m128 DistanceBetween = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(DeltaX, DeltaX), _mm_mul_ps(DeltaY, DeltaY)));
+
+    __m128 Colliding = _mm_cmplt_ps(DistanceBetween, RadiiSum);
+    __m128 Overlap = C_Abs4(_mm_sub_ps(RadiiSum, DistanceBetween));
+    C_Normalize4(&DeltaX, &DeltaY);
+
+    C_StoreResults4(Batch, Indices, LaneCount, Colliding, DeltaX, DeltaY, Overlap);
+}
+
+#undef C_Lanes
+
+#endif // COLLISION_SIMD
+
+// Reference path, one C_Collision call per pair
+void C_BatchRunScalar(collision_batch *Batch)
+{
+    Assert(Batch);
+
+    for(u32 i = 0; i < Batch->Count; i++)
+    {
+        collision_pair *Pair = &Batch->Pairs[i];
+        collision_result *Result = &Batch->Results[i];
+        Result->Colliding = C_Collision(Pair->A, Pair->B, &Result->ResolutionDirection, &Result->ResolutionOverlap);
+        if(!Result->Colliding)
+        {
+            Result->ResolutionDirection = {};
+            Result->ResolutionOverlap = 0.0f;
+        }
+    }
+}
+
+// Checks the batched results against the reference path, results must
+// agree on every collision and be within Epsilon on direction and
+// overlap. Returns the number of mismatching pairs.
+u32 C_ValidateCollisionBatch(collision_batch *Batch, f32 Epsilon)
+{
+    Assert(Batch);
+
+    u32 Result = 0;
+    for(u32 i = 0; i < Batch->Count; i++)
+    {
+        collision_pair *Pair = &Batch->Pairs[i];
+        collision_result *Batched = &Batch->Results[i];
+
+        glm::vec2 Direction;
+        f32 Overlap;
+        b32 Colliding = C_Collision(Pair->A, Pair->B, &Direction, &Overlap);
+
+        if(Colliding != Batched->Colliding ||
+           (Colliding && (Abs(Overlap - Batched->ResolutionOverlap) > Epsilon ||
+                          Abs(Direction.x - Batched->ResolutionDirection.x) > Epsilon ||
+                          Abs(Direction.y - Batched->ResolutionDirection.y) > Epsilon)))
+        {
+            printf("C_ValidateCollisionBatch: Pair %d does not match the reference, types %d %d\n", i, Pair->A->Type, Pair->B->Type);
+            Result++;
+        }
+    }
+
+    return (Result);
+}
+
+void C_BatchRun(collision_batch *Batch)
+{
+    Assert(Batch);
+
+#if COLLISION_SIMD
+    Batch->RectangleRectangleCount = 0;
+    Batch->RectangleCircleCount = 0;
+    Batch->CircleCircleCount = 0;
+
+    // Bucket by shape pair type, the bounds test is cheap enough to
+    // do here and most pairs stop at it.
+    for(u32 i = 0; i < Batch->Count; i++)
+    {
+        collision_pair *Pair = &Batch->Pairs[i];
+        if(!C_BoundsOverlap(Pair->A, Pair->B))
+        {
+            collision_result *Result = &Batch->Results[i];
+            Result->Colliding = false;
+            Result->ResolutionDirection = {};
+            Result->ResolutionOverlap = 0.0f;
+            continue;
+        }
+
+        collider_type TypeA = Pair->A->Type;
+        collider_type TypeB = Pair->B->Type;
+        if(TypeA == Collider_Rectangle && TypeB == Collider_Rectangle)
+        {
+            Batch->RectangleRectangle[Batch->RectangleRectangleCount++] = i;
+        }
+        else if(TypeA == Collider_Circle && TypeB == Collider_Circle)
+        {
+            Batch->CircleCircle[Batch->CircleCircleCount++] = i;
+        }
+        else
+        {
+            Assert((TypeA == Collider_Rectangle && TypeB == Collider_Circle) ||
+                   (TypeA == Collider_Circle && TypeB == Collider_Rectangle));
+            Batch->RectangleCircle[Batch->RectangleCircleCount++] = i;
+        }
+    }
+
+    for(u32 i = 0; i < Batch->RectangleRectangleCount; i += 4)
+    {
+        u32 LaneCount = Batch->RectangleRectangleCount - i < 4 ? Batch->RectangleRectangleCount - i : 4;
+        C_BatchRectangleRectangle(Batch, &Batch->RectangleRectangle[i], LaneCount);
+    }
+    for(u32 i = 0; i < Batch->RectangleCircleCount; i += 4)
+    {
+        u32 LaneCount = Batch->RectangleCircleCount - i < 4 ? Batch->RectangleCircleCount - i : 4;
+        C_BatchRectangleCircle(Batch, &Batch->RectangleCircle[i], LaneCount);
+    }
+    for(u32 i = 0; i < Batch->CircleCircleCount; i += 4)
+    {
+        u32 LaneCount = Batch->CircleCircleCount - i < 4 ? Batch->CircleCircleCount - i : 4;
+        C_BatchCircleCircle(Batch, &Batch->CircleCircle[i], LaneCount);
+    }
+
+#else
+    C_BatchRunScalar(Batch);
+#endif
+}
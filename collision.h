@@ -14,7 +14,7 @@ struct rectangle
     glm::vec2 Center;
     f32 HalfWidth;
     f32 HalfHeight;
-    f32 Angle;
+    glm::vec2 Rotation; // (cos, sin), see RotationFromAngle
 };
 
 struct circle
@@ -23,6 +23,13 @@ struct circle
     f32 Radius;
 };
 
+// World space vertices and normalized SAT axes of a rectangle
+struct rectangle_collision_data
+{
+    glm::vec2 Vertices[4];
+    glm::vec2 SeparationAxes[2];
+};
+
 struct collider
 {
     collider_type Type;
@@ -31,19 +38,87 @@ struct collider
         rectangle Rectangle;
         circle Circle;
     };
+
+    // Derived data, C_UpdateCollider refreshes it after the shape
+    // changes. Every C_Collision call reads it instead of rebuilding
+    // the shape from scratch.
+    rectangle_collision_data RectangleData; // Only valid for Collider_Rectangle
+    glm::vec2 AABBMin;
+    glm::vec2 AABBMax;
+    f32 BoundingRadius;
 };
 
 
 // TODO(Jorge): Refactor away these 2 remaining structs
-struct rectangle_collision_data
-{
-    glm::vec2 Vertices[4];
-    glm::vec2 SeparationAxes[2];
-};
-
 struct obb_projection_result
 {
     f32 Min;
     f32 Max;
     glm::vec2 Axis;
 };
+
+// Uniform grid broadphase. Items are bucketed by the cell of their
+// center and sorted by cell with a counting sort every time the grid
+// is rebuilt (C_GridBegin, C_GridInsert..., C_GridEnd). Positions
+// outside of the grid bounds are clamped to the border cells, so the
+// grid only needs to cover the play area.
+struct collision_grid
+{
+    glm::vec2 Min;
+    f32 CellSize;
+    f32 InverseCellSize;
+    i32 CellsX;
+    i32 CellsY;
+
+    u32 *CellStart; // CellsX * CellsY + 1 entries, items of cell C are SortedIds[CellStart[C]..CellStart[C + 1])
+    u32 *SortedIds;
+
+    // Inserted items in insertion order, used by C_GridEnd
+    u32 *ItemIds;
+    u32 *ItemCells;
+    f32 MaxRadius; // Biggest radius inserted since the last C_GridBegin
+
+    u32 Count;
+    u32 Capacity;
+
+    // Output of C_GridQuery, holds at most Count ids
+    u32 *QueryIds;
+};
+
+// Batched narrowphase. Pairs are added with C_BatchAddPair and tested
+// all at once by C_BatchRun, which buckets them by shape pair type and
+// runs each bucket through a 4 wide SSE kernel. Results[i] is the
+// outcome of Pairs[i], the same values C_Collision would return.
+struct collision_pair
+{
+    collider *A;
+    collider *B;
+
+    // Caller data, the batch does not touch them
+    u32 IdA;
+    u32 IdB;
+};
+
+struct collision_result
+{
+    b32 Colliding;
+    glm::vec2 ResolutionDirection;
+    f32 ResolutionOverlap;
+};
+
+struct collision_batch
+{
+    u32 Count;
+    u32 Capacity;
+    collision_pair *Pairs;
+    collision_result *Results;
+
+    // Scratch, indices into Pairs bucketed by shape pair type. Pairs
+    // whose bounds do not overlap are resolved while bucketing.
+    u32 *RectangleRectangle;
+    u32 *RectangleCircle; // Either collider of the pair may be the rectangle
+    u32 *CircleCircle;
+    u32 RectangleRectangleCount;
+    u32 RectangleCircleCount;
+    u32 CircleCircleCount;
+};
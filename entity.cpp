@@ -5,27 +5,34 @@
 
 b32 E_EntitiesCollide(entity *A, entity *B, glm::vec2 *ResolutionDirection, f32 *ResolutionOverlap)
 {
-    return C_Collision(A->Collider, B->Collider, ResolutionDirection, ResolutionOverlap);
+    return C_Collision(&A->Collider, &B->Collider, ResolutionDirection, ResolutionOverlap);
 }
 
-entity *E_CreateEntity(texture *Texture,
-                       glm::vec3 Position,
-                       glm::vec3 Direction,
-                       glm::vec3 Size,
-                       f32 RotationAngle,
-                       f32 Speed,
-                       f32 Drag,
-                       entity_type EntityType,
-                       collider_type ColliderType)
+// Fills an entity in place, used by E_MakeEntity and E_CreateEntity
+// so that entities stored inside an entity_list do not need their own
+// allocation.
+void E_InitEntity(entity *Result,
+                  texture *Texture,
+                  glm::vec3 Position,
+                  glm::vec3 Direction,
+                  glm::vec3 Size,
+                  glm::vec2 Rotation,
+                  f32 Speed,
+                  f32 Drag,
+                  entity_type EntityType,
+                  collider_type ColliderType)
 {
-    entity *Result = (entity*)Malloc(sizeof(entity)); Assert(Result);
+    Assert(Result);
 
     Result->Texture = Texture;
     Result->Position = Position;
     Result->Direction = glm::normalize(Direction); // TODO(Jorge): LA direccion es el vector desde posicion hasta el jugador
     Result->Size = Size;
+    Result->Velocity = glm::vec3(0.0f);
     Result->Acceleration = glm::vec3(0.0f);
-    Result->Angle = RotationAngle;
+    Result->Rotation = Rotation;
+    Result->PreviousPosition = Position;
+    Result->PreviousRotation = Rotation;
     Result->Speed = Speed;
     Result->Drag = Drag;
     Result->Type = EntityType;
@@ -42,7 +49,7 @@ entity *E_CreateEntity(texture *Texture,
             Result->Collider.Rectangle.Center = glm::vec2(Position.x, Position.y);
             Result->Collider.Rectangle.HalfWidth = Size.x * 0.5f;
             Result->Collider.Rectangle.HalfHeight = Size.y * 0.5f;
-            Result->Collider.Rectangle.Angle = RotationAngle;
+            Result->Collider.Rectangle.Rotation = Rotation;
             break;
         }
         case Collider_Circle:
@@ -75,37 +82,78 @@ entity *E_CreateEntity(texture *Texture,
         }
     }
 
+    C_UpdateCollider(&Result->Collider);
+}
+
+// Returns the entity by value, meant to be pushed into an entity_list
+entity E_MakeEntity(texture *Texture,
+                    glm::vec3 Position,
+                    glm::vec3 Direction,
+                    glm::vec3 Size,
+                    glm::vec2 Rotation,
+                    f32 Speed,
+                    f32 Drag,
+                    entity_type EntityType,
+                    collider_type ColliderType)
+{
+    entity Result = {};
+    E_InitEntity(&Result, Texture, Position, Direction, Size, Rotation, Speed, Drag, EntityType, ColliderType);
+
     return (Result);
 }
 
-void E_Update(entity *Entity, f32 TimeStep)
+// Heap allocates a standalone entity (Player, Walls, Screens, etc)
+entity *E_CreateEntity(texture *Texture,
+                       glm::vec3 Position,
+                       glm::vec3 Direction,
+                       glm::vec3 Size,
+                       glm::vec2 Rotation,
+                       f32 Speed,
+                       f32 Drag,
+                       entity_type EntityType,
+                       collider_type ColliderType)
 {
-    Entity->Position = 0.5f * Entity->Acceleration * (TimeStep * TimeStep) + Entity->Velocity + Entity->Position;
-    Entity->Velocity = Entity->Acceleration * TimeStep + Entity->Velocity;
-    Entity->Acceleration = {};
-    Entity->Velocity *= Entity->Drag;
+    entity *Result = (entity*)Malloc(sizeof(entity)); Assert(Result);
+    E_InitEntity(Result, Texture, Position, Direction, Size, Rotation, Speed, Drag, EntityType, ColliderType);
 
-    // Do not allow negative size
-    if(Entity->Size.x < 0.0f) Entity->Size.x = 0.0f;
-    if(Entity->Size.y < 0.0f) Entity->Size.y = 0.0f;
-    if(Entity->Size.z < 0.0f) Entity->Size.z = 0.0f;
+    return (Result);
+}
 
-    // Update collision Data
+// Update collision Data from the entity transform, the cached collider
+// data is only recomputed when the transform actually changed
+void E_UpdateColliderTransform(entity *Entity)
+{
+    b32 ColliderChanged = false;
     switch(Entity->Collider.Type)
     {
         case Collider_Rectangle:
         {
-            Entity->Collider.Rectangle.Center = glm::vec2(Entity->Position.x, Entity->Position.y);
-            Entity->Collider.Rectangle.Angle = Entity->Angle;
-            Entity->Collider.Rectangle.HalfWidth = Entity->Size.x * 0.5f;
-            Entity->Collider.Rectangle.HalfHeight = Entity->Size.y * 0.5f;
+            rectangle *Rectangle = &Entity->Collider.Rectangle;
+            glm::vec2 Center = glm::vec2(Entity->Position.x, Entity->Position.y);
+            f32 HalfWidth = Entity->Size.x * 0.5f;
+            f32 HalfHeight = Entity->Size.y * 0.5f;
+            if(Rectangle->Center != Center || Rectangle->Rotation != Entity->Rotation ||
+               Rectangle->HalfWidth != HalfWidth || Rectangle->HalfHeight != HalfHeight)
+            {
+                Rectangle->Center = Center;
+                Rectangle->Rotation = Entity->Rotation;
+                Rectangle->HalfWidth = HalfWidth;
+                Rectangle->HalfHeight = HalfHeight;
+                ColliderChanged = true;
+            }
             break;
         }
         case Collider_Circle:
         {
-            Entity->Collider.Circle.Center.x = Entity->Position.x;
-            Entity->Collider.Circle.Center.y = Entity->Position.y;
-            Entity->Collider.Circle.Radius = Entity->Size.x * 0.5f;
+            circle *Circle = &Entity->Collider.Circle;
+            glm::vec2 Center = glm::vec2(Entity->Position.x, Entity->Position.y);
+            f32 Radius = Entity->Size.x * 0.5f;
+            if(Circle->Center != Center || Circle->Radius != Radius)
+            {
+                Circle->Center = Center;
+                Circle->Radius = Radius;
+                ColliderChanged = true;
+            }
             break;
         }
         default:
@@ -115,123 +163,277 @@ void E_Update(entity *Entity, f32 TimeStep)
             break;
         }
     }
+
+    if(ColliderChanged)
+    {
+        C_UpdateCollider(&Entity->Collider);
+    }
+}
+
+// Called at the start of every simulation tick, before anything moves
+void E_SavePreviousTransform(entity *Entity)
+{
+    Entity->PreviousPosition = Entity->Position;
+    Entity->PreviousRotation = Entity->Rotation;
+}
+
+// Drag is the fraction of the velocity kept every 1/60 of a second,
+// rescaled to the timestep so it does not depend on the tick rate
+global f32 DragReferenceRate = 60.0f;
+
+// Velocity and acceleration are in units per second
+void E_Update(entity *Entity, f32 TimeStep)
+{
+    Entity->Position = 0.5f * Entity->Acceleration * (TimeStep * TimeStep) + Entity->Velocity * TimeStep + Entity->Position;
+    Entity->Velocity = Entity->Acceleration * TimeStep + Entity->Velocity;
+    Entity->Acceleration = {};
+    if(Entity->Drag != 1.0f)
+    {
+        Entity->Velocity *= powf(Entity->Drag, TimeStep * DragReferenceRate);
+    }
+
+    // Do not allow negative size
+    if(Entity->Size.x < 0.0f) Entity->Size.x = 0.0f;
+    if(Entity->Size.y < 0.0f) Entity->Size.y = 0.0f;
+    if(Entity->Size.z < 0.0f) Entity->Size.z = 0.0f;
+
+    E_UpdateColliderTransform(Entity);
+}
+
+// Marks the end of the free slot list
+global u32 EntityNullSlot = 0xFFFFFFFF;
+
+// Links slots [First, Last) into the free list, in order
+void E_LinkFreeSlots(entity_list *List, u32 First, u32 Last)
+{
+    for(u32 i = First; i < Last; i++)
+    {
+        List->Slots[i].NextFree = (i + 1 < Last) ? i + 1 : List->FreeSlot;
+    }
+    if(First < Last)
+    {
+        List->FreeSlot = First;
+    }
 }
 
-entity_list *E_CreateEntityList(u32 MaxEntityCount)
+entity_list *E_CreateEntityList(u32 InitialCapacity)
 {
-    Assert(MaxEntityCount > 0);
+    Assert(InitialCapacity > 0);
 
     entity_list *Result = NULL;
     Result = (entity_list*)Malloc(sizeof(entity_list)); Assert(Result);
 
     Result->Count = 0;
-    Result->MaxCount = MaxEntityCount;
-    Result->Head = NULL;
-    Result->Tail = NULL;
+    Result->Capacity = InitialCapacity;
+    Result->Entities = (entity*)Malloc(sizeof(entity) * InitialCapacity); Assert(Result->Entities);
+    Result->Slots = (entity_slot*)Malloc(sizeof(entity_slot) * InitialCapacity); Assert(Result->Slots);
+    Result->KillQueue = (entity_handle*)Malloc(sizeof(entity_handle) * InitialCapacity); Assert(Result->KillQueue);
+    Result->KillCount = 0;
+
+    for(u32 i = 0; i < InitialCapacity; i++)
+    {
+        Result->Slots[i].Generation = 1;
+    }
+    Result->FreeSlot = EntityNullSlot;
+    E_LinkFreeSlots(Result, 0, InitialCapacity);
 
     return Result;
 }
 
-// Always pushes an entity to the back of the list
-void E_PushEntity(entity_list *List, entity *Entity)
+// Returns NULL when the handle is stale, the entity it referred to was
+// destroyed (or the list was emptied) since the handle was taken.
+entity *E_GetEntity(entity_list *List, entity_handle Handle)
 {
-    Assert(Entity);
     Assert(List);
 
-    // Create the Node
-    entity_node *Node = (entity_node*)Malloc(sizeof(entity_node)); Assert(Node);
-    Node->Entity = Entity;
-    Node->Next = NULL;
-    Node->Previous = NULL;
+    if(Handle.Index < List->Capacity &&
+       List->Slots[Handle.Index].Generation == Handle.Generation)
+    {
+        return &List->Entities[List->Slots[Handle.Index].DenseIndex];
+    }
+
+    return NULL;
+}
+
+b32 E_IsAlive(entity_list *List, entity_handle Handle)
+{
+    entity *Entity = E_GetEntity(List, Handle);
+    return Entity != NULL && !Entity->Killed;
+}
 
-    if(List->Count < List->MaxCount)
+// Copies the entity to the back of the list and returns a pointer to
+// the stored copy. The pointer is only valid until the next push or
+// flush, since both can move entities around. Keep Result->Handle
+// instead if the entity needs to be found later.
+entity *E_PushEntity(entity_list *List, entity Entity)
+{
+    Assert(List);
+
+    if(List->Count == List->Capacity)
     {
-        // It's the first node on the list
-        if(List->Count == 0)
-        {
-            List->Head = Node;
-            List->Tail = Node;
-            List->Count++;
-        }
-        else
+        // List is full, double the capacity
+        u32 OldCapacity = List->Capacity;
+        u32 NewCapacity = OldCapacity * 2;
+
+        entity *NewEntities = (entity*)Realloc(List->Entities, sizeof(entity) * NewCapacity); Assert(NewEntities);
+        entity_slot *NewSlots = (entity_slot*)Realloc(List->Slots, sizeof(entity_slot) * NewCapacity); Assert(NewSlots);
+        entity_handle *NewKillQueue = (entity_handle*)Realloc(List->KillQueue, sizeof(entity_handle) * NewCapacity); Assert(NewKillQueue);
+        List->Entities = NewEntities;
+        List->Slots = NewSlots;
+        List->KillQueue = NewKillQueue;
+        List->Capacity = NewCapacity;
+
+        for(u32 i = OldCapacity; i < NewCapacity; i++)
         {
-            Node->Previous = List->Tail;
-            List->Tail->Next = Node;
-            List->Tail = Node;
-            List->Count++;
+            List->Slots[i].Generation = 1;
         }
+        E_LinkFreeSlots(List, OldCapacity, NewCapacity);
     }
-    else
+
+    // Take a slot from the free list
+    u32 SlotIndex = List->FreeSlot;
+    Assert(SlotIndex != EntityNullSlot);
+    entity_slot *Slot = &List->Slots[SlotIndex];
+    List->FreeSlot = Slot->NextFree;
+    Slot->DenseIndex = List->Count;
+
+    entity *Result = &List->Entities[List->Count++];
+    *Result = Entity;
+    Result->Handle.Index = SlotIndex;
+    Result->Handle.Generation = Slot->Generation;
+    Result->Killed = false;
+
+    return (Result);
+}
+
+// Invalidates every handle to the slot and gives it back to the free list
+void E_FreeSlot(entity_list *List, u32 SlotIndex)
+{
+    entity_slot *Slot = &List->Slots[SlotIndex];
+    Slot->Generation++;
+    if(Slot->Generation == 0)
     {
-        printf("List is full, List->Count >= List->MaxCount\n");
-        Free(Node);
-        Free(Entity);
+        // Never hand out generation 0, zeroed handles must stay dead
+        Slot->Generation = 1;
     }
+    Slot->NextFree = List->FreeSlot;
+    List->FreeSlot = SlotIndex;
 }
 
-void E_FreeNode(entity_list *List, entity_node *Node)
+// O(1) immediate removal, the last entity of the list is moved into
+// Index. Do not call this while iterating the list, use E_KillEntity.
+void E_RemoveEntity(entity_list *List, u32 Index)
 {
     Assert(List);
-    Assert(Node);
+    Assert(Index < List->Count);
 
-    // TODO(Joreg): Rearrange items in order of most likely to improve performance
+    E_FreeSlot(List, List->Entities[Index].Handle.Index);
 
-    if(List->Count == 0)
+    u32 Last = List->Count - 1;
+    if(Index != Last)
     {
-        // List is empty, no item to free
-        return;
+        List->Entities[Index] = List->Entities[Last];
+        List->Slots[List->Entities[Index].Handle.Index].DenseIndex = Index;
     }
-    else if(List->Count == 1)
+    List->Count--;
+}
+
+// Queues the entity for destruction, it stays in the list (flagged as
+// Killed) until the next E_FlushKills. Killing twice is harmless.
+void E_KillEntity(entity_list *List, entity_handle Handle)
+{
+    Assert(List);
+
+    entity *Entity = E_GetEntity(List, Handle);
+    if(Entity && !Entity->Killed)
     {
-        // Its the only node
-        List->Head = NULL;
-        List->Tail = NULL;
-        List->Count--;
-        Free(Node->Entity);
-        Free(Node);
+        Entity->Killed = true;
+        List->KillQueue[List->KillCount++] = Handle;
     }
-    else if(Node->Next == NULL)
-    {
-        // Its the last node
-        List->Tail = Node->Previous;
-        List->Tail->Next = NULL;
-        List->Count--;
+}
 
-        Free(Node->Entity);
-        Free(Node);
-    }
-    else if(Node->Previous == NULL)
+// Removes every entity queued with E_KillEntity in a single
+// compaction sweep. The sweep keeps the order of the survivors and
+// starts at the lowest killed index, everything before it stays put.
+void E_FlushKills(entity_list *List)
+{
+    Assert(List);
+
+    if(List->KillCount == 0) { return; }
+
+    u32 FirstKilled = List->Count;
+    for(u32 i = 0; i < List->KillCount; i++)
     {
-        // Its the first node
-        List->Head = Node->Next;
-        List->Head->Previous = NULL;
-        List->Count--;
+        u32 DenseIndex = List->Slots[List->KillQueue[i].Index].DenseIndex;
+        if(DenseIndex < FirstKilled)
+        {
+            FirstKilled = DenseIndex;
+        }
+    }
 
-        Free(Node->Entity);
-        Free(Node);
+    u32 Write = FirstKilled;
+    for(u32 Read = FirstKilled; Read < List->Count; Read++)
+    {
+        entity *Entity = &List->Entities[Read];
+        if(Entity->Killed)
+        {
+            E_FreeSlot(List, Entity->Handle.Index);
+        }
+        else
+        {
+            if(Write != Read)
+            {
+                List->Entities[Write] = *Entity;
+                List->Slots[Entity->Handle.Index].DenseIndex = Write;
+            }
+            Write++;
+        }
     }
-    else
+
+    List->Count = Write;
+    List->KillCount = 0;
+}
+
+// Destroys every entity, all outstanding handles become stale
+void E_EmptyList(entity_list *List)
+{
+    Assert(List);
+
+    for(u32 i = 0; i < List->Count; i++)
     {
-        // Its somewhere in the middle
-        Node->Previous->Next = Node->Next;
-        Node->Next->Previous = Node->Previous;
-        List->Count--;
+        E_FreeSlot(List, List->Entities[i].Handle.Index);
+    }
 
-        Free(Node->Entity);
-        Free(Node);
+    List->Count = 0;
+    List->KillCount = 0;
+}
+
+// E_SavePreviousTransform for every entity of the list
+void E_SavePreviousTransforms(entity_list *List)
+{
+    for(u32 i = 0; i < List->Count; i++)
+    {
+        E_SavePreviousTransform(&List->Entities[i]);
     }
 }
 
-void E_EmptyList(entity_list *List)
+// Rebuilds the grid with every entity of the list that is not killed,
+// the ids stored in the grid are indices into List->Entities. They
+// stay valid until the next E_FlushKills or E_PushEntity.
+void E_BuildGrid(collision_grid *Grid, entity_list *List)
 {
-    if(List->Count == 0) { return; }
+    Assert(Grid);
+    Assert(List);
 
-    for(entity_node *Node = List->Head;
-        Node != NULL;
-        Node = Node->Next)
+    C_GridBegin(Grid);
+    for(u32 i = 0; i < List->Count; i++)
     {
-        E_FreeNode(List, Node);
+        entity *Entity = &List->Entities[i];
+        if(Entity->Killed) { continue; }
+
+        C_GridInsert(Grid, i, C_ColliderCenter(&Entity->Collider), C_BoundingRadius(&Entity->Collider));
     }
+    C_GridEnd(Grid);
 }
 
 void E_PrintEntityData(entity *Entity)
@@ -260,7 +462,7 @@ void E_PrintEntityData(entity *Entity)
       glm::vec3 Size;
 
       f32 Speed;
-      f32 Angle;
+      glm::vec2 Rotation;
       f32 Drag;
 
       entity_type Type;
@@ -274,6 +476,6 @@ void E_PrintEntityData(entity *Entity)
     printf("Acceleration: %.2f %.2f %.2f\n", Entity->Acceleration.x, Entity->Acceleration.y, Entity->Acceleration.z);
     printf("Direction: %.2f %.2f %.2f\n", Entity->Direction.x, Entity->Direction.y, Entity->Direction.z);
     printf("Size: %.2f %.2f %.2f\n", Entity->Size.x, Entity->Size.y, Entity->Size.z);
-    printf("Speed: %.2f\nAngle: %.2f\nDrag: %.2f\n", Entity->Speed, Entity->Angle, Entity->Drag);
+    printf("Speed: %.2f\nRotation: %.2f %.2f\nDrag: %.2f\n", Entity->Speed, Entity->Rotation.x, Entity->Rotation.y, Entity->Drag);
     printf("Collider: %d\n", Entity->Collider.Type);
 }
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "shared.h"
-#include "renderer.h"
 #include "collision.h"
 
+// Declared in renderer.h, entities only keep a pointer to it so the
+// simulation does not depend on GL
+struct texture;
+
 enum entity_type
 {
     EntityType_None = 0, // This is used for types that do not yet have a specific entity_type
@@ -16,6 +19,16 @@ enum entity_type
     EntityType_Wall
 };
 
+// Generational handle, the safe way to refer to an entity stored in
+// an entity_list across frames. Index selects a slot of the list,
+// Generation must match the slot generation for the handle to be
+// alive. A zeroed handle is never alive.
+struct entity_handle
+{
+    u32 Index;
+    u32 Generation;
+};
+
 struct entity
 {
     texture *Texture;
@@ -27,25 +40,47 @@ struct entity
     glm::vec3 Size;
 
     f32 Speed;
-    f32 Angle;
+    glm::vec2 Rotation; // (cos, sin), see RotationFromAngle
+
+    // Transform at the start of the current tick, the renderer
+    // interpolates from here to Position/Rotation
+    glm::vec3 PreviousPosition;
+    glm::vec2 PreviousRotation;
     f32 Drag;
 
     entity_type Type;
     collider Collider;
-};
 
+    entity_handle Handle; // Only set for entities stored in an entity_list
+    b32 Killed;           // Queued for destruction, removed at the end of the frame
+};
 
-struct entity_node
+struct entity_slot
 {
-    entity *Entity;
-    entity_node *Next;
-    entity_node *Previous;
+    u32 Generation; // Bumped every time the slot is freed, starts at 1
+    u32 DenseIndex; // Position of the entity inside Entities while the slot is alive
+    u32 NextFree;   // Next slot in the free list while the slot is free
 };
 
+
+// Dense, contiguous entity storage. Entities live by value inside
+// Entities[0..Count), removing an entity moves the last one into the
+// hole, so iteration order is not stable across removals. The array
+// grows (doubling) when full, there is no upper bound on Count.
+//
+// Slots map handles to the dense array, every array here has Capacity
+// elements. Systems do not remove entities while iterating, they call
+// E_KillEntity which appends to KillQueue, and E_FlushKills compacts
+// the list once per frame.
 struct entity_list
 {
     u32 Count;
-    u32 MaxCount;
-    entity_node *Head;
-    entity_node *Tail;
+    u32 Capacity;
+    entity *Entities;
+
+    entity_slot *Slots;
+    u32 FreeSlot; // Head of the free slot list, EntityNullSlot when empty
+
+    u32 KillCount;
+    entity_handle *KillQueue;
 };
@@ -7,6 +7,7 @@
     APIs: gl=3.3
     Profile: compatibility
     Extensions:
+        GL_ARB_get_program_binary,
         GL_NV_path_rendering
     Loader: True
     Local files: False
@@ -14,9 +15,9 @@
     Reproducible: False
 
     Commandline:
-        --profile="compatibility" --api="gl=3.3" --generator="c" --spec="gl" --extensions="GL_NV_path_rendering"
+        --profile="compatibility" --api="gl=3.3" --generator="c" --spec="gl" --extensions="GL_ARB_get_program_binary,GL_NV_path_rendering"
     Online:
-        https://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D3.3&extensions=GL_NV_path_rendering
+        https://glad.dav1d.de/#profile=compatibility&language=c&specification=gl&loader=on&api=gl%3D3.3&extensions=GL_ARB_get_program_binary&extensions=GL_NV_path_rendering
 */
 
 #include <stdio.h>
@@ -991,7 +992,11 @@ PFNGLWINDOWPOS3IPROC glad_glWindowPos3i = NULL;
 PFNGLWINDOWPOS3IVPROC glad_glWindowPos3iv = NULL;
 PFNGLWINDOWPOS3SPROC glad_glWindowPos3s = NULL;
 PFNGLWINDOWPOS3SVPROC glad_glWindowPos3sv = NULL;
+int GLAD_GL_ARB_get_program_binary = 0;
 int GLAD_GL_NV_path_rendering = 0;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = NULL;
 PFNGLGENPATHSNVPROC glad_glGenPathsNV = NULL;
 PFNGLDELETEPATHSNVPROC glad_glDeletePathsNV = NULL;
 PFNGLISPATHNVPROC glad_glIsPathNV = NULL;
@@ -1838,6 +1843,12 @@ static void load_GL_VERSION_3_3(GLADloadproc load) {
 	glad_glSecondaryColorP3ui = (PFNGLSECONDARYCOLORP3UIPROC)load("glSecondaryColorP3ui");
 	glad_glSecondaryColorP3uiv = (PFNGLSECONDARYCOLORP3UIVPROC)load("glSecondaryColorP3uiv");
 }
+static void load_GL_ARB_get_program_binary(GLADloadproc load) {
+	if(!GLAD_GL_ARB_get_program_binary) return;
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+}
 static void load_GL_NV_path_rendering(GLADloadproc load) {
 	if(!GLAD_GL_NV_path_rendering) return;
 	glad_glGenPathsNV = (PFNGLGENPATHSNVPROC)load("glGenPathsNV");
@@ -1926,6 +1937,7 @@ static void load_GL_NV_path_rendering(GLADloadproc load) {
 }
 static int find_extensionsGL(void) {
 	if (!get_exts()) return 0;
+	GLAD_GL_ARB_get_program_binary = has_ext("GL_ARB_get_program_binary");
 	GLAD_GL_NV_path_rendering = has_ext("GL_NV_path_rendering");
 	free_exts();
 	return 1;
@@ -2005,6 +2017,7 @@ int gladLoadGLLoader(GLADloadproc load) {
 	load_GL_VERSION_3_3(load);
 
 	if (!find_extensionsGL()) return 0;
+	load_GL_ARB_get_program_binary(load);
 	load_GL_NV_path_rendering(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
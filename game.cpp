@@ -0,0 +1,434 @@
+#pragma once
+
+/*
+  The game simulation, everything State_Game does in a tick. It does
+  not touch SDL, GL or the sound system so it is shared by main.cpp
+  and the headless build in headless.cpp. Sounds, camera and bloom
+  changes are reported through game_events instead.
+*/
+
+#include "shared.h"
+#include "game.h"
+#include "entity.h"
+#include "collision.h"
+
+global gamestate CurrentState;
+global u32 GameTick = 0; // Ticks simulated since GameBegin, the game time is GameTick * TimeStep
+
+// Textures of the entities the simulation creates, loaded by
+// main.cpp, the headless build leaves them NULL
+global texture *PlayerTexture      = NULL;
+global texture *WallTexture        = NULL;
+global texture *BulletTexture      = NULL;
+global texture *WandererTexture    = NULL;
+global texture *SeekerTexture      = NULL;
+global texture *KamikazeTexture    = NULL;
+
+// Game Variables
+global f32 WorldBottom      = -11.0f;
+global f32 WorldTop         = 11.0f;
+global f32 WorldLeft        = -20.0f;
+global f32 WorldRight       = 20.0f;
+global f32 HalfWorldWidth   = WorldRight;
+global f32 HalfWorldHeight  = WorldTop;
+global f32 WorldWidth       = WorldRight * 2.0f;
+global f32 WorldHeight      = WorldTop * 2.0f;
+global f32 BackgroundWidth  = WorldWidth + 5.0f;
+global f32 BackgroundHeight = WorldHeight + 5.0f;
+global u32 PlayerScore      = 0;
+global f32 EnemySpawnsPerSecond = 0.5f; // Average, for each enemy type
+global f32 BulletSpeed      = 20.0f;
+global f32 WandererTurnRate = 24.0f; // Degrees per second
+global glm::vec2 WandererSpin = RotationIdentity; // Wanderer turn per tick, set in GameBegin
+global f64 SimulationTickRate = 60.0; // Fixed simulation rate, independent of the frame rate
+global entity *LeftWall     = NULL;
+global entity *RightWall    = NULL;
+global entity *TopWall      = NULL;
+global entity *BottomWall   = NULL;
+
+// Bullet and enemies containers, the lists grow past this as needed
+u32 InitialEntityCapacity = 128;
+entity_list *Enemies = NULL;
+entity_list *Bullets = NULL;
+
+// Broadphase, rebuilt with the enemies every frame before the collision passes
+global f32 EnemyGridCellSize  = 2.0f;
+global f32 EnemyGridPadding   = 4.0f; // Kamikazes spawn a bit outside of the world
+collision_grid *EnemyGrid     = NULL;
+collision_batch *BulletBatch  = NULL; // Candidate Bullet vs Enemy pairs found by the grid
+
+// Player vars
+global entity *Player                  = NULL;
+global f32 PlayerSpeed                 = 180.0f; // Acceleration, units per second squared
+global f32 PlayerDrag                  = 0.8f;
+global u32 PlayerLives                 = 10;
+global glm::vec3 PlayerInitialPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+
+void SpawnSeeker(entity_list *List)
+{
+    f32 PosX = RandomBetween(WorldLeft, WorldRight);
+    f32 PosY = RandomBetween(WorldBottom, WorldTop);
+    E_PushEntity(List, E_MakeEntity(SeekerTexture, glm::vec3(PosX, PosY, 0.0f), glm::vec3(0), glm::vec3(1.0f), RotationIdentity, 120.0f, 0.8f, EntityType_Seeker, Collider_Rectangle));
+}
+
+void SpawnWanderer(entity_list *List)
+{
+    f32 PosX = RandomBetween(WorldLeft, WorldRight);
+    f32 PosY = RandomBetween(WorldBottom, WorldTop);
+    E_PushEntity(List, E_MakeEntity(WandererTexture, glm::vec3(PosX, PosY, 0.0f), glm::vec3(0), glm::vec3(1.0f), RotationIdentity, 0.0f, 1.0f, EntityType_Wanderer, Collider_Rectangle));
+}
+
+void SpawnKamikaze(entity_list *List)
+{
+    // Spawns an enemy that flies directly to the player position.
+
+    f32 PosX = 0;
+    f32 PosY = 0;
+    f32 Padding = 3.0f;
+
+    // Random PosX
+    if(RandomBool())
+    {
+        // Left
+        PosX = RandomBetween(WorldLeft - Padding, WorldLeft);
+    }
+    else
+    {
+        // Right
+        PosX = RandomBetween(WorldRight, WorldRight + Padding);
+    }
+
+    // Random  PosY
+    if(RandomBool())
+    {
+        // Top
+        PosY = RandomBetween(WorldTop, WorldTop + Padding);
+    }
+    else
+    {
+        // Bottom
+        PosY = RandomBetween(WorldBottom - Padding, WorldBottom);
+    }
+
+    glm::vec3 KamikazePosition = {PosX, PosY, 0.0f};
+    glm::vec2 KamikazeRotation = RotationFromDirection(glm::vec2(Player->Position - KamikazePosition));
+    f32 KamikazeSpeed = 300.0f;
+    E_PushEntity(List, E_MakeEntity(KamikazeTexture, KamikazePosition,
+                                    Player->Position - KamikazePosition,
+                                    glm::vec3(1.0f, 1.0f, 0.0f), KamikazeRotation, KamikazeSpeed, 0.8f,
+                                    EntityType_Kamikaze, Collider_Rectangle));
+}
+
+void SpawnEnemies(f32 TimeStep)
+{
+    // Rolled once per tick, so the spawn rate does not depend on the
+    // frame rate
+    f32 SpawnChance = EnemySpawnsPerSecond * TimeStep;
+    if(RandomBetween(0.0f, 1.0f) < SpawnChance)
+    {
+        SpawnSeeker(Enemies);
+    }
+    if(RandomBetween(0.0f, 1.0f) < SpawnChance)
+    {
+        SpawnKamikaze(Enemies);
+    }
+    if(RandomBetween(0.0f, 1.0f) < SpawnChance)
+    {
+        SpawnWanderer(Enemies);
+    }
+}
+
+void ApplyEnemyInputs(f32 TimeStep, f32 Time)
+{
+    // Enemy AI
+    // Set "inputs" according to enemy type, i can't figure out a better place to put the enemy AI and i'm not gonna think too much about it
+    for(u32 i = 0; i < Enemies->Count; i++)
+    {
+        entity *Entity = &Enemies->Entities[i];
+
+        switch(Entity->Type)
+        {
+            case EntityType_Seeker:
+            {
+                // Face the player, and move towards the player
+                Entity->Rotation = RotationFromDirection(glm::vec2(Player->Position - Entity->Position));
+                Entity->Acceleration += glm::vec3(Entity->Rotation, 0.0f) * Entity->Speed;
+            } break;
+            case EntityType_Wanderer:
+            {
+                f32 X = Cosf(Time);
+                f32 Y = Sinf(Time);
+                Entity->Position.x += X * TimeStep * 3.0f;
+                Entity->Position.y += Y * TimeStep * 3.0f;
+                Entity->Rotation = RotationMultiply(Entity->Rotation, WandererSpin);
+            } break;
+            case EntityType_Kamikaze:
+            {
+                Entity->Acceleration += glm::normalize(Entity->Direction) * Entity->Speed;
+                break;
+            }
+            case EntityType_Pickup:
+            case EntityType_Bullet:
+            case EntityType_None:
+            case EntityType_Wall:
+            case EntityType_Player:
+            default:
+            {
+                InvalidCodePath;
+                break;
+            }
+        }
+    }
+}
+
+void UpdateEnemyPositions(f32 TimeStep)
+{
+    for(u32 i = 0; i < Enemies->Count; i++)
+    {
+        entity *Entity = &Enemies->Entities[i];
+        E_Update(Entity, TimeStep);
+
+        if(Entity->Type == EntityType_Kamikaze && Magnitude(Entity->Position) > 30.0f)
+        {
+            E_KillEntity(Enemies, Entity->Handle);
+        }
+    }
+}
+
+void UpdateBulletPositions(f32 TimeStep)
+{
+    for(u32 i = 0; i < Bullets->Count; i++)
+    {
+        entity *Entity = &Bullets->Entities[i];
+        E_Update(Entity, TimeStep);
+
+        // If the bullet is no longer near the play
+        // area, delete this. Maybe later just checked
+        // square distances to avoid a sqrt.
+        if(Magnitude(Entity->Position) > 30.0f)
+        {
+            E_KillEntity(Bullets, Entity->Handle);
+        }
+    }
+}
+
+void UpdatePlayerPosition(game_input *Input, f32 TimeStep)
+{
+    Player->Acceleration.x += Input->Move.x * Player->Speed;
+    Player->Acceleration.y += Input->Move.y * Player->Speed;
+
+    // Rotate player according to mouse world position
+    Player->Rotation = RotationFromDirection(glm::vec2(Input->MouseWorldPosition - Player->Position));
+    E_Update(Player, TimeStep);
+}
+
+void FireBullet(glm::vec3 Target, game_events *Events)
+{
+    glm::vec2 BulletRotation = RotationFromDirection(glm::vec2(Target - Player->Position));
+    glm::vec3 BulletDirection = glm::normalize(Target - Player->Position);
+    f32 ScalingFactor = 3.5f;
+    entity *NewBullet = E_PushEntity(Bullets, E_MakeEntity(BulletTexture, Player->Position, glm::vec3(0.0f), glm::vec3(0.31f * ScalingFactor, 0.11f * ScalingFactor, 0.0f), BulletRotation, BulletSpeed, 1.0f, EntityType_Bullet, Collider_Rectangle));
+    NewBullet->Velocity = BulletDirection * BulletSpeed;
+    Events->BulletsFired++;
+}
+
+void AddExplosion(game_events *Events, entity *Entity)
+{
+    if(Events->ExplosionCount < GAME_MAX_EXPLOSIONS)
+    {
+        Events->Explosions[Events->ExplosionCount++] = {glm::vec2(Entity->Position), (u32)Entity->Type};
+    }
+}
+
+void CollisionPlayerVsWalls()
+{
+    glm::vec2 ResolutionDirection;
+    f32 ResolutionOverlap;
+
+    // Collision Player vs Walls
+    if(E_EntitiesCollide(Player, LeftWall, &ResolutionDirection, &ResolutionOverlap))
+    {
+        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
+        Player->Position.x -= I.x;
+        Player->Position.y -= I.y;
+    }
+    if(E_EntitiesCollide(Player, RightWall, &ResolutionDirection, &ResolutionOverlap))
+    {
+        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
+        Player->Position.x -= I.x;
+        Player->Position.y -= I.y;
+    }
+    if(E_EntitiesCollide(Player, TopWall, &ResolutionDirection, &ResolutionOverlap))
+    {
+        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
+        Player->Position.x -= I.x;
+        Player->Position.y -= I.y;
+    }
+    if(E_EntitiesCollide(Player, BottomWall, &ResolutionDirection, &ResolutionOverlap))
+    {
+        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
+        Player->Position.x -= I.x;
+        Player->Position.y -= I.y;
+    }
+}
+
+void CollisionPlayerVsEnemies(game_events *Events)
+{
+    glm::vec2 ResolutionDirection;
+    f32 ResolutionOverlap;
+
+    // Collision Player vs Enemies, only test the enemies the grid
+    // says are close enough
+    u32 CandidateCount = C_GridQuery(EnemyGrid, C_ColliderCenter(&Player->Collider), C_BoundingRadius(&Player->Collider));
+    for(u32 i = 0; i < CandidateCount; i++)
+    {
+        entity *Enemy = &Enemies->Entities[EnemyGrid->QueryIds[i]];
+        if(Enemy->Killed) { continue; }
+
+        if(E_EntitiesCollide(Player, Enemy, &ResolutionDirection, &ResolutionOverlap))
+        {
+            // Player got hit, check if dead
+            AddExplosion(Events, Enemy);
+            AddExplosion(Events, Player);
+            E_KillEntity(Enemies, Enemy->Handle);
+            PlayerLives--;
+
+            if(PlayerLives < 1)
+            {
+                CurrentState = State_GameOver;
+                Events->PlayerDied = true;
+                break;
+            }
+            else
+            {
+                Events->PlayerHits++;
+            }
+        }
+    }
+}
+
+void CollisionEnemiesVsBullets(game_events *Events)
+{
+    // Enemies vs Player Bullets, every bullet is only paired with the
+    // enemies in the grid cells around it. All the pairs are tested
+    // at once by the batched narrowphase.
+    C_BatchClear(BulletBatch);
+    for(u32 BulletIndex = 0; BulletIndex < Bullets->Count; BulletIndex++)
+    {
+        entity *Bullet = &Bullets->Entities[BulletIndex];
+        if(Bullet->Killed) { continue; }
+
+        u32 CandidateCount = C_GridQuery(EnemyGrid, C_ColliderCenter(&Bullet->Collider), C_BoundingRadius(&Bullet->Collider));
+        for(u32 i = 0; i < CandidateCount; i++)
+        {
+            u32 EnemyIndex = EnemyGrid->QueryIds[i];
+            entity *Enemy = &Enemies->Entities[EnemyIndex];
+            if(Enemy->Killed) { continue; }
+
+            C_BatchAddPair(BulletBatch, &Enemy->Collider, &Bullet->Collider, EnemyIndex, BulletIndex);
+        }
+    }
+
+    C_BatchRun(BulletBatch);
+
+    // Pairs are in bullet order, one bullet kills one enemy
+    for(u32 i = 0; i < BulletBatch->Count; i++)
+    {
+        if(!BulletBatch->Results[i].Colliding) { continue; }
+
+        entity *Enemy = &Enemies->Entities[BulletBatch->Pairs[i].IdA];
+        entity *Bullet = &Bullets->Entities[BulletBatch->Pairs[i].IdB];
+        if(Enemy->Killed || Bullet->Killed) { continue; }
+
+        PlayerScore += 1;
+        AddExplosion(Events, Enemy);
+        E_KillEntity(Enemies, Enemy->Handle);
+        E_KillEntity(Bullets, Bullet->Handle);
+    }
+}
+
+// One fixed step of the game, everything in here only depends on the
+// input, the timestep and the RNG, never on the frame rate, so a
+// replay of the inputs reproduces the game exactly
+void SimulateGameTick(game_input *Input, game_events *Events, f32 TimeStep)
+{
+    f32 Time = (f32)GameTick * TimeStep;
+
+    // Remember where everything was so the renderer can interpolate
+    E_SavePreviousTransform(Player);
+    E_SavePreviousTransforms(Enemies);
+    E_SavePreviousTransforms(Bullets);
+
+    if(Input->Fire)
+    {
+        FireBullet(Input->MouseWorldPosition, Events);
+        Input->Fire = false;
+    }
+
+    ApplyEnemyInputs(TimeStep, Time);
+    SpawnEnemies(TimeStep);
+
+    UpdatePlayerPosition(Input, TimeStep);
+    UpdateEnemyPositions(TimeStep);
+    UpdateBulletPositions(TimeStep);
+
+    CollisionPlayerVsWalls();
+    E_BuildGrid(EnemyGrid, Enemies);
+    CollisionPlayerVsEnemies(Events);
+    CollisionEnemiesVsBullets(Events);
+
+    // Entities killed this tick are removed here, in one pass per list
+    E_FlushKills(Enemies);
+    E_FlushKills(Bullets);
+
+    GameTick++;
+}
+
+// Texture of the entities the simulation spawns, used to rebuild the
+// entities restored from a replay keyframe
+texture *GameEntityTexture(entity_type Type)
+{
+    switch(Type)
+    {
+        case EntityType_Player:   return PlayerTexture;
+        case EntityType_Seeker:   return SeekerTexture;
+        case EntityType_Wanderer: return WandererTexture;
+        case EntityType_Kamikaze: return KamikazeTexture;
+        case EntityType_Bullet:   return BulletTexture;
+        case EntityType_Wall:     return WallTexture;
+        default:                  return NULL;
+    }
+}
+
+// Creates the entity lists and the entities that live for the whole
+// game, the textures have to be loaded before this is called
+void GameBegin()
+{
+    CurrentState = State_Initial;
+    GameTick = 0;
+    Enemies         = E_CreateEntityList(InitialEntityCapacity);
+    Bullets         = E_CreateEntityList(InitialEntityCapacity);
+    EnemyGrid       = C_CreateGrid(WorldLeft - EnemyGridPadding, WorldRight + EnemyGridPadding,
+                                   WorldBottom - EnemyGridPadding, WorldTop + EnemyGridPadding,
+                                   EnemyGridCellSize, InitialEntityCapacity);
+    BulletBatch     = C_CreateCollisionBatch(InitialEntityCapacity);
+    WandererSpin    = RotationFromAngle(WandererTurnRate / (f32)SimulationTickRate);
+
+    LeftWall       = E_CreateEntity(WallTexture, glm::vec3(WorldLeft - 1.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
+    RightWall      = E_CreateEntity(WallTexture, glm::vec3(WorldRight + 1.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
+    TopWall        = E_CreateEntity(WallTexture, glm::vec3(0.0f, WorldTop + 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(BackgroundWidth, 1.0f, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
+    BottomWall     = E_CreateEntity(WallTexture, glm::vec3(0.0f, WorldBottom - 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(BackgroundWidth, 1.0f, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
+    Player         = E_CreateEntity(PlayerTexture, PlayerInitialPosition, glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f), RotationIdentity, PlayerSpeed, PlayerDrag, EntityType_Player, Collider_Circle);
+}
+
+// Starts a new game after a game over
+void GameReset()
+{
+    PlayerScore = 0;
+    CurrentState = State_Game;
+    E_EmptyList(Enemies);
+    E_EmptyList(Bullets);
+    Player->Position = PlayerInitialPosition;
+    E_SavePreviousTransform(Player);
+    PlayerLives = 3;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "shared.h"
+
+enum gamestate
+{
+    State_Initial,
+    State_Game,
+    State_Pause,
+    State_GameOver,
+};
+
+// Everything the simulation reads from the player, sampled once per
+// frame and read by every tick simulated during that frame
+struct game_input
+{
+    glm::vec2 Move; // WASD, -1, 0 or 1 per axis
+    glm::vec3 MouseWorldPosition;
+    b32 Fire; // Latched on the click, cleared by the tick that fires
+};
+
+#define GAME_MAX_EXPLOSIONS 64
+
+// Where an entity was destroyed or hit, particles are emitted there
+struct game_explosion
+{
+    glm::vec2 Position;
+    u32 Type; // entity_type of what exploded
+};
+
+// What happened during a tick that the platform side reacts to,
+// sounds, camera, bloom and particles. The headless build ignores them.
+struct game_events
+{
+    u32 BulletsFired;
+    u32 PlayerHits; // Hits that did not kill the player
+    b32 PlayerDied;
+
+    game_explosion Explosions[GAME_MAX_EXPLOSIONS]; // The ones past the end are dropped
+    u32 ExplosionCount;
+};
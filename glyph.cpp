@@ -0,0 +1,215 @@
+#pragma once
+
+#include "glyph.h"
+
+global i32 FontAtlasPadding = 1; // Empty pixels around every glyph so linear filtering does not bleed
+global i32 FontDistanceFieldSize = 48; // Pixel size distance field glyphs are stored at
+global i32 FontDistanceFieldSpread = 6; // Atlas pixels the field reaches on each side of an outline
+global i32 FontDistanceFieldOversample = 4; // Glyphs are rasterized this much bigger to find their outline
+
+// Distance field glyphs are rasterized Oversample times bigger than
+// they are stored
+void R_SetGlyphPixelSize(FT_Face Face, b32 DistanceField, i32 Width, i32 Height)
+{
+    if(DistanceField)
+    {
+        i32 Size = FontDistanceFieldSize * FontDistanceFieldOversample;
+        FT_Set_Pixel_Sizes(Face, Size, Size);
+    }
+    else
+    {
+        FT_Set_Pixel_Sizes(Face, Width, Height);
+    }
+}
+
+// A cell fits the bounding box of every glyph in the face, plus a
+// pixel of antialiasing on each side. Call after R_SetGlyphPixelSize
+void R_GlyphCellSize(FT_Face Face, b32 DistanceField, i32 *CellWidth, i32 *CellHeight)
+{
+    i32 BoxWidth = (i32)((FT_MulFix(Face->bbox.xMax - Face->bbox.xMin, Face->size->metrics.x_scale) + 63) >> 6);
+    i32 BoxHeight = (i32)((FT_MulFix(Face->bbox.yMax - Face->bbox.yMin, Face->size->metrics.y_scale) + 63) >> 6);
+    if(DistanceField)
+    {
+        // The field spreads past the outline, and rounding the
+        // glyph origin to whole atlas pixels adds one more
+        BoxWidth = (BoxWidth + FontDistanceFieldOversample - 1) / FontDistanceFieldOversample + FontDistanceFieldSpread * 2 + 1;
+        BoxHeight = (BoxHeight + FontDistanceFieldOversample - 1) / FontDistanceFieldOversample + FontDistanceFieldSpread * 2 + 1;
+    }
+    *CellWidth = BoxWidth + 2 + FontAtlasPadding * 2;
+    *CellHeight = BoxHeight + 2 + FontAtlasPadding * 2;
+}
+
+// Squared distance of the offsets in an R_DistanceTransform grid
+inline i32 R_DistanceSquared(glm::ivec2 Offset)
+{
+    return Offset.x * Offset.x + Offset.y * Offset.y;
+}
+
+inline void R_DistanceCompare(glm::ivec2 *Grid, i32 Width, i32 Height, i32 X, i32 Y, i32 OffsetX, i32 OffsetY)
+{
+    i32 OtherX = X + OffsetX;
+    i32 OtherY = Y + OffsetY;
+    if(OtherX < 0 || OtherY < 0 || OtherX >= Width || OtherY >= Height)
+    {
+        return;
+    }
+
+    glm::ivec2 Other = Grid[OtherY * Width + OtherX] + glm::ivec2(OffsetX, OffsetY);
+    if(R_DistanceSquared(Other) < R_DistanceSquared(Grid[Y * Width + X]))
+    {
+        Grid[Y * Width + X] = Other;
+    }
+}
+
+// 8-point sequential Euclidean distance transform. On input every cell
+// is 0 on the shape and far away elsewhere, on output it holds the
+// offset to the closest cell of the shape
+void R_DistanceTransform(glm::ivec2 *Grid, i32 Width, i32 Height)
+{
+    for(i32 Y = 0; Y < Height; Y++)
+    {
+        for(i32 X = 0; X < Width; X++)
+        {
+            R_DistanceCompare(Grid, Width, Height, X, Y, -1,  0);
+            R_DistanceCompare(Grid, Width, Height, X, Y,  0, -1);
+            R_DistanceCompare(Grid, Width, Height, X, Y, -1, -1);
+            R_DistanceCompare(Grid, Width, Height, X, Y,  1, -1);
+        }
+        for(i32 X = Width - 1; X >= 0; X--)
+        {
+            R_DistanceCompare(Grid, Width, Height, X, Y, 1, 0);
+        }
+    }
+    for(i32 Y = Height - 1; Y >= 0; Y--)
+    {
+        for(i32 X = Width - 1; X >= 0; X--)
+        {
+            R_DistanceCompare(Grid, Width, Height, X, Y,  1, 0);
+            R_DistanceCompare(Grid, Width, Height, X, Y,  0, 1);
+            R_DistanceCompare(Grid, Width, Height, X, Y, -1, 1);
+            R_DistanceCompare(Grid, Width, Height, X, Y,  1, 1);
+        }
+        for(i32 X = 0; X < Width; X++)
+        {
+            R_DistanceCompare(Grid, Width, Height, X, Y, -1, 0);
+        }
+    }
+}
+
+// Rounds towards negative infinity, unlike the / operator
+inline i32 R_FloorDivide(i32 A, i32 B)
+{
+    return (A >= 0) ? A / B : -((-A + B - 1) / B);
+}
+
+// Turns the oversampled glyph FreeType just rendered into a signed
+// distance field in the cell staging pixels. 0.5 (128) is the outline,
+// higher is inside, and FontDistanceFieldSpread atlas pixels away from
+// it the field reaches 0 or 1
+void R_RasterizeDistanceField(FT_Face Face, u8 *CellPixels, i32 CellWidth, i32 CellHeight, character *Character)
+{
+    FT_GlyphSlot Slot = Face->glyph;
+    i32 Oversample = FontDistanceFieldOversample;
+    i32 Spread = FontDistanceFieldSpread * Oversample;
+
+    // The high resolution grid has the spread around the bitmap, and
+    // its corner on a whole atlas pixel so the bearing stays exact.
+    // X grows right and Y grows up from the pen position
+    i32 Left = R_FloorDivide(Slot->bitmap_left - Spread, Oversample) * Oversample;
+    i32 Right = -R_FloorDivide(-(Slot->bitmap_left + (i32)Slot->bitmap.width + Spread), Oversample) * Oversample;
+    i32 Top = -R_FloorDivide(-(Slot->bitmap_top + Spread), Oversample) * Oversample;
+    i32 Bottom = R_FloorDivide(Slot->bitmap_top - (i32)Slot->bitmap.rows - Spread, Oversample) * Oversample;
+    i32 Width = Right - Left;
+    i32 Height = Top - Bottom;
+
+    // Inside holds the offset to the closest pixel outside the glyph,
+    // Outside the offset to the closest pixel inside of it
+    glm::ivec2 Far = glm::ivec2(Width + Height, Width + Height);
+    glm::ivec2 *Inside = (glm::ivec2*)Malloc(Width * Height * sizeof(glm::ivec2));
+    glm::ivec2 *Outside = (glm::ivec2*)Malloc(Width * Height * sizeof(glm::ivec2));
+    i32 OffsetX = Slot->bitmap_left - Left;
+    i32 OffsetY = Top - Slot->bitmap_top;
+    for(i32 Y = 0; Y < Height; Y++)
+    {
+        for(i32 X = 0; X < Width; X++)
+        {
+            i32 BitmapX = X - OffsetX;
+            i32 BitmapY = Y - OffsetY;
+            b32 Covered = false;
+            if(BitmapX >= 0 && BitmapY >= 0 && BitmapX < (i32)Slot->bitmap.width && BitmapY < (i32)Slot->bitmap.rows)
+            {
+                Covered = Slot->bitmap.buffer[BitmapY * Slot->bitmap.pitch + BitmapX] >= 128;
+            }
+            Inside[Y * Width + X] = Covered ? Far : glm::ivec2(0);
+            Outside[Y * Width + X] = Covered ? glm::ivec2(0) : Far;
+        }
+    }
+    R_DistanceTransform(Inside, Width, Height);
+    R_DistanceTransform(Outside, Width, Height);
+
+    // Every atlas pixel is the average signed distance of the
+    // Oversample x Oversample pixels it covers
+    i32 GlyphWidth = glm::min(Width / Oversample, CellWidth - FontAtlasPadding * 2);
+    i32 GlyphHeight = glm::min(Height / Oversample, CellHeight - FontAtlasPadding * 2);
+    for(i32 Y = 0; Y < GlyphHeight; Y++)
+    {
+        for(i32 X = 0; X < GlyphWidth; X++)
+        {
+            f32 Sum = 0.0f;
+            for(i32 SubY = 0; SubY < Oversample; SubY++)
+            {
+                for(i32 SubX = 0; SubX < Oversample; SubX++)
+                {
+                    i32 Index = (Y * Oversample + SubY) * Width + X * Oversample + SubX;
+                    Sum += sqrtf((f32)R_DistanceSquared(Inside[Index])) - sqrtf((f32)R_DistanceSquared(Outside[Index]));
+                }
+            }
+            f32 Distance = Sum / (f32)(Oversample * Oversample * Spread); // -1 to 1 over the spread
+            f32 Value = glm::clamp(0.5f + Distance * 0.5f, 0.0f, 1.0f);
+            CellPixels[(Y + FontAtlasPadding) * CellWidth + X + FontAtlasPadding] = (u8)(Value * 255.0f + 0.5f);
+        }
+    }
+
+    Free(Inside);
+    Free(Outside);
+
+    Character->Size = glm::ivec2(GlyphWidth, GlyphHeight);
+    Character->Bearing = glm::ivec2(Left / Oversample, Top / Oversample);
+    Character->Advance = (u32)(Slot->advance.x / Oversample);
+}
+
+// Rasterizes the glyph into CellPixels, a whole CellWidth x CellHeight
+// cell, and fills in everything but the UVRect of Character. Glyphs
+// bigger than a cell are clipped
+b32 R_RasterizeGlyphPixels(FT_Face Face, u32 Codepoint, b32 DistanceField, u8 *CellPixels, i32 CellWidth, i32 CellHeight, character *Character)
+{
+    *Character = {};
+    memset(CellPixels, 0, CellWidth * CellHeight);
+    if(FT_Load_Char(Face, Codepoint, FT_LOAD_RENDER) != 0)
+    {
+        printf("FT_Load_Char: Error, Freetype Failed to load Glyph U+%04X\n", Codepoint);
+        return false;
+    }
+
+    if(DistanceField)
+    {
+        R_RasterizeDistanceField(Face, CellPixels, CellWidth, CellHeight, Character);
+    }
+    else
+    {
+        FT_GlyphSlot Slot = Face->glyph;
+        i32 GlyphWidth = glm::min((i32)Slot->bitmap.width, CellWidth - FontAtlasPadding * 2);
+        i32 GlyphHeight = glm::min((i32)Slot->bitmap.rows, CellHeight - FontAtlasPadding * 2);
+        for(i32 Row = 0; Row < GlyphHeight; Row++)
+        {
+            memcpy(CellPixels + (Row + FontAtlasPadding) * CellWidth + FontAtlasPadding,
+                   Slot->bitmap.buffer + Row * Slot->bitmap.pitch, GlyphWidth);
+        }
+
+        Character->Size = glm::ivec2(GlyphWidth, GlyphHeight);
+        Character->Bearing = glm::ivec2(Slot->bitmap_left, Slot->bitmap_top);
+        Character->Advance = (u32)Slot->advance.x;
+    }
+
+    return true;
+}
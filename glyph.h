@@ -0,0 +1,22 @@
+#pragma once
+
+#include "shared.h"
+
+// Freetype
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/*
+  Glyph rasterization with FreeType, no GL. The renderer rasterizes
+  glyphs on demand into the cells of its atlas cache, the pack tool
+  uses the same code to rasterize distance field glyphs ahead of time,
+  so a cooked glyph is the same as one rasterized at runtime.
+*/
+
+struct character
+{
+    glm::vec4 UVRect;   // Glyph inside the font atlas, offset in xy, size in zw
+    glm::ivec2 Size;    // Size of glyph
+    glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
+    u32 Advance;        // Offset to advance to next glyph
+};
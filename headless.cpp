@@ -0,0 +1,272 @@
+/*
+
+  Headless build of the game simulation, no window, GL context or
+  audio device. Runs State_Game for a number of ticks as fast as the
+  CPU allows, with a scripted player, and prints the throughput. Used
+  to benchmark the simulation on machines without a display.
+
+  Usage: headless [-ticks N] [-seed N] [-tickrate HZ] [-spawnrate N]
+                  [-record FILE] [-play FILE] [-seek TICK]
+                  [-validate PAIRS]
+
+    -ticks     Number of ticks to simulate, default 100000
+    -seed      RNG seed, default 1
+    -tickrate  Simulation rate in Hz, default SimulationTickRate
+    -spawnrate Spawns per second of every enemy type, raise it to stress heavy waves
+    -record    Save the session to a replay file
+    -play      Play a replay file, recorded here or by the game, instead
+               of the scripted player. Seed, tick rate and spawn rate
+               come from the replay
+    -seek      Start the playback at this tick, not included in the timing
+    -validate  Instead of simulating, run this many random rectangle and
+               circle pairs through the batched narrowphase and check
+               them against C_Collision, see C_ValidateCollisionBatch
+
+ */
+
+#define GLOW_HEADLESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "shared.h"
+#include "collision.cpp"
+#include "entity.cpp"
+#include "random.cpp"
+#include "game.cpp"
+#include "replay.cpp"
+
+global u32 HeadlessFireInterval = 6; // Ticks between shots of the scripted player
+
+// Scripted player, strafes around and shoots at the enemies one after
+// the other so the bullet and kill paths run like in a real game
+void HeadlessInput(game_input *Input, u64 Tick, f32 Time)
+{
+    Input->Move.x = Cosf(Time * 0.7f) > 0.0f ? 1.0f : -1.0f;
+    Input->Move.y = Sinf(Time * 1.3f) > 0.0f ? 1.0f : -1.0f;
+
+    if(Enemies->Count > 0)
+    {
+        u32 Target = (u32)(Tick / HeadlessFireInterval) % Enemies->Count;
+        Input->MouseWorldPosition = Enemies->Entities[Target].Position;
+    }
+    else
+    {
+        Input->MouseWorldPosition = Player->Position + glm::vec3(Cosf(Time), Sinf(Time), 0.0f);
+    }
+
+    if(Tick % HeadlessFireInterval == 0)
+    {
+        Input->Fire = true;
+    }
+}
+
+void HeadlessRandomCollider(collider *Collider)
+{
+    *Collider = {};
+    glm::vec2 Center = glm::vec2(RandomBetween(-2.0f, 2.0f), RandomBetween(-2.0f, 2.0f));
+    if(RandomBool())
+    {
+        Collider->Type = Collider_Rectangle;
+        Collider->Rectangle.Center = Center;
+        Collider->Rectangle.HalfWidth = RandomBetween(0.1f, 1.5f);
+        Collider->Rectangle.HalfHeight = RandomBetween(0.1f, 1.5f);
+        Collider->Rectangle.Rotation = RotationFromAngle(RandomBetween(0.0f, 360.0f));
+    }
+    else
+    {
+        Collider->Type = Collider_Circle;
+        Collider->Circle.Center = Center;
+        Collider->Circle.Radius = RandomBetween(0.1f, 1.5f);
+    }
+    C_UpdateCollider(Collider);
+}
+
+// Checks the SIMD kernels against the scalar narrowphase on random
+// pairs, packed close together so most of them touch. Returns the
+// number of pairs that do not match
+u32 HeadlessValidateCollision(u32 PairCount)
+{
+    u32 BatchSize = 1024;
+    collider *Colliders = (collider*)Malloc(sizeof(collider) * BatchSize * 2); Assert(Colliders);
+    collision_batch *Batch = C_CreateCollisionBatch(BatchSize);
+
+    u32 Mismatches = 0;
+    u32 Colliding = 0;
+    for(u32 Done = 0; Done < PairCount; Done += BatchSize)
+    {
+        u32 Count = PairCount - Done < BatchSize ? PairCount - Done : BatchSize;
+        C_BatchClear(Batch);
+        for(u32 i = 0; i < Count; i++)
+        {
+            HeadlessRandomCollider(&Colliders[i * 2]);
+            HeadlessRandomCollider(&Colliders[i * 2 + 1]);
+            C_BatchAddPair(Batch, &Colliders[i * 2], &Colliders[i * 2 + 1], i, i);
+        }
+        C_BatchRun(Batch);
+        Mismatches += C_ValidateCollisionBatch(Batch, 0.0001f);
+        for(u32 i = 0; i < Count; i++)
+        {
+            Colliding += Batch->Results[i].Colliding ? 1 : 0;
+        }
+    }
+
+    printf("Validated %u pairs, %u colliding, %u do not match C_Collision\n", PairCount, Colliding, Mismatches);
+    Free(Colliders);
+    return Mismatches;
+}
+
+i32 main(i32 Argc, char **Argv)
+{
+    u64 TickTotal = 100000;
+    u32 Seed = 1;
+    char *RecordFilename = NULL;
+    char *PlayFilename = NULL;
+    u32 SeekTick = 0;
+    u32 ValidatePairs = 0;
+
+    for(i32 i = 1; i + 1 < Argc; i += 2)
+    {
+        if(strcmp(Argv[i], "-ticks") == 0)          { TickTotal = strtoull(Argv[i + 1], NULL, 10); }
+        else if(strcmp(Argv[i], "-seed") == 0)      { Seed = (u32)strtoul(Argv[i + 1], NULL, 10); }
+        else if(strcmp(Argv[i], "-tickrate") == 0)  { SimulationTickRate = atof(Argv[i + 1]); }
+        else if(strcmp(Argv[i], "-spawnrate") == 0) { EnemySpawnsPerSecond = (f32)atof(Argv[i + 1]); }
+        else if(strcmp(Argv[i], "-record") == 0)    { RecordFilename = Argv[i + 1]; }
+        else if(strcmp(Argv[i], "-play") == 0)      { PlayFilename = Argv[i + 1]; }
+        else if(strcmp(Argv[i], "-seek") == 0)      { SeekTick = (u32)strtoul(Argv[i + 1], NULL, 10); }
+        else if(strcmp(Argv[i], "-validate") == 0)  { ValidatePairs = (u32)strtoul(Argv[i + 1], NULL, 10); }
+        else
+        {
+            printf("Unknown argument: %s\n", Argv[i]);
+            return 1;
+        }
+    }
+
+    if(SimulationTickRate <= 0.0 || Seed == 0)
+    {
+        printf("The tick rate and the seed have to be positive\n");
+        return 1;
+    }
+    if(RecordFilename && PlayFilename)
+    {
+        printf("Can not record and play a replay at the same time\n");
+        return 1;
+    }
+
+    if(ValidatePairs)
+    {
+        RandomSeed(Seed);
+        return HeadlessValidateCollision(ValidatePairs) ? 1 : 0;
+    }
+
+    replay *Replay = NULL;
+    if(PlayFilename)
+    {
+        Replay = RP_LoadReplay(PlayFilename);
+        if(!Replay) { return 1; }
+        RP_ApplySettings(Replay);
+    }
+    else
+    {
+        RandomSeed(Seed);
+        if(RecordFilename) { Replay = RP_CreateRecording(Seed); }
+    }
+
+    GameBegin();
+    CurrentState = State_Game;
+
+    b32 Playing = Replay && !Replay->Recording;
+    if(Playing)
+    {
+        RP_Seek(Replay, SeekTick);
+        TickTotal = Replay->Header.TickCount - Replay->Tick;
+    }
+    b32 ResetPending = false;
+
+    f32 TimeStep = (f32)(1.0 / SimulationTickRate);
+    game_input Input = {};
+    u64 EnemyTotal = 0;
+    u32 EnemyPeak = 0;
+    u32 BulletPeak = 0;
+    u32 GameOvers = 0;
+
+    u64 Tick = 0;
+    auto Start = std::chrono::steady_clock::now();
+    for(; Tick < TickTotal; Tick++)
+    {
+        if(Playing)
+        {
+            b32 Reset;
+            if(!RP_PlayTick(Replay, &Input, &Reset)) { break; }
+        }
+        else
+        {
+            HeadlessInput(&Input, Tick, (f32)((f64)Tick / SimulationTickRate));
+            if(Replay)
+            {
+                RP_RecordTick(Replay, &Input, ResetPending);
+                ResetPending = false;
+            }
+        }
+
+        game_events Events = {};
+        SimulateGameTick(&Input, &Events, TimeStep);
+
+        EnemyTotal += Enemies->Count;
+        if(Enemies->Count > EnemyPeak) { EnemyPeak = Enemies->Count; }
+        if(Bullets->Count > BulletPeak) { BulletPeak = Bullets->Count; }
+
+        // Keep the simulation going, the benchmark does not stop on
+        // game over. A replay resets on its own when the player did
+        if(CurrentState == State_GameOver)
+        {
+            GameOvers++;
+            if(!Playing)
+            {
+                GameReset();
+                ResetPending = true;
+            }
+        }
+    }
+    auto End = std::chrono::steady_clock::now();
+    TickTotal = Tick;
+
+    f64 Seconds = std::chrono::duration<f64>(End - Start).count();
+    f64 TicksPerSecond = Seconds > 0.0 ? (f64)TickTotal / Seconds : 0.0;
+    f64 SimulatedSeconds = (f64)TickTotal / SimulationTickRate;
+
+    printf("Ticks: %llu at %.0f Hz (%.1f simulated seconds)\n", (unsigned long long)TickTotal, SimulationTickRate, SimulatedSeconds);
+    printf("Time: %.3f s, %.0f ticks/sec, %.4f ms/tick, %.1fx real time\n",
+           Seconds, TicksPerSecond, TickTotal ? Seconds * 1000.0 / (f64)TickTotal : 0.0,
+           Seconds > 0.0 ? SimulatedSeconds / Seconds : 0.0);
+    printf("Enemies: %.1f average, %u peak. Bullets: %u peak\n",
+           TickTotal ? (f64)EnemyTotal / (f64)TickTotal : 0.0, EnemyPeak, BulletPeak);
+    printf("Score: %u, Game overs: %u\n", PlayerScore, GameOvers);
+
+    // Hash of the final game state, equal between two runs of the same
+    // replay when an optimisation did not change the gameplay
+    replay_buffer State = {};
+    RP_WriteGameState(&State);
+    u32 Hash = 2166136261u;
+    for(u32 i = 0; i < State.Size; i++)
+    {
+        Hash = (Hash ^ State.Data[i]) * 16777619u;
+    }
+    printf("State hash: %08x\n", Hash);
+
+    if(Replay && Replay->Recording)
+    {
+        if(!RP_SaveReplay(Replay, RecordFilename)) { return 1; }
+        printf("Recorded %u ticks into %s, %u bytes\n", Replay->Header.TickCount, RecordFilename,
+               (u32)sizeof(replay_header) + Replay->Stream.Size + Replay->Header.KeyframeCount * (u32)sizeof(replay_keyframe));
+    }
+    if(Playing && Replay->Desynced)
+    {
+        printf("The replay desynced, the simulation is not deterministic\n");
+        return 2;
+    }
+
+    return 0;
+}
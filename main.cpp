@@ -8,7 +8,11 @@
   S_ - S stands for Sound, everything sound related is in sound.cpp
   C_ - C stands for collision, everything related to collision is inside collision.cpp
   E_ - E stands for entity, everything related is in entity.cpp
+  RP_ - RP stands for replay, input recording and playback, replay.cpp
+  A_ - A stands for assets, threaded loading of textures and sounds at startup, asset.cpp
+  PS_ - PS stands for particle system, explosion and hit particles, particle.cpp
   random.cpp - contains the random number generator
+  game.cpp - the game simulation, shared with the headless build in headless.cpp
 
 
   --- Game loop overall layout
@@ -44,8 +48,6 @@
 
     --- TODO LIST ---
 
-    - Make enemy spawns independent from frame rate
-
     - Create a Spawn Entity List, when enemies spawn add the to that
       list. The purpose of the list is to animate them from back to
       front with tweening, once they are in place, move them to the
@@ -64,20 +66,19 @@
 
 #include "shared.h"
 #include "platform.cpp"
+#include "archive.cpp"
 #include "input.cpp"
+#include "glyph.cpp"
+#include "mipmap.cpp"
+#include "particle.cpp"
 #include "renderer.cpp"
 #include "sound.cpp"
 #include "collision.cpp"
 #include "entity.cpp"
 #include "random.cpp"
-
-enum gamestate
-{
-    State_Initial,
-    State_Game,
-    State_Pause,
-    State_GameOver,
-};
+#include "game.cpp"
+#include "replay.cpp"
+#include "asset.cpp"
 
 // Application Variables
 global u32 WindowWidth = 1366;
@@ -90,20 +91,13 @@ global window       *Window;
 global renderer     *Renderer;
 global sound_system *SoundSystem;
 global camera       *Camera;
-global gamestate     CurrentState;
 
 // Textures
 global texture *InitScreenTexture  = NULL;
 global texture *PauseScreenTexture = NULL;
 global texture *GameOverTexture    = NULL;
-global texture *PlayerTexture      = NULL;
 global texture *BackgroundTexture  = NULL;
-global texture *WallTexture        = NULL;
-global texture *BulletTexture      = NULL;
 global texture *PointerTexture     = NULL;
-global texture *WandererTexture    = NULL;
-global texture *SeekerTexture      = NULL;
-global texture *KamikazeTexture    = NULL;
 
 // Fonts
 font *DebugFont = NULL;
@@ -115,25 +109,31 @@ global sound_effect *Shot = NULL;
 global sound_effect *PlayerDeath = NULL;
 global sound_effect *PlayerDamage = NULL;
 
-// Game Variables
-global f32 WorldBottom      = -11.0f;
-global f32 WorldTop         = 11.0f;
-global f32 WorldLeft        = -20.0f;
-global f32 WorldRight       = 20.0f;
-global f32 HalfWorldWidth   = WorldRight;
-global f32 HalfWorldHeight  = WorldTop;
-global f32 WorldWidth       = WorldRight * 2.0f;
-global f32 WorldHeight      = WorldTop * 2.0f;
-global f32 BackgroundWidth  = WorldWidth + 5.0f;
-global f32 BackgroundHeight = WorldHeight + 5.0f;
-global u32 PlayerScore      = 0;
-global b32 DebugMode        = 0;
-global i32 EnemySpawnRate   = 2000;
-global f32 BulletSpeed      = 20.0f;
-global entity *LeftWall     = NULL;
-global entity *RightWall    = NULL;
-global entity *TopWall      = NULL;
-global entity *BottomWall   = NULL;
+// Particles, a burst for every explosion the simulation reports
+global particle_system *Particles = NULL;
+global f32 ParticleDrag = 2.5f;
+global f32 ParticleUpdateMs = 0.0f; // Shown in debug mode
+//                                          Count  Speed         Life          Size   Color
+global particle_emitter SeekerExplosion   = {160,  2.0f, 10.0f,  0.4f, 1.0f,   0.18f, glm::vec3(1.0f, 0.45f, 0.1f)};
+global particle_emitter WandererExplosion = {160,  2.0f, 10.0f,  0.4f, 1.0f,   0.18f, glm::vec3(0.7f, 0.3f, 1.0f)};
+global particle_emitter KamikazeExplosion = {160,  2.0f, 10.0f,  0.4f, 1.0f,   0.18f, glm::vec3(0.2f, 1.0f, 0.4f)};
+global particle_emitter PlayerHit         = {240,  3.0f, 14.0f,  0.3f, 0.8f,   0.15f, glm::vec3(1.0f, 0.15f, 0.15f)};
+
+global b32 DebugMode = 0;
+global game_input GameInput = {};
+global char *AssetArchiveFilename = "assets.pak"; // Made by the pack tool, the loose files are loaded when it is missing
+global char *GPUTimesFilename = NULL; // -gputimes FILE, writes the GPU time of every render pass as CSV
+
+// Replays, set from the command line
+//   -record FILE  Records the session, saved when the game closes
+//   -play FILE    Plays a replay instead of the player input, the game closes at the end
+//   -fast         Plays it as fast as possible instead of in real time
+//   -seek TICK    Starts the playback at this tick
+global replay *Replay = NULL;
+global char *ReplayFilename = NULL;
+global b32 ReplayFast = false;
+global b32 ReplayResetPending = false; // GameReset was called, recorded with the next tick
+global u64 ReplayStartCounter = 0;
 
 // Entities
 entity *GameBackground = NULL;
@@ -141,321 +141,146 @@ entity *InitialScreen  = NULL;
 entity *PauseScreen    = NULL;
 entity *GameOverScreen = NULL;
 
-// Bullet and enemies containers
-u32 MaxEntityCount   = 100;
-entity_list *Enemies = NULL;
-entity_list *Bullets = NULL;
-
-// Player vars
-global entity *Player                  = NULL;
-global f32 PlayerSpeed                 = 3.0f;
-global f32 PlayerDrag                  = 0.8f;
-global u32 PlayerLives                 = 10;
-global glm::vec3 PlayerInitialPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-
-void SpawnSeeker(entity_list *List)
+void UpdateWorldMousePosition()
 {
-    f32 PosX = RandomBetween(WorldLeft, WorldRight);
-    f32 PosY = RandomBetween(WorldBottom, WorldTop);
-    entity *Entity = E_CreateEntity(SeekerTexture, glm::vec3(PosX, PosY, 0.0f), glm::vec3(0), glm::vec3(1.0f), 0.0f, 2.0f, 0.8f, EntityType_Seeker, Collider_Rectangle);
-    E_PushEntity(List, Entity);
+    // Convert window mouse position to game world position, mainly used to fire bullets from Player->Position to Mouse->WorldPosition
+    Mouse->WorldPosition.x = Remap((f32)(Mouse->X), 0.0f, (f32)Window->Width, Camera->Position.x - HalfWorldWidth, Camera->Position.x + HalfWorldWidth);
+    Mouse->WorldPosition.y = Remap((f32)(Mouse->Y), 0.0f, (f32)Window->Height, Camera->Position.y + HalfWorldHeight, Camera->Position.y - HalfWorldHeight);
 }
 
-void SpawnWanderer(entity_list *List)
+particle_emitter *ExplosionEmitter(u32 Type)
 {
-    f32 PosX = RandomBetween(WorldLeft, WorldRight);
-    f32 PosY = RandomBetween(WorldBottom, WorldTop);
-    entity *Entity = E_CreateEntity(WandererTexture, glm::vec3(PosX, PosY, 0.0f), glm::vec3(0), glm::vec3(1.0f), 0.0f, 0.0f, 1.0f, EntityType_Wanderer, Collider_Rectangle);
-    E_PushEntity(List, Entity);
+    switch(Type)
+    {
+        case EntityType_Seeker:   return &SeekerExplosion;
+        case EntityType_Wanderer: return &WandererExplosion;
+        case EntityType_Kamikaze: return &KamikazeExplosion;
+        case EntityType_Player:   return &PlayerHit;
+        default:                  return NULL;
+    }
 }
 
-void SpawnKamikaze(entity_list *List)
+// Sounds, bloom, camera changes and particles for what happened in a tick
+void PlayGameEvents(game_events *Events)
 {
-    // Spawns an enemy that flies directly to the player position.
-
-    f32 PosX = 0;
-    f32 PosY = 0;
-    f32 Padding = 3.0f;
-
-    // Random PosX
-    if(RandomBool())
+    for(u32 i = 0; i < Events->ExplosionCount; i++)
     {
-        // Left
-        PosX = RandomBetween(WorldLeft - Padding, WorldLeft);
+        particle_emitter *Emitter = ExplosionEmitter(Events->Explosions[i].Type);
+        if(Emitter)
+        {
+            PS_Emit(Particles, Emitter, Events->Explosions[i].Position);
+        }
     }
-    else
+
+    if(Events->BulletsFired)
     {
-        // Right
-        PosX = RandomBetween(WorldRight, WorldRight + Padding);
+        S_PlaySoundEffect(Shot);
     }
 
-    // Random  PosY
-    if(RandomBool())
+    if(Events->PlayerDied)
     {
-        // Top
-        PosY = RandomBetween(WorldTop, WorldTop + Padding);
+        // Game over, nothing updates or draws them until the next game
+        PS_Clear(Particles);
+        S_PlaySoundEffect(PlayerDeath);
+        EnableBloom = 0;
+        R_ResetCamera(Camera, Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     }
-    else
+    else if(Events->PlayerHits)
     {
-        // Bottom
-        PosY = RandomBetween(WorldBottom - Padding, WorldBottom);
+        S_PlaySoundEffect(PlayerDamage);
     }
-
-    glm::vec3 KamikazePosition = {PosX, PosY, 0.0f};
-    f32 DirectionX = KamikazePosition.x - Player->Position.x;
-    f32 DirectionY = KamikazePosition.y - Player->Position.y;
-    f32 KamikazeAngle = GetDirectionAngle(DirectionY, DirectionX);
-    f32 KamikazeSpeed = 5.0f;
-    entity *Entity = E_CreateEntity(KamikazeTexture, KamikazePosition,
-                                    Player->Position - KamikazePosition,
-                                    glm::vec3(1.0f, 1.0f, 0.0f), KamikazeAngle, KamikazeSpeed, 0.8f,
-                                    EntityType_Kamikaze, Collider_Rectangle);
-    E_PushEntity(List, Entity);
 }
 
-void SpawnEnemies()
+b32 ReplayPlaying()
 {
-    if(RandomBetween(0, EnemySpawnRate) == 15)
-    {
-        SpawnSeeker(Enemies);
-    }
-    if(RandomBetween(0, EnemySpawnRate) == 16)
-    {
-        SpawnKamikaze(Enemies);
-    }
-    if(RandomBetween(0, EnemySpawnRate) == 17)
-    {
-        SpawnWanderer(Enemies);
-    }
+    return Replay && !Replay->Recording;
 }
 
-void ApplyEnemyInputs()
+// Feeds the next tick of the replay to the simulation instead of the
+// player input, closes the game when the replay is over
+void PlayReplayTick()
 {
-    // Enemy AI
-    // Set "inputs" according to enemy type, i can't figure out a better place to put the enemy AI and i'm not gonna think too much about it
-    for(entity_node *Node = Enemies->Head;
-        Node != NULL;
-        Node = Node->Next)
+    if(!IsRunning)
     {
-        entity *Entity = Node->Entity;
-
-        switch(Entity->Type)
-        {
-            case EntityType_Seeker:
-            {
-                // Get Angle to player, and move towards the player
-                f32 DeltaX = Entity->Position.x - Player->Position.x;
-                f32 DeltaY = Entity->Position.y - Player->Position.y;
-                f32 RotationAngle = GetDirectionAngle(DeltaY, DeltaX);
-                Entity->Angle = RotationAngle;
-                glm::vec3 SeekerDirection = Direction(Entity->Position, Player->Position);
-                Entity->Acceleration += SeekerDirection * Entity->Speed;
-            } break;
-            case EntityType_Wanderer:
-            {
-                f32 X = Cosf((f32)Clock->SecondsElapsed);
-                f32 Y = Sinf((f32)Clock->SecondsElapsed);
-                Entity->Position.x += X * (f32)Clock->DeltaTime * 3.0f;
-                Entity->Position.y += Y * (f32)Clock->DeltaTime * 3.0f;
-                Entity->Angle += 0.4f;
-            } break;
-            case EntityType_Kamikaze:
-            {
-                Entity->Acceleration += glm::normalize(Entity->Direction) * Entity->Speed;
-                break;
-            }
-            case EntityType_Pickup:
-            case EntityType_Bullet:
-            case EntityType_None:
-            case EntityType_Wall:
-            case EntityType_Player:
-            default:
-            {
-                InvalidCodePath;
-                break;
-            }
-        }
+        return;
     }
-}
 
-void UpdateEnemyPositions()
-{
-    for(entity_node *Node = Enemies->Head;
-        Node != NULL;
-        Node = Node->Next)
+    b32 Reset;
+    if(!RP_PlayTick(Replay, &GameInput, &Reset))
     {
-        E_Update(Node->Entity, (f32)Clock->DeltaTime);
-
-        if(Node->Entity->Type == EntityType_Kamikaze)
-        {
-            if(Magnitude(Node->Entity->Position) > 30.0f)
-            {
-                E_FreeNode(Enemies, Node);
-            }
-        }
+        f64 Seconds = (f64)(SDL_GetPerformanceCounter() - ReplayStartCounter) / (f64)SDL_GetPerformanceFrequency();
+        printf("Replay finished, %u ticks in %.2f seconds%s\n", Replay->Tick, Seconds, Replay->Desynced ? ", it desynced" : "");
+        IsRunning = 0;
+        return;
     }
-}
 
-void UpdateBulletPositions()
-{
-    for(entity_node *Node = Bullets->Head;
-        Node != NULL;
-        Node = Node->Next)
+    if(Reset)
     {
-        E_Update(Node->Entity, (f32)Clock->DeltaTime);
-
-        // If the bullet is no longer near the play
-        // area, delete this. Maybe later just checked
-        // square distances to avoid a sqrt.
-        if(Magnitude(Node->Entity->Position) > 30.0f)
-        {
-            E_FreeNode(Bullets, Node);
-        }
+        PS_Clear(Particles);
+        EnableBloom = 1;
+        R_ResetCamera(Camera, Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     }
-}
 
-void UpdatePlayerPosition()
-{
-    // Rotate player according to mouse world position
-    f32 DeltaX = Player->Position.x - Mouse->WorldPosition.x;
-    f32 DeltaY = Player->Position.y - Mouse->WorldPosition.y;
-    Player->Angle = GetDirectionAngle(DeltaY, DeltaX);
-    E_Update(Player, (f32)Clock->DeltaTime);
-}
-
-void FireBullet()
-{
-    f32 DeltaX = Player->Position.x - Mouse->WorldPosition.x;
-    f32 DeltaY = Player->Position.y - Mouse->WorldPosition.y;
-    f32 RotationAngle = GetDirectionAngle(DeltaY, DeltaX);
-    glm::vec3 BulletDirection = glm::normalize(Mouse->WorldPosition - Player->Position);
-    f32 ScalingFactor = 3.5f;
-    entity *NewBullet = E_CreateEntity(BulletTexture, Player->Position, glm::vec3(0.0f), glm::vec3(0.31f * ScalingFactor, 0.11f * ScalingFactor, 0.0f), RotationAngle, BulletSpeed, 1.0f, EntityType_Bullet, Collider_Rectangle);
-    NewBullet->Acceleration += BulletDirection * BulletSpeed;
-    E_PushEntity(Bullets, NewBullet);
-    S_PlaySoundEffect(Shot);
-}
-
-void UpdateWorldMousePosition()
-{
-    // Convert window mouse position to game world position, mainly used to fire bullets from Player->Position to Mouse->WorldPosition
-    Mouse->WorldPosition.x = Remap((f32)(Mouse->X), 0.0f, (f32)Window->Width, Camera->Position.x - HalfWorldWidth, Camera->Position.x + HalfWorldWidth);
-    Mouse->WorldPosition.y = Remap((f32)(Mouse->Y), 0.0f, (f32)Window->Height, Camera->Position.y + HalfWorldHeight, Camera->Position.y - HalfWorldHeight);
+    game_events Events = {};
+    SimulateGameTick(&GameInput, &Events, (f32)Clock->TickDelta);
+    PlayGameEvents(&Events);
 }
 
-void CollisionPlayerVsWalls()
+// Fast playback does not wait for the clock, it simulates ticks for
+// most of a 60 Hz frame and then draws
+b32 ReplayFastTickPending(u64 FrameStart)
 {
-    glm::vec2 ResolutionDirection;
-    f32 ResolutionOverlap;
-
-    // Collision Player vs Walls
-    if(E_EntitiesCollide(Player, LeftWall, &ResolutionDirection, &ResolutionOverlap))
+    if(!ReplayPlaying() || !ReplayFast || !IsRunning ||
+       (CurrentState != State_Game && CurrentState != State_GameOver))
     {
-        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
-        Player->Position.x -= I.x;
-        Player->Position.y -= I.y;
-    }
-    if(E_EntitiesCollide(Player, RightWall, &ResolutionDirection, &ResolutionOverlap))
-    {
-        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
-        Player->Position.x -= I.x;
-        Player->Position.y -= I.y;
-    }
-    if(E_EntitiesCollide(Player, TopWall, &ResolutionDirection, &ResolutionOverlap))
-    {
-        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
-        Player->Position.x -= I.x;
-        Player->Position.y -= I.y;
-    }
-    if(E_EntitiesCollide(Player, BottomWall, &ResolutionDirection, &ResolutionOverlap))
-    {
-        glm::vec2 I = ResolutionDirection * ResolutionOverlap;
-        Player->Position.x -= I.x;
-        Player->Position.y -= I.y;
+        return false;
     }
+
+    return SDL_GetPerformanceCounter() - FrameStart < SDL_GetPerformanceFrequency() / 60;
 }
 
-void CollisionPlayerVsEnemies()
+i32 main(i32 Argc, char **Argv)
 {
-    glm::vec2 ResolutionDirection;
-    f32 ResolutionOverlap;
-
-    // Collision Player vs Enemies
-    for(entity_node *Node = Enemies->Head;
-        Node != NULL;
-        Node = Node->Next)
+    u64 StartupCounter = SDL_GetPerformanceCounter(); // Cleared once the first interactive frame is drawn
+    b32 ReplayRecord = false;
+    u32 ReplaySeekTick = 0;
+    for(i32 i = 1; i < Argc; i++)
     {
-        if(E_EntitiesCollide(Player, Node->Entity, &ResolutionDirection, &ResolutionOverlap))
-        {
-            // Player got hit, play dmg sound effect, check if dead
-            E_FreeNode(Enemies, Node);
-            PlayerLives--;
-
-            if(PlayerLives < 1)
-            {
-                S_PlaySoundEffect(PlayerDeath);
-                EnableBloom = 0;
-                CurrentState = State_GameOver;
-                R_ResetCamera(Camera, Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            }
-            else
-            {
-                S_PlaySoundEffect(PlayerDamage);
-            }
-
-        }
+        if(strcmp(Argv[i], "-record") == 0 && i + 1 < Argc)    { ReplayFilename = Argv[++i]; ReplayRecord = true; }
+        else if(strcmp(Argv[i], "-play") == 0 && i + 1 < Argc) { ReplayFilename = Argv[++i]; ReplayRecord = false; }
+        else if(strcmp(Argv[i], "-seek") == 0 && i + 1 < Argc) { ReplaySeekTick = (u32)strtoul(Argv[++i], NULL, 10); }
+        else if(strcmp(Argv[i], "-fast") == 0)                 { ReplayFast = true; }
+        else if(strcmp(Argv[i], "-gputimes") == 0 && i + 1 < Argc) { GPUTimesFilename = Argv[++i]; }
+        else if(strcmp(Argv[i], "-noshadercache") == 0) { EnableShaderCache = false; }
     }
-}
 
-void CollisionEnemiesVsBullets()
-{
-    glm::vec2 ResolutionDirection;
-    f32 ResolutionOverlap;
-
-    // Enemies vs Player Bullets,  note: this is a n*m loop
-    for(entity_node *Enemy = Enemies->Head;
-        Enemy != NULL;
-        Enemy = Enemy->Next)
+    // The replay decides the tick rate, so it is loaded before the clock is created
+    if(ReplayFilename && !ReplayRecord)
     {
-        for(entity_node *Bullet = Bullets->Head;
-            Bullet != NULL;
-            Bullet = Bullet->Next)
+        Replay = RP_LoadReplay(ReplayFilename);
+        if(!Replay)
         {
-            if(E_EntitiesCollide(Enemy->Entity, Bullet->Entity, &ResolutionDirection, &ResolutionOverlap))
-            {
-                PlayerScore += 1;
-                E_FreeNode(Enemies, Enemy);
-                E_FreeNode(Bullets, Bullet);
-            }
+            return 1;
         }
+        RP_ApplySettings(Replay);
     }
-}
-
-void GameBegin()
-{
-    IsRunning = 1;
-    CurrentState = State_Initial;
-    Enemies         = E_CreateEntityList(MaxEntityCount);
-    Bullets         = E_CreateEntityList(MaxEntityCount);
-    S_PlayMusic(Song);
-}
-
-i32 main(i32 Argc, char **Argv)
-{
-    // The following makes the compiler not throw a warning for unused
-    // variables. I don't really want to turn that warning off, so
-    // here it is, a line of nonsense.
-    Argc; Argv;
 
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
 
+    // With an archive made by the pack tool nothing is decoded, the
+    // assets are used straight from the mapping, which stays mapped
+    // until the game closes
+    archive *Archive = A_OpenArchive(AssetArchiveFilename);
+
     Window       = P_CreateOpenGLWindow("Glow", WindowWidth, WindowHeight);
-    Renderer     = R_CreateRenderer(Window);
+    Renderer     = R_CreateRenderer(Window, Archive);
+    if(GPUTimesFilename) { R_OpenGPUTimerLog(Renderer, GPUTimesFilename); }
     Keyboard     = I_CreateKeyboard();
     Mouse        = I_CreateMouse();
-    Clock        = P_CreateClock();
+    Clock        = P_CreateClock(SimulationTickRate);
     SoundSystem  = S_CreateSoundSystem();
     Camera       = R_CreateCamera(Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Particles    = PS_CreateParticleSystem(PARTICLE_CAPACITY, ParticleDrag, (u32)SDL_GetPerformanceCounter() | 1);
 
     // NOTE(Jorge): Seed the RNG, GetPerformanceCounter is not the
     // best way, but the results look acceptable. I do not have a CPU
@@ -463,43 +288,106 @@ i32 main(i32 Argc, char **Argv)
     // another RNG instance, seed it with performance counter and use
     // the next random number as the seed for the RNG we really are
     // going to use.
-    RandomSeed((u32)SDL_GetPerformanceCounter());
-
-    // Load Fonts
-    DebugFont = R_CreateFont(Renderer, "fonts/LiberationMono-Regular.ttf", 14, 14);
-    UIFont    = R_CreateFont(Renderer, "fonts/NovaSquare-Regular.ttf", 30, 30);
-
-    // Load music and sounds
-    Song         = S_CreateMusic("audio/Music.mp3");
-    Shot         = S_CreateSoundEffect("audio/Shoot1.wav");
-    PlayerDeath  = S_CreateSoundEffect("audio/Explosion1.wav");
-    PlayerDamage = S_CreateSoundEffect("audio/Explosion6.wav");
-
-    // Load textures
-    InitScreenTexture  = R_CreateTexture("textures/InitialScreen.png");
-    PauseScreenTexture = R_CreateTexture("textures/PauseScreen.png");
-    GameOverTexture    = R_CreateTexture("textures/GameOver.png");
-    PlayerTexture      = R_CreateTexture("textures/Player.png");
-    BackgroundTexture  = R_CreateTexture("textures/DeepBlue.png");
-    WallTexture        = R_CreateTexture("textures/Yellow.png");
-    BulletTexture      = R_CreateTexture("textures/Bullet.png");
-    PointerTexture     = R_CreateTexture("textures/Pointer.png");
-    WandererTexture    = R_CreateTexture("textures/Wanderer.png");
-    SeekerTexture      = R_CreateTexture("textures/Seeker.png");
-    KamikazeTexture    = R_CreateTexture("textures/Kamikaze.png");
+    if(!ReplayPlaying())
+    {
+        u32 Seed = (u32)SDL_GetPerformanceCounter();
+        if(Seed == 0) { Seed = 1; }
+        RandomSeed(Seed);
+        if(ReplayRecord) { Replay = RP_CreateRecording(Seed); }
+    }
+
+    // Startup assets, paths are relative to build/ and are also the
+    // names the archive stores them under
+    struct { texture **Texture; char *Filename; } StartupTextures[] =
+    {
+        {&InitScreenTexture,  "textures/InitialScreen.png"},
+        {&PauseScreenTexture, "textures/PauseScreen.png"},
+        {&GameOverTexture,    "textures/GameOver.png"},
+        {&PlayerTexture,      "textures/Player.png"},
+        {&BackgroundTexture,  "textures/DeepBlue.png"},
+        {&WallTexture,        "textures/Yellow.png"},
+        {&BulletTexture,      "textures/Bullet.png"},
+        {&PointerTexture,     "textures/Pointer.png"},
+        {&WandererTexture,    "textures/Wanderer.png"},
+        {&SeekerTexture,      "textures/Seeker.png"},
+        {&KamikazeTexture,    "textures/Kamikaze.png"},
+    };
+    struct { sound_effect **SoundEffect; char *Filename; } StartupSounds[] =
+    {
+        {&Shot,         "audio/Shoot1.wav"},
+        {&PlayerDeath,  "audio/Explosion1.wav"},
+        {&PlayerDamage, "audio/Explosion6.wav"},
+    };
+    char *DebugFontFilename = "fonts/LiberationMono-Regular.ttf";
+    char *UIFontFilename = "fonts/NovaSquare-Regular.ttf";
+    char *UIGlyphsName = "fonts/NovaSquare-Regular.ttf.sdf"; // Its glyphs, rasterized by the pack tool
+
+    // The music is streamed, opening it decodes nothing
+    Song = S_CreateMusic("audio/Music.mp3");
+
+    if(Archive)
+    {
+        DebugFont = R_CreateFont(Renderer, A_FindAsset(Archive, DebugFontFilename), 14, 14);
+        UIFont    = R_CreateFont(Renderer, A_FindAsset(Archive, UIFontFilename), 30, 30, true); // Distance field, scaled with the window
+        if(UIFont) { R_LoadGlyphSet(UIFont, A_FindAsset(Archive, UIGlyphsName)); }
+        for(u32 i = 0; i < ArrayCount(StartupTextures); i++)
+        {
+            *StartupTextures[i].Texture = R_CreateTexture(A_FindAsset(Archive, StartupTextures[i].Filename));
+        }
+        for(u32 i = 0; i < ArrayCount(StartupSounds); i++)
+        {
+            *StartupSounds[i].SoundEffect = S_CreateSoundEffect(A_FindAsset(Archive, StartupSounds[i].Filename));
+        }
+    }
+    else
+    {
+        DebugFont = R_CreateFont(Renderer, DebugFontFilename, 14, 14);
+        UIFont    = R_CreateFont(Renderer, UIFontFilename, 30, 30, true); // Distance field, scaled with the window
+
+        // Textures and sound effects are decoded on worker threads, the
+        // main thread uploads them as they finish and draws a loading frame
+        asset_loader *Loader = A_CreateAssetLoader();
+        for(u32 i = 0; i < ArrayCount(StartupTextures); i++)
+        {
+            A_LoadTexture(Loader, StartupTextures[i].Texture, StartupTextures[i].Filename);
+        }
+        for(u32 i = 0; i < ArrayCount(StartupSounds); i++)
+        {
+            A_LoadSoundEffect(Loader, StartupSounds[i].SoundEffect, StartupSounds[i].Filename);
+        }
+        A_StartLoading(Loader);
+
+        R_UpdateCamera(Renderer, Camera);
+        while(!A_UpdateLoading(Loader))
+        {
+            SDL_PumpEvents();
+
+            char String[32];
+            snprintf(String, sizeof(String), "Loading %u/%u", Loader->JobsFinished, Loader->JobCount);
+            R_BeginFrame(Renderer);
+            R_DrawText2D(Renderer, String, DebugFont, glm::vec2(4.0f, Window->Height - DebugFont->Height), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+            R_EndFrame(Renderer);
+        }
+        A_DestroyAssetLoader(Loader);
+    }
 
     // Create Game Entities
-    InitialScreen  = E_CreateEntity(InitScreenTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
-    PauseScreen    = E_CreateEntity(PauseScreenTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
-    GameOverScreen = E_CreateEntity(GameOverTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
-    GameBackground = E_CreateEntity(BackgroundTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
-    LeftWall       = E_CreateEntity(WallTexture, glm::vec3(WorldLeft - 1.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
-    RightWall      = E_CreateEntity(WallTexture, glm::vec3(WorldRight + 1.0f, 0.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f, BackgroundHeight, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
-    TopWall        = E_CreateEntity(WallTexture, glm::vec3(0.0f, WorldTop + 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(BackgroundWidth, 1.0f, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
-    BottomWall     = E_CreateEntity(WallTexture, glm::vec3(0.0f, WorldBottom - 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(BackgroundWidth, 1.0f, 0.0f), 0.0f, 0.0f, 0.0f, EntityType_Wall, Collider_Rectangle);
-    Player         = E_CreateEntity(PlayerTexture, PlayerInitialPosition, glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f), 0.0f, PlayerSpeed, PlayerDrag, EntityType_Player, Collider_Circle);
+    InitialScreen  = E_CreateEntity(InitScreenTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
+    PauseScreen    = E_CreateEntity(PauseScreenTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
+    GameOverScreen = E_CreateEntity(GameOverTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
+    GameBackground = E_CreateEntity(BackgroundTexture, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0), glm::vec3(BackgroundWidth, BackgroundHeight, 0.0f), RotationIdentity, 0.0f, 0.0f, EntityType_None, Collider_Rectangle);
 
     GameBegin();
+    S_PlayMusic(Song);
+    IsRunning = 1;
+
+    if(ReplayPlaying())
+    {
+        CurrentState = State_Game;
+        EnableBloom = 1;
+        RP_Seek(Replay, ReplaySeekTick);
+        ReplayStartCounter = SDL_GetPerformanceCounter();
+    }
     while(IsRunning)
     {
         P_UpdateClock(Clock);
@@ -594,16 +482,18 @@ i32 main(i32 Argc, char **Argv)
                         if (I_IsPressed(SDL_SCANCODE_SPACE) && I_IsPressed(SDL_SCANCODE_LSHIFT)) { R_ResetCamera(Camera, Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)); I_ResetMouse(Mouse); }
                     }
 
-                    // Player Input and movement
-                    if (I_IsPressed(SDL_SCANCODE_W) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { Player->Acceleration.y += Player->Speed; }
-                    if (I_IsPressed(SDL_SCANCODE_A) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { Player->Acceleration.x -= Player->Speed; }
-                    if (I_IsPressed(SDL_SCANCODE_S) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { Player->Acceleration.y -= Player->Speed; }
-                    if (I_IsPressed(SDL_SCANCODE_D) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { Player->Acceleration.x += Player->Speed; }
+                    // Player Input, applied by every simulation tick of this frame
+                    GameInput.Move = glm::vec2(0.0f);
+                    if (I_IsPressed(SDL_SCANCODE_W) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { GameInput.Move.y += 1.0f; }
+                    if (I_IsPressed(SDL_SCANCODE_A) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { GameInput.Move.x -= 1.0f; }
+                    if (I_IsPressed(SDL_SCANCODE_S) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { GameInput.Move.y -= 1.0f; }
+                    if (I_IsPressed(SDL_SCANCODE_D) && I_IsNotPressed(SDL_SCANCODE_LSHIFT)) { GameInput.Move.x += 1.0f; }
+                    GameInput.MouseWorldPosition = Mouse->WorldPosition;
 
-                    // Fire Bullet on Mouse Button Left press
-                    if(I_IsMouseButtonPressed(SDL_BUTTON_LEFT) && I_WasMouseButtonNotPressed(SDL_BUTTON_LEFT)) { FireBullet(); }
-
-                    ApplyEnemyInputs();
+                    // Fire Bullet on Mouse Button Left press, kept
+                    // until a tick runs so a click is not lost on a
+                    // frame without ticks
+                    if(I_IsMouseButtonPressed(SDL_BUTTON_LEFT) && I_WasMouseButtonNotPressed(SDL_BUTTON_LEFT)) { GameInput.Fire = true; }
 
                     break;
                 }
@@ -624,14 +514,12 @@ i32 main(i32 Argc, char **Argv)
                 {
                     if (I_IsPressed(SDL_SCANCODE_ESCAPE) && I_WasNotPressed(SDL_SCANCODE_ESCAPE)) { IsRunning = 0; }
 
-                    if (I_IsPressed(SDL_SCANCODE_SPACE) && I_WasNotPressed(SDL_SCANCODE_SPACE))
+                    // While playing a replay, the replay decides when the game restarts
+                    if (I_IsPressed(SDL_SCANCODE_SPACE) && I_WasNotPressed(SDL_SCANCODE_SPACE) && !ReplayPlaying())
                     {
-                        PlayerScore = 0;
-                        CurrentState = State_Game;
-                        E_EmptyList(Enemies);
-                        E_EmptyList(Bullets);
-                        Player->Position = PlayerInitialPosition;
-                        PlayerLives = 3;
+                        GameReset();
+                        PS_Clear(Particles);
+                        ReplayResetPending = true;
                         EnableBloom = 1;
                         R_ResetCamera(Camera, Window->Width, Window->Height, glm::vec3(0.0f, 0.0f, 11.5f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
                     }
@@ -649,50 +537,83 @@ i32 main(i32 Argc, char **Argv)
             // Toggle fullscreen in every Game_State, that's why its outside of the switch statement
             if (I_IsReleased(SDL_SCANCODE_RETURN) && I_IsPressed(SDL_SCANCODE_LALT))
             {
+                // The frame graph picks the new size up next frame
                 P_ToggleFullscreen(Window);
-                R_ResizeRenderer(Renderer, Window->Width, Window->Height);
             }
 
         } // SECTION END: Input Handling
 
         { // SECTION: Update
-            switch(CurrentState)
+            // Fixed timestep, run as many ticks as the elapsed real
+            // time allows. Ticks also elapse outside of the game state
+            // so the accumulator does not build up while paused.
+            u64 FrameStart = SDL_GetPerformanceCounter();
+            while(P_TickPending(Clock) || ReplayFastTickPending(FrameStart))
             {
-                case State_Initial:
-                {
-                    break;
-                }
-                case State_Game:
+                switch(CurrentState)
                 {
-                    SpawnEnemies();
-
-                    UpdatePlayerPosition();
-                    UpdateEnemyPositions();
-                    UpdateBulletPositions();
+                    case State_Initial:
+                    {
+                        break;
+                    }
+                    case State_Game:
+                    {
+                        if(ReplayPlaying())
+                        {
+                            PlayReplayTick();
+                            break;
+                        }
 
-                    CollisionPlayerVsWalls();
-                    CollisionPlayerVsEnemies();
-                    CollisionEnemiesVsBullets();
+                        if(Replay)
+                        {
+                            RP_RecordTick(Replay, &GameInput, ReplayResetPending);
+                            ReplayResetPending = false;
+                        }
 
-                    break;
-                }
-                case State_Pause:
-                {
-                    break;
-                }
-                case State_GameOver:
-                {
-                    break;
-                }
-                default:
-                {
-                    // Invalid code path
-                    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Critical Error", "UpdateState invalid code path: default", Window->Handle);
-                    exit(0);
-                    break;
+                        game_events Events = {};
+                        SimulateGameTick(&GameInput, &Events, (f32)Clock->TickDelta);
+                        PlayGameEvents(&Events);
+                        break;
+                    }
+                    case State_Pause:
+                    {
+                        break;
+                    }
+                    case State_GameOver:
+                    {
+                        // The next tick of a replay restarts the game
+                        if(ReplayPlaying())
+                        {
+                            PlayReplayTick();
+                        }
+                        break;
+                    }
+                    default:
+                    {
+                        // Invalid code path
+                        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Critical Error", "UpdateState invalid code path: default", Window->Handle);
+                        exit(0);
+                        break;
+                    }
                 }
+
+                P_AdvanceTick(Clock);
+            }
+            if(ReplayPlaying() && ReplayFast)
+            {
+                Clock->Accumulator = 0.0;
+            }
+
+            // Particles are not part of the simulation, they move with
+            // the frame time and stop while paused
+            if(CurrentState == State_Game)
+            {
+                u64 ParticleStart = SDL_GetPerformanceCounter();
+                PS_Update(Particles, (f32)Clock->DeltaTime);
+                ParticleUpdateMs = (f32)((f64)(SDL_GetPerformanceCounter() - ParticleStart) * 1000.0 / (f64)SDL_GetPerformanceFrequency());
             }
 
+            Renderer->InterpolationAlpha = P_TickAlpha(Clock);
             R_UpdateCamera(Renderer, Camera);
 
         } // SECTION END: Update
@@ -705,21 +626,21 @@ i32 main(i32 Argc, char **Argv)
                 case State_Initial:
                 {
                     Renderer->BackgroundColor = MenuBackgroundColor;
-                    R_SetActiveShader(Renderer->Shaders.Texture);
-                    R_DrawEntity(Renderer, InitialScreen);
+                    R_DrawEntity(Renderer, InitialScreen, Layer_Background);
                     break;
                 }
                 case State_Game:
                 {
                     Renderer->BackgroundColor = BackgroundColor;
 
-                    R_SetActiveShader(Renderer->Shaders.Texture);
-
-                    R_DrawEntity(Renderer, GameBackground);
+                    // Recorded, R_EndFrame sorts and draws everything
+                    // by layer
+                    R_DrawEntity(Renderer, GameBackground, Layer_Background);
                     R_DrawEntity(Renderer, Player);
 
                     R_DrawEntityList(Renderer, Enemies);
                     R_DrawEntityList(Renderer, Bullets);
+                    R_DrawParticles(Renderer, Particles);
 
                     // Draw Mouse Pointer. The Position needs
                     // adjustment since R_DrawTexture draws
@@ -729,21 +650,34 @@ i32 main(i32 Argc, char **Argv)
                     glm::vec3 CorrectedCursorPosition = glm::vec3(Mouse->WorldPosition.x - (CursorSize.x / 2.0f),
                                                                   Mouse->WorldPosition.y - (CursorSize.y / 2.0f),
                                                                   0.1f);
-                    R_DrawTexture(Renderer, PointerTexture, CorrectedCursorPosition, CursorSize, glm::vec3(0.0f), 0.0f);
+                    R_DrawTexture(Renderer, PointerTexture, CorrectedCursorPosition, CursorSize, RotationIdentity, Layer_Overlay);
 
-                    // Draw player score
+                    // The HUD is laid out for the default window
+                    // height and scaled with the window, the distance
+                    // field font stays sharp at any size
+                    f32 UIScale = (f32)Window->Height / (f32)WindowHeight;
+                    f32 UIWidth = UIFont->Width * UIScale;
+                    f32 UIHeight = UIFont->Height * UIScale;
+
+                    // Draw player score and lives, retained until they change
                     char StringBuffer[80];
                     sprintf_s(StringBuffer, "Score: %d", PlayerScore);
-                    R_DrawText2D(Renderer, StringBuffer, UIFont, glm::vec2(Window->Width - UIFont->Width * 5 , Window->Height-UIFont->Height * 2), glm::vec2(1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                    R_DrawTextRetained(Renderer, StringBuffer, UIFont, glm::vec2(Window->Width - UIWidth * 5 , Window->Height - UIHeight * 2), glm::vec2(UIScale), glm::vec3(1.0f, 1.0f, 1.0f));
 
-                    // Draw player Lives
                     sprintf_s(StringBuffer, "Lives: %d", PlayerLives);
-                    R_DrawText2D(Renderer, StringBuffer, UIFont, glm::vec2(Window->Width - UIFont->Width * 5 , Window->Height-UIFont->Height), glm::vec2(1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                    R_DrawTextRetained(Renderer, StringBuffer, UIFont, glm::vec2(Window->Width - UIWidth * 5 , Window->Height - UIHeight), glm::vec2(UIScale), glm::vec3(1.0f, 1.0f, 1.0f));
 
-                    // Draw debug data to the screen, the current text
-                    // rendering implementation sucks ass, so while
-                    // rendering the debug data the frame tanks unless
-                    // the computer is powerful.
+                    // Draw replay progress
+                    if(ReplayPlaying())
+                    {
+                        sprintf_s(StringBuffer, "Replay: %u/%u", Replay->Tick, Replay->Header.TickCount);
+                        R_DrawText2D(Renderer, StringBuffer, UIFont, glm::vec2(Window->Width - UIWidth * 8 , Window->Height - UIHeight * 3), glm::vec2(UIScale), glm::vec3(1.0f, 1.0f, 1.0f));
+                    }
+
+                    // Draw debug data to the screen. Lines that change
+                    // at most a few times a second are retained
+                    // meshes, the ones that change every frame are
+                    // laid out again.
                     if(DebugMode)
                     {
                         // String buffer used for snprintf
@@ -751,26 +685,26 @@ i32 main(i32 Argc, char **Argv)
 
                         // GPU and OpenGL stuff
                         f32 LeftMargin = 4.0f;
-                        R_DrawText2D(Renderer, "GPU:", DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
-                        R_DrawText2D(Renderer, (char*)Renderer->HardwareVendor, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 2), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
-                        R_DrawText2D(Renderer, (char*)Renderer->HardwareModel, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 3), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, "GPU:", DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, (char*)Renderer->HardwareVendor, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 2), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, (char*)Renderer->HardwareModel, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 3), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
                         snprintf(String, sizeof(char) * 99,"OpenGL Version: %s", Renderer->OpenGLVersion);
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 4), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 4), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
                         snprintf(String, sizeof(char) * 99,"GLSL Version: %s", Renderer->GLSLVersion);
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 5), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 5), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
 
                         // CPU
-                        R_DrawText2D(Renderer, "CPU:", DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 6), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, "CPU:", DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 6), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
                         snprintf(String, sizeof(char) * 99,"Cache Line Size: %d", SDL_GetCPUCacheLineSize());
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 7), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 7), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
                         snprintf(String, sizeof(char) * 99,"Core Count: %d", SDL_GetCPUCount());
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 8), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * 8), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
 
                         // FPS Min Ms/Max Ms/ Avg Ms
                         snprintf(String, sizeof(char) * 99,"FPS: %.4f", Renderer->FPS);
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 9), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 9), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
                         snprintf(String, sizeof(char) * 99,"Average Ms Per Frame: %.5f", Renderer->AverageMsPerFrame);
-                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 10), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        R_DrawTextRetained(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 10), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
 
                         // Player World Position
                         snprintf(String, sizeof(char) * 99,"Player->WorldPosition: X:%.2f Y:%.2f", Player->Position.x, Player->Position.y);
@@ -783,6 +717,20 @@ i32 main(i32 Argc, char **Argv)
                         // Entity Count
                         snprintf(String, sizeof(char) * 99,"EntityCount: %d", Enemies->Count + Bullets->Count + 1); // The + 1 means the player
                         R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 13), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+
+                        // Particle count and CPU time of their update
+                        snprintf(String, sizeof(char) * 99,"Particles: %u (%.3f ms)", Particles->Count, ParticleUpdateMs);
+                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 14), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+
+                        // GPU time of every render pass, a few frames old
+                        gpu_timers *Timers = &Renderer->GPUTimers;
+                        snprintf(String, sizeof(char) * 99,"GPU Ms Per Frame: %.3f", Timers->TotalMilliseconds);
+                        R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin, Window->Height - DebugFont->Height * 15), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        for(u32 i = 0; i < Timers->Count; i++)
+                        {
+                            snprintf(String, sizeof(char) * 99,"%s: %.3f", Timers->Names[i], Timers->Milliseconds[i]);
+                            R_DrawText2D(Renderer, String, DebugFont, glm::vec2(LeftMargin * 2, Window->Height - DebugFont->Height * (16 + i)), glm::vec2(1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+                        }
                     }
 
                     break;
@@ -790,16 +738,14 @@ i32 main(i32 Argc, char **Argv)
                 case State_Pause:
                 {
                     Renderer->BackgroundColor = MenuBackgroundColor;
-                    R_SetActiveShader(Renderer->Shaders.Texture);
-                    R_DrawEntity(Renderer, PauseScreen);
+                    R_DrawEntity(Renderer, PauseScreen, Layer_Background);
 
                     break;
                 }
                 case State_GameOver:
                 {
                     Renderer->BackgroundColor = MenuBackgroundColor;
-                    R_SetActiveShader(Renderer->Shaders.Texture);
-                    R_DrawEntity(Renderer, GameOverScreen);
+                    R_DrawEntity(Renderer, GameOverScreen, Layer_Background);
                     break;
                 }
                 default:
@@ -810,9 +756,21 @@ i32 main(i32 Argc, char **Argv)
             }
 
             R_EndFrame(Renderer);
+
+            if(StartupCounter)
+            {
+                printf("Startup took %.2f ms\n", (f64)(SDL_GetPerformanceCounter() - StartupCounter) * 1000.0 / (f64)SDL_GetPerformanceFrequency());
+                StartupCounter = 0;
+            }
         } // SECTION END: Render
     }
 
+    if(Replay && Replay->Recording)
+    {
+        RP_SaveReplay(Replay, ReplayFilename);
+    }
+
+    R_CloseGPUTimerLog(Renderer);
     SDL_GL_DeleteContext(Window->Handle);
 
     return 0;
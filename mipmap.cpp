@@ -0,0 +1,101 @@
+#pragma once
+
+#include "shared.h"
+
+/*
+  Mip chains of decoded images, built by the pack tool for the archive
+  and by the asset workers for loose textures, so the GPU never has to
+  generate them. The levels follow each other in one buffer, from the
+  full size down to 1x1, see archive.h
+*/
+
+global f32 SRGBToLinear[256];
+
+// Call once before building any chain, the table is only read after
+void R_InitMipmaps()
+{
+    for(i32 i = 0; i < 256; i++)
+    {
+        f32 Value = i / 255.0f;
+        SRGBToLinear[i] = (Value <= 0.04045f) ? Value / 12.92f : powf((Value + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+u8 R_LinearToSRGB(f32 Value)
+{
+    Value = (Value <= 0.0031308f) ? Value * 12.92f : 1.055f * powf(Value, 1.0f / 2.4f) - 0.055f;
+    i32 Result = (i32)(Value * 255.0f + 0.5f);
+    return (u8)(Result < 0 ? 0 : (Result > 255 ? 255 : Result));
+}
+
+// Halves Source into Dest with a box filter. The color channels are
+// averaged in linear space like the GPU filters sRGB textures, alpha
+// as it is. Odd edges reuse the last row or column
+void R_DownsampleMip(u8 *Source, i32 SourceWidth, i32 SourceHeight, u8 *Dest, i32 Width, i32 Height, i32 ChannelCount)
+{
+    for(i32 y = 0; y < Height; y++)
+    {
+        for(i32 x = 0; x < Width; x++)
+        {
+            i32 X0 = x * 2;
+            i32 Y0 = y * 2;
+            i32 X1 = (X0 + 1 < SourceWidth) ? X0 + 1 : X0;
+            i32 Y1 = (Y0 + 1 < SourceHeight) ? Y0 + 1 : Y0;
+            u8 *Texels[4] =
+            {
+                Source + (Y0 * SourceWidth + X0) * ChannelCount,
+                Source + (Y0 * SourceWidth + X1) * ChannelCount,
+                Source + (Y1 * SourceWidth + X0) * ChannelCount,
+                Source + (Y1 * SourceWidth + X1) * ChannelCount,
+            };
+
+            u8 *Out = Dest + (y * Width + x) * ChannelCount;
+            for(i32 Channel = 0; Channel < ChannelCount; Channel++)
+            {
+                if(Channel < 3)
+                {
+                    f32 Sum = 0.0f;
+                    for(i32 i = 0; i < 4; i++) { Sum += SRGBToLinear[Texels[i][Channel]]; }
+                    Out[Channel] = R_LinearToSRGB(Sum * 0.25f);
+                }
+                else
+                {
+                    i32 Sum = 0;
+                    for(i32 i = 0; i < 4; i++) { Sum += Texels[i][Channel]; }
+                    Out[Channel] = (u8)((Sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+// Bytes of the whole chain, every level down to 1x1
+u64 R_MipChainSize(i32 Width, i32 Height, i32 ChannelCount, i32 *MipCount)
+{
+    *MipCount = 1;
+    u64 Size = (u64)Width * Height * ChannelCount;
+    while(Width > 1 || Height > 1)
+    {
+        Width = (Width > 1) ? Width / 2 : 1;
+        Height = (Height > 1) ? Height / 2 : 1;
+        Size += (u64)Width * Height * ChannelCount;
+        (*MipCount)++;
+    }
+    return Size;
+}
+
+// Pixels holds level 0, followed by room for the rest of the chain
+void R_BuildMipChain(u8 *Pixels, i32 Width, i32 Height, i32 ChannelCount, i32 MipCount)
+{
+    u8 *Source = Pixels;
+    for(i32 Level = 1; Level < MipCount; Level++)
+    {
+        i32 MipWidth = (Width > 1) ? Width / 2 : 1;
+        i32 MipHeight = (Height > 1) ? Height / 2 : 1;
+        u8 *Dest = Source + (u64)Width * Height * ChannelCount;
+        R_DownsampleMip(Source, Width, Height, Dest, MipWidth, MipHeight, ChannelCount);
+        Source = Dest;
+        Width = MipWidth;
+        Height = MipHeight;
+    }
+}
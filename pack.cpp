@@ -0,0 +1,729 @@
+/*
+
+  Asset cooker, converts the source assets into the runtime formats and
+  writes the archive the game maps at startup instead of loading the
+  loose files, see archive.h for the format. Run it from the build
+  directory so the asset names match the paths the game uses.
+
+  Usage: pack [-cache DIR] [-force] OUTPUT FILE...
+
+    pack assets.pak textures/Player.png fonts/NovaSquare-Regular.ttf audio/Shoot1.wav shaders/text.glsl ...
+
+    -cache  Directory of the cooked assets and their manifest, default cooked
+    -force  Cook every file even if it did not change
+
+  The type of every file comes from its extension:
+
+    .png .jpg  Decoded, flipped and mipmapped
+    .ttf .otf  Stored as is, plus its printable ASCII glyphs rasterized
+               as a distance field, see R_LoadGlyphSet
+    .wav       Converted to 16 bit stereo 44100 Hz, the mixer format
+    .glsl      Comments stripped
+
+  Every cooked file is kept in the cache with the hash of its source in
+  the manifest. Files whose hash did not change are not cooked again,
+  only copied into the archive, so changing one texture only re-cooks
+  that texture. The music is streamed by SDL_mixer and stays a loose
+  file.
+
+ */
+
+// No SDL, see shared.h
+#define GLOW_HEADLESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "shared.h"
+#include "archive.h"
+#include "glyph.cpp"
+#include "mipmap.cpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "external/stb_image.h"
+
+// Bump when the output of a cook function changes, everything is
+// cooked again
+#define COOK_VERSION 1
+#define COOKED_MAGIC 0x4B4F4F43 // "COOK"
+#define COOK_MAX_FILES 256
+#define COOK_MAX_ASSETS 2 // Assets cooked from one file
+#define COOK_FIRST_GLYPH 32
+#define COOK_LAST_GLYPH 126
+
+global FT_Library Library;
+
+struct pack_buffer
+{
+    u8 *Data;
+    u64 Size;
+};
+
+struct cooked_asset
+{
+    archive_entry Entry; // Offset unused until the archive is written
+    pack_buffer Data;
+};
+
+// Everything cooked from one source file, saved in the cache as a
+// cooked_file_header, AssetCount archive_entry and their data, the
+// entry offsets relative to the start of the file
+struct cooked_file
+{
+    u64 Hash;
+    u32 AssetCount;
+    cooked_asset Assets[COOK_MAX_ASSETS];
+};
+
+struct cooked_file_header
+{
+    u32 Magic;
+    u32 AssetCount;
+    u64 Hash;
+};
+
+struct manifest
+{
+    char Names[COOK_MAX_FILES][ARCHIVE_MAX_NAME];
+    u64 Hashes[COOK_MAX_FILES];
+    u32 Count;
+};
+
+b32 ReadEntireFile(char *Filename, pack_buffer *Result)
+{
+    *Result = {};
+    FILE *File = fopen(Filename, "rb");
+    if(!File)
+    {
+        return false;
+    }
+
+    fseek(File, 0, SEEK_END);
+    Result->Size = (u64)ftell(File);
+    fseek(File, 0, SEEK_SET);
+    Result->Data = (u8*)Malloc(Result->Size);
+    b32 Success = fread(Result->Data, 1, Result->Size, File) == Result->Size;
+    fclose(File);
+    return Success;
+}
+
+void FreeBuffer(pack_buffer *Buffer)
+{
+    if(Buffer->Data)
+    {
+        Free(Buffer->Data);
+    }
+    *Buffer = {};
+}
+
+// FNV-1a
+u64 HashBytes(u64 Hash, void *Data, u64 Size)
+{
+    u8 *Bytes = (u8*)Data;
+    for(u64 i = 0; i < Size; i++)
+    {
+        Hash = (Hash ^ Bytes[i]) * 0x100000001B3ull;
+    }
+    return Hash;
+}
+
+// The hash of a source file also covers the cooker version and the
+// glyph settings, changing them cooks everything again
+u64 HashSource(pack_buffer *File)
+{
+    i32 Settings[] = {COOK_VERSION, FontAtlasPadding, FontDistanceFieldSize, FontDistanceFieldSpread, FontDistanceFieldOversample};
+    u64 Hash = HashBytes(0xCBF29CE484222325ull, Settings, sizeof(Settings));
+    return HashBytes(Hash, File->Data, File->Size);
+}
+
+b32 CookTexture(pack_buffer *File, cooked_file *Cooked)
+{
+    cooked_asset *Asset = &Cooked->Assets[0];
+    archive_entry *Entry = &Asset->Entry;
+    Entry->Type = ArchiveEntry_Texture;
+
+    stbi_set_flip_vertically_on_load(1);
+    u8 *Pixels = stbi_load_from_memory(File->Data, (i32)File->Size, &Entry->Width, &Entry->Height, &Entry->ChannelCount, 0);
+    if(!Pixels)
+    {
+        printf("%s: %s\n", Entry->Name, stbi_failure_reason());
+        return false;
+    }
+    if(Entry->ChannelCount != 3 && Entry->ChannelCount != 4)
+    {
+        printf("%s: Texture format is not RGB or RGBA\n", Entry->Name);
+        stbi_image_free(Pixels);
+        return false;
+    }
+
+    u64 Size = R_MipChainSize(Entry->Width, Entry->Height, Entry->ChannelCount, &Entry->MipCount);
+    Asset->Data.Size = Size;
+    Asset->Data.Data = (u8*)Malloc(Size);
+    memcpy(Asset->Data.Data, Pixels, (u64)Entry->Width * Entry->Height * Entry->ChannelCount);
+    stbi_image_free(Pixels);
+
+    R_BuildMipChain(Asset->Data.Data, Entry->Width, Entry->Height, Entry->ChannelCount, Entry->MipCount);
+
+    Cooked->AssetCount = 1;
+    return true;
+}
+
+// The font file as is, FreeType reads it from the archive, and a second
+// asset with its glyphs as the renderer rasterizes them for distance
+// field fonts, see R_RasterizeGlyphPixels
+b32 CookFont(pack_buffer *File, cooked_file *Cooked)
+{
+    cooked_asset *Font = &Cooked->Assets[0];
+    cooked_asset *Glyphs = &Cooked->Assets[1];
+    Font->Entry.Type = ArchiveEntry_Font;
+
+    FT_Face Face;
+    if(FT_New_Memory_Face(Library, File->Data, (FT_Long)File->Size, 0, &Face) != 0)
+    {
+        printf("%s: FreeType could not read the font\n", Font->Entry.Name);
+        return false;
+    }
+
+    archive_glyph_set Set = {};
+    Set.GlyphSize = FontDistanceFieldSize;
+    Set.Spread = FontDistanceFieldSpread;
+    Set.Oversample = FontDistanceFieldOversample;
+    Set.GlyphCount = COOK_LAST_GLYPH - COOK_FIRST_GLYPH + 1;
+    R_SetGlyphPixelSize(Face, true, 0, 0);
+    R_GlyphCellSize(Face, true, &Set.CellWidth, &Set.CellHeight);
+
+    u64 CellSize = (u64)Set.CellWidth * Set.CellHeight;
+    Glyphs->Data.Size = sizeof(archive_glyph_set) + Set.GlyphCount * (sizeof(archive_glyph) + CellSize);
+    Glyphs->Data.Data = (u8*)Malloc(Glyphs->Data.Size);
+    memcpy(Glyphs->Data.Data, &Set, sizeof(Set));
+    archive_glyph *Glyph = (archive_glyph*)(Glyphs->Data.Data + sizeof(archive_glyph_set));
+    u8 *Cell = (u8*)(Glyph + Set.GlyphCount);
+    for(u32 Codepoint = COOK_FIRST_GLYPH; Codepoint <= COOK_LAST_GLYPH; Codepoint++)
+    {
+        character Character;
+        R_RasterizeGlyphPixels(Face, Codepoint, true, Cell, Set.CellWidth, Set.CellHeight, &Character);
+        Glyph->Codepoint = Codepoint;
+        Glyph->Advance = Character.Advance;
+        Glyph->Width = Character.Size.x;
+        Glyph->Height = Character.Size.y;
+        Glyph->BearingX = Character.Bearing.x;
+        Glyph->BearingY = Character.Bearing.y;
+        Glyph++;
+        Cell += CellSize;
+    }
+    FT_Done_Face(Face);
+
+    Glyphs->Entry.Type = ArchiveEntry_Glyphs;
+    strcpy(Glyphs->Entry.Name, Font->Entry.Name);
+    strcat(Glyphs->Entry.Name, ".sdf");
+    Font->Data.Size = File->Size;
+    Font->Data.Data = (u8*)Malloc(File->Size);
+    memcpy(Font->Data.Data, File->Data, File->Size);
+    Cooked->AssetCount = 2;
+    return true;
+}
+
+// Reads sample Index of channel Channel as -1 to 1
+f32 ReadSample(u8 *Samples, u32 Format, u32 BitsPerSample, u32 ChannelCount, u64 Index, u32 Channel)
+{
+    u64 At = (Index * ChannelCount + Channel) * (BitsPerSample / 8);
+    if(Format == 3)
+    {
+        f32 Value;
+        memcpy(&Value, Samples + At, sizeof(Value));
+        return Value;
+    }
+    if(BitsPerSample == 8)
+    {
+        return ((i32)Samples[At] - 128) / 128.0f;
+    }
+
+    i16 Value;
+    memcpy(&Value, Samples + At, sizeof(Value));
+    return Value / 32768.0f;
+}
+
+// 8 or 16 bit PCM or 32 bit float, mono or stereo, at any rate, is
+// converted to the mixer format and resampled linearly. This assumes
+// the device opens at ARCHIVE_SOUND_FREQUENCY and ARCHIVE_SOUND_CHANNELS
+// like S_CreateSoundSystem asks, when it does not the game converts the
+// samples again at load, see S_CreateSoundEffect
+b32 CookSound(pack_buffer *File, cooked_file *Cooked)
+{
+    cooked_asset *Asset = &Cooked->Assets[0];
+    archive_entry *Entry = &Asset->Entry;
+    Entry->Type = ArchiveEntry_Sound;
+
+    u8 *At = File->Data;
+    u8 *End = File->Data + File->Size;
+    if(File->Size < 12 || memcmp(At, "RIFF", 4) != 0 || memcmp(At + 8, "WAVE", 4) != 0)
+    {
+        printf("%s: Not a wav file\n", Entry->Name);
+        return false;
+    }
+    At += 12;
+
+    u16 Format = 0, ChannelCount = 0, BitsPerSample = 0;
+    u32 SampleRate = 0;
+    while(At + 8 <= End)
+    {
+        u32 ChunkSize;
+        memcpy(&ChunkSize, At + 4, sizeof(ChunkSize));
+        u8 *Chunk = At + 8;
+        if(ChunkSize > (u64)(End - Chunk))
+        {
+            break;
+        }
+
+        if(memcmp(At, "fmt ", 4) == 0 && ChunkSize >= 16)
+        {
+            memcpy(&Format, Chunk, 2);
+            memcpy(&ChannelCount, Chunk + 2, 2);
+            memcpy(&SampleRate, Chunk + 4, 4);
+            memcpy(&BitsPerSample, Chunk + 14, 2);
+            if(Format == 0xFFFE && ChunkSize >= 26)
+            {
+                // WAVE_FORMAT_EXTENSIBLE, the format is the start of the sub format GUID
+                memcpy(&Format, Chunk + 24, 2);
+            }
+
+            b32 Supported = ((Format == 1 && (BitsPerSample == 8 || BitsPerSample == 16)) || (Format == 3 && BitsPerSample == 32)) &&
+                            (ChannelCount == 1 || ChannelCount == 2) && SampleRate > 0;
+            if(!Supported)
+            {
+                printf("%s: Format %d, %d channels, %d bits is not supported, convert it to 16 bit PCM\n",
+                       Entry->Name, Format, ChannelCount, BitsPerSample);
+                return false;
+            }
+        }
+        else if(memcmp(At, "data", 4) == 0 && SampleRate > 0)
+        {
+            u64 SourceFrames = ChunkSize / (ChannelCount * (BitsPerSample / 8));
+            u64 Frames = (SampleRate == ARCHIVE_SOUND_FREQUENCY) ? SourceFrames : (SourceFrames * ARCHIVE_SOUND_FREQUENCY + SampleRate - 1) / SampleRate;
+            Asset->Data.Size = Frames * ARCHIVE_SOUND_CHANNELS * sizeof(i16);
+            Asset->Data.Data = (u8*)Malloc(Asset->Data.Size);
+
+            i16 *Out = (i16*)Asset->Data.Data;
+            f64 Step = (f64)SampleRate / (f64)ARCHIVE_SOUND_FREQUENCY;
+            for(u64 Frame = 0; Frame < Frames; Frame++)
+            {
+                f64 Position = Frame * Step;
+                u64 Index = (u64)Position;
+                u64 Next = (Index + 1 < SourceFrames) ? Index + 1 : Index;
+                f32 Blend = (f32)(Position - (f64)Index);
+                for(u32 Channel = 0; Channel < ARCHIVE_SOUND_CHANNELS; Channel++)
+                {
+                    // Mono plays on both channels
+                    u32 SourceChannel = (ChannelCount == 1) ? 0 : Channel;
+                    f32 A = ReadSample(Chunk, Format, BitsPerSample, ChannelCount, Index, SourceChannel);
+                    f32 B = ReadSample(Chunk, Format, BitsPerSample, ChannelCount, Next, SourceChannel);
+                    f32 Value = (A + (B - A) * Blend) * 32768.0f;
+                    Value = (Value > 32767.0f) ? 32767.0f : ((Value < -32768.0f) ? -32768.0f : Value);
+                    *Out++ = (i16)lrintf(Value);
+                }
+            }
+
+            Cooked->AssetCount = 1;
+            return true;
+        }
+
+        // Chunks are padded to an even size
+        At = Chunk + ChunkSize + (ChunkSize & 1);
+    }
+
+    printf("%s: No PCM data found\n", Entry->Name);
+    return false;
+}
+
+// Comments are replaced with spaces, the line breaks stay so the line
+// numbers of compile errors match the source file
+b32 CookShader(pack_buffer *File, cooked_file *Cooked)
+{
+    cooked_asset *Asset = &Cooked->Assets[0];
+    Asset->Entry.Type = ArchiveEntry_Shader;
+    Asset->Data.Data = (u8*)Malloc(File->Size + 1);
+
+    char *Source = (char*)File->Data;
+    char *SourceEnd = Source + File->Size;
+    char *Out = (char*)Asset->Data.Data;
+    while(Source < SourceEnd)
+    {
+        if(Source + 1 < SourceEnd && Source[0] == '/' && Source[1] == '/')
+        {
+            while(Source < SourceEnd && *Source != '\n') { Source++; }
+        }
+        else if(Source + 1 < SourceEnd && Source[0] == '/' && Source[1] == '*')
+        {
+            Source += 2;
+            while(Source + 1 < SourceEnd && !(Source[0] == '*' && Source[1] == '/'))
+            {
+                if(*Source == '\n') { *Out++ = '\n'; }
+                Source++;
+            }
+            Source = (Source + 1 < SourceEnd) ? Source + 2 : SourceEnd;
+            *Out++ = ' ';
+        }
+        else
+        {
+            *Out++ = *Source++;
+        }
+    }
+    *Out++ = '\0';
+
+    Asset->Data.Size = (u64)(Out - (char*)Asset->Data.Data);
+    Cooked->AssetCount = 1;
+    return true;
+}
+
+b32 HasExtension(char *Filename, char *Extension)
+{
+    size_t Length = strlen(Filename);
+    size_t ExtensionLength = strlen(Extension);
+    return Length > ExtensionLength && strcmp(Filename + Length - ExtensionLength, Extension) == 0;
+}
+
+// Cache files are named after the source, with the directories flattened
+void CachePath(char *CacheDirectory, char *Name, char *Result, size_t ResultSize)
+{
+    snprintf(Result, ResultSize, "%s/%s.cooked", CacheDirectory, Name);
+    for(char *At = Result + strlen(CacheDirectory) + 1; *At; At++)
+    {
+        if(*At == '/' || *At == '\\') { *At = '_'; }
+    }
+}
+
+b32 WriteCookedFile(char *Path, cooked_file *Cooked)
+{
+    FILE *File = fopen(Path, "wb");
+    if(!File)
+    {
+        return false;
+    }
+
+    cooked_file_header Header = {COOKED_MAGIC, Cooked->AssetCount, Cooked->Hash};
+    fwrite(&Header, sizeof(Header), 1, File);
+    u64 Offset = sizeof(Header) + Cooked->AssetCount * sizeof(archive_entry);
+    for(u32 i = 0; i < Cooked->AssetCount; i++)
+    {
+        archive_entry Entry = Cooked->Assets[i].Entry;
+        Entry.Offset = Offset;
+        Entry.Size = Cooked->Assets[i].Data.Size;
+        fwrite(&Entry, sizeof(Entry), 1, File);
+        Offset += Entry.Size;
+    }
+    for(u32 i = 0; i < Cooked->AssetCount; i++)
+    {
+        fwrite(Cooked->Assets[i].Data.Data, 1, Cooked->Assets[i].Data.Size, File);
+    }
+
+    return fclose(File) == 0;
+}
+
+// Fails when the file is missing, damaged or was cooked from another
+// version of the source
+b32 ReadCookedFile(char *Path, u64 Hash, cooked_file *Cooked)
+{
+    *Cooked = {};
+    pack_buffer File;
+    if(!ReadEntireFile(Path, &File))
+    {
+        FreeBuffer(&File);
+        return false;
+    }
+
+    cooked_file_header *Header = (cooked_file_header*)File.Data;
+    b32 Valid = File.Size >= sizeof(cooked_file_header) &&
+                Header->Magic == COOKED_MAGIC &&
+                Header->Hash == Hash &&
+                Header->AssetCount > 0 && Header->AssetCount <= COOK_MAX_ASSETS &&
+                sizeof(cooked_file_header) + Header->AssetCount * sizeof(archive_entry) <= File.Size;
+    archive_entry *Entries = (archive_entry*)(Header + 1);
+    for(u32 i = 0; Valid && i < Header->AssetCount; i++)
+    {
+        Valid = Entries[i].Offset <= File.Size && Entries[i].Size <= File.Size - Entries[i].Offset;
+    }
+
+    if(Valid)
+    {
+        Cooked->Hash = Hash;
+        Cooked->AssetCount = Header->AssetCount;
+        for(u32 i = 0; i < Header->AssetCount; i++)
+        {
+            cooked_asset *Asset = &Cooked->Assets[i];
+            Asset->Entry = Entries[i];
+            Asset->Data.Size = Entries[i].Size;
+            Asset->Data.Data = (u8*)Malloc(Entries[i].Size);
+            memcpy(Asset->Data.Data, File.Data + Entries[i].Offset, Entries[i].Size);
+        }
+    }
+
+    FreeBuffer(&File);
+    return Valid;
+}
+
+// One "hash name" line per source file
+void ReadManifest(char *Path, manifest *Manifest)
+{
+    Manifest->Count = 0;
+    FILE *File = fopen(Path, "r");
+    if(!File)
+    {
+        return;
+    }
+
+    char Line[ARCHIVE_MAX_NAME + 32];
+    while(Manifest->Count < COOK_MAX_FILES && fgets(Line, sizeof(Line), File))
+    {
+        unsigned long long Hash;
+        char Name[ARCHIVE_MAX_NAME];
+        if(sscanf(Line, "%llx %63s", &Hash, Name) == 2)
+        {
+            Manifest->Hashes[Manifest->Count] = Hash;
+            strcpy(Manifest->Names[Manifest->Count], Name);
+            Manifest->Count++;
+        }
+    }
+    fclose(File);
+}
+
+b32 WriteManifest(char *Path, manifest *Manifest)
+{
+    FILE *File = fopen(Path, "w");
+    if(!File)
+    {
+        return false;
+    }
+
+    for(u32 i = 0; i < Manifest->Count; i++)
+    {
+        fprintf(File, "%016llx %s\n", (unsigned long long)Manifest->Hashes[i], Manifest->Names[i]);
+    }
+    return fclose(File) == 0;
+}
+
+b32 ManifestHas(manifest *Manifest, char *Name, u64 Hash)
+{
+    for(u32 i = 0; i < Manifest->Count; i++)
+    {
+        if(strcmp(Manifest->Names[i], Name) == 0)
+        {
+            return Manifest->Hashes[i] == Hash;
+        }
+    }
+    return false;
+}
+
+int CompareAssets(const void *A, const void *B)
+{
+    return strncmp((*(cooked_asset**)A)->Entry.Name, (*(cooked_asset**)B)->Entry.Name, ARCHIVE_MAX_NAME);
+}
+
+void WritePadding(FILE *File, u64 *Offset)
+{
+    u8 Zeros[ARCHIVE_ALIGNMENT] = {};
+    u64 Padding = (ARCHIVE_ALIGNMENT - (*Offset % ARCHIVE_ALIGNMENT)) % ARCHIVE_ALIGNMENT;
+    fwrite(Zeros, 1, Padding, File);
+    *Offset += Padding;
+}
+
+// Sorted by name so the game can binary search them
+b32 WriteArchive(char *Filename, cooked_asset **Assets, u32 AssetCount)
+{
+    FILE *Output = fopen(Filename, "wb");
+    if(!Output)
+    {
+        printf("Could not open %s\n", Filename);
+        return false;
+    }
+
+    qsort(Assets, AssetCount, sizeof(cooked_asset*), CompareAssets);
+
+    archive_header Header = {};
+    Header.Magic = ARCHIVE_MAGIC;
+    Header.Version = ARCHIVE_VERSION;
+    Header.EntryCount = AssetCount;
+    fwrite(&Header, sizeof(Header), 1, Output);
+    u64 Offset = sizeof(Header);
+
+    archive_entry *Entries = (archive_entry*)Malloc(sizeof(archive_entry) * (AssetCount + 1));
+    for(u32 i = 0; i < AssetCount; i++)
+    {
+        WritePadding(Output, &Offset);
+        Entries[i] = Assets[i]->Entry;
+        Entries[i].Offset = Offset;
+        Entries[i].Size = Assets[i]->Data.Size;
+        fwrite(Assets[i]->Data.Data, 1, Assets[i]->Data.Size, Output);
+        Offset += Assets[i]->Data.Size;
+    }
+
+    WritePadding(Output, &Offset);
+    Header.EntryOffset = Offset;
+    fwrite(Entries, sizeof(archive_entry), AssetCount, Output);
+    Offset += sizeof(archive_entry) * AssetCount;
+    Free(Entries);
+
+    fseek(Output, 0, SEEK_SET);
+    fwrite(&Header, sizeof(Header), 1, Output);
+    b32 Success = (fclose(Output) == 0);
+
+    printf("%s: %u assets, %.2f MB\n", Filename, AssetCount, (f64)Offset / (1024.0 * 1024.0));
+    return Success;
+}
+
+int main(int Argc, char **Argv)
+{
+    char *CacheDirectory = "cooked";
+    b32 Force = false;
+    i32 FirstArgument = 1;
+    for(; FirstArgument < Argc && Argv[FirstArgument][0] == '-'; FirstArgument++)
+    {
+        if(strcmp(Argv[FirstArgument], "-cache") == 0 && FirstArgument + 1 < Argc)
+        {
+            CacheDirectory = Argv[++FirstArgument];
+        }
+        else if(strcmp(Argv[FirstArgument], "-force") == 0)
+        {
+            Force = true;
+        }
+        else
+        {
+            printf("Unknown option %s\n", Argv[FirstArgument]);
+            return 1;
+        }
+    }
+    if(Argc - FirstArgument < 2 || Argc - FirstArgument - 1 > COOK_MAX_FILES)
+    {
+        printf("Usage: pack [-cache DIR] [-force] OUTPUT FILE...\n");
+        return 1;
+    }
+
+    R_InitMipmaps();
+    if(FT_Init_FreeType(&Library) != 0)
+    {
+        printf("FT_Init_FreeType failed, could not init FreeType Library\n");
+        return 1;
+    }
+
+#ifdef _WIN32
+    _mkdir(CacheDirectory);
+#else
+    mkdir(CacheDirectory, 0755);
+#endif
+    char ManifestPath[256];
+    snprintf(ManifestPath, sizeof(ManifestPath), "%s/manifest.txt", CacheDirectory);
+    manifest *Previous = (manifest*)Malloc(sizeof(manifest));
+    manifest *Current = (manifest*)Malloc(sizeof(manifest));
+    ReadManifest(ManifestPath, Previous);
+
+    char *OutputFilename = Argv[FirstArgument];
+    u32 FileCount = Argc - FirstArgument - 1;
+    cooked_file *Files = (cooked_file*)Malloc(sizeof(cooked_file) * FileCount);
+    cooked_asset **Assets = (cooked_asset**)Malloc(sizeof(cooked_asset*) * FileCount * COOK_MAX_ASSETS);
+    u32 AssetCount = 0;
+    u32 CookedCount = 0;
+    b32 Failed = false;
+    for(u32 i = 0; i < FileCount; i++)
+    {
+        char *Filename = Argv[FirstArgument + 1 + i];
+        cooked_file *Cooked = &Files[i];
+
+        // The glyphs of a font are stored under its name plus ".sdf"
+        if(strlen(Filename) + 4 >= ARCHIVE_MAX_NAME)
+        {
+            printf("%s: Name too long\n", Filename);
+            Failed = true;
+            continue;
+        }
+
+        pack_buffer Source;
+        if(!ReadEntireFile(Filename, &Source))
+        {
+            printf("%s: Could not read file\n", Filename);
+            FreeBuffer(&Source);
+            Failed = true;
+            continue;
+        }
+
+        u64 Hash = HashSource(&Source);
+        char CookedPath[256];
+        CachePath(CacheDirectory, Filename, CookedPath, sizeof(CookedPath));
+        b32 UpToDate = !Force && ManifestHas(Previous, Filename, Hash) && ReadCookedFile(CookedPath, Hash, Cooked);
+        if(!UpToDate)
+        {
+            *Cooked = {};
+            Cooked->Hash = Hash;
+            for(u32 j = 0; j < COOK_MAX_ASSETS; j++)
+            {
+                strcpy(Cooked->Assets[j].Entry.Name, Filename);
+            }
+
+            b32 Success = false;
+            if(HasExtension(Filename, ".png") || HasExtension(Filename, ".jpg"))
+            {
+                Success = CookTexture(&Source, Cooked);
+            }
+            else if(HasExtension(Filename, ".ttf") || HasExtension(Filename, ".otf"))
+            {
+                Success = CookFont(&Source, Cooked);
+            }
+            else if(HasExtension(Filename, ".wav"))
+            {
+                Success = CookSound(&Source, Cooked);
+            }
+            else if(HasExtension(Filename, ".glsl"))
+            {
+                Success = CookShader(&Source, Cooked);
+            }
+            else
+            {
+                printf("%s: Unknown asset type\n", Filename);
+            }
+
+            if(!Success)
+            {
+                for(u32 j = 0; j < COOK_MAX_ASSETS; j++) { FreeBuffer(&Cooked->Assets[j].Data); }
+                Cooked->AssetCount = 0;
+                FreeBuffer(&Source);
+                Failed = true;
+                continue;
+            }
+            if(!WriteCookedFile(CookedPath, Cooked))
+            {
+                printf("%s: Could not write %s\n", Filename, CookedPath);
+            }
+            printf("Cooked %s\n", Filename);
+            CookedCount++;
+        }
+        FreeBuffer(&Source);
+
+        strcpy(Current->Names[Current->Count], Filename);
+        Current->Hashes[Current->Count] = Hash;
+        Current->Count++;
+        for(u32 j = 0; j < Cooked->AssetCount; j++)
+        {
+            Assets[AssetCount++] = &Cooked->Assets[j];
+        }
+    }
+
+    // Files that failed are left out, they are cooked again next time
+    if(!WriteManifest(ManifestPath, Current))
+    {
+        printf("Could not write %s\n", ManifestPath);
+    }
+    printf("%u cooked, %u up to date\n", CookedCount, Current->Count - CookedCount);
+
+    if(!WriteArchive(OutputFilename, Assets, AssetCount))
+    {
+        Failed = true;
+    }
+
+    FT_Done_FreeType(Library);
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "particle.h"
+
+// Like the collision kernels, the update needs SSE2 and falls back to
+// the scalar loop everywhere else
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLE_SIMD 1
+#include <emmintrin.h>
+#else
+#define PARTICLE_SIMD 0
+#endif
+
+particle_system *PS_CreateParticleSystem(u32 Capacity, f32 Drag, u32 Seed)
+{
+    Assert(Capacity > 0 && Capacity % 4 == 0);
+    Assert(Seed != 0);
+
+    particle_system *Result = (particle_system*)Malloc(sizeof(particle_system)); Assert(Result);
+    Result->PositionX = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->PositionX);
+    Result->PositionY = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->PositionY);
+    Result->VelocityX = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->VelocityX);
+    Result->VelocityY = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->VelocityY);
+    Result->Life = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->Life);
+    Result->InverseLifetime = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->InverseLifetime);
+    Result->Size = (f32*)Malloc(sizeof(f32) * Capacity); Assert(Result->Size);
+    Result->Color = (u32*)Malloc(sizeof(u32) * Capacity); Assert(Result->Color);
+    Result->Instances = (particle_instance*)Malloc(sizeof(particle_instance) * Capacity); Assert(Result->Instances);
+    Result->Count = 0;
+    Result->Capacity = Capacity;
+    Result->Drag = Drag;
+    Result->RandomState = Seed;
+
+    return (Result);
+}
+
+// Same xorshift as random.cpp, on the state of the particle system
+inline
+f32 PS_RandomBetween(particle_system *System, f32 Min, f32 Max)
+{
+    u32 X = System->RandomState;
+    X ^= X << 13;
+    X ^= X >> 17;
+    X ^= X << 5;
+    System->RandomState = X;
+
+    return Min + (Max - Min) * ((f32)(X >> 8) * (1.0f / 16777216.0f));
+}
+
+// Channels clamped to 0..1, red in the lowest byte
+u32 PS_PackColor(glm::vec3 Color)
+{
+    glm::vec3 Clamped = glm::clamp(Color, glm::vec3(0.0f), glm::vec3(1.0f));
+    u32 R = (u32)(Clamped.r * 255.0f + 0.5f);
+    u32 G = (u32)(Clamped.g * 255.0f + 0.5f);
+    u32 B = (u32)(Clamped.b * 255.0f + 0.5f);
+    return R | (G << 8) | (B << 16);
+}
+
+// Bursts Emitter->Count particles out of Position, the ones that don't
+// fit in the pool are dropped
+void PS_Emit(particle_system *System, particle_emitter *Emitter, glm::vec2 Position)
+{
+    Assert(System);
+    Assert(Emitter);
+
+    u32 Color = PS_PackColor(Emitter->Color);
+    for(u32 i = 0; i < Emitter->Count && System->Count < System->Capacity; i++)
+    {
+        u32 Index = System->Count++;
+        f32 Angle = PS_RandomBetween(System, 0.0f, 2.0f * (f32)Pi32);
+        f32 Speed = PS_RandomBetween(System, Emitter->MinSpeed, Emitter->MaxSpeed);
+        f32 Lifetime = PS_RandomBetween(System, Emitter->MinLife, Emitter->MaxLife);
+
+        System->PositionX[Index] = Position.x;
+        System->PositionY[Index] = Position.y;
+        System->VelocityX[Index] = Cosf(Angle) * Speed;
+        System->VelocityY[Index] = Sinf(Angle) * Speed;
+        System->Life[Index] = Lifetime;
+        System->InverseLifetime[Index] = 1.0f / Lifetime;
+        System->Size[Index] = Emitter->Size;
+        System->Color[Index] = Color;
+    }
+}
+
+void PS_Clear(particle_system *System)
+{
+    Assert(System);
+
+    System->Count = 0;
+}
+
+// Replaces every dead particle with the last live one
+void PS_RemoveDead(particle_system *System)
+{
+    u32 i = 0;
+    while(i < System->Count)
+    {
+        if(System->Life[i] > 0.0f)
+        {
+            i++;
+            continue;
+        }
+
+        u32 Last = --System->Count;
+        System->PositionX[i] = System->PositionX[Last];
+        System->PositionY[i] = System->PositionY[Last];
+        System->VelocityX[i] = System->VelocityX[Last];
+        System->VelocityY[i] = System->VelocityY[Last];
+        System->Life[i] = System->Life[Last];
+        System->InverseLifetime[i] = System->InverseLifetime[Last];
+        System->Size[i] = System->Size[Last];
+        System->Color[i] = System->Color[Last];
+        System->Instances[i] = System->Instances[Last];
+    }
+}
+
+// Moves the particles, ages them and writes their instances. Particles
+// shrink and fade out over their life
+void PS_Update(particle_system *System, f32 TimeStep)
+{
+    Assert(System);
+
+    f32 Damping = expf(-System->Drag * TimeStep);
+    b32 AnyDead = false;
+
+#if PARTICLE_SIMD
+    // Groups of 4, the lanes of the last group past Count are updated
+    // too, the arrays are padded to a multiple of 4 and those lanes are
+    // overwritten by the next emit anyway
+    __m128 Step = _mm_set1_ps(TimeStep);
+    __m128 Damping4 = _mm_set1_ps(Damping);
+    __m128 Zero = _mm_setzero_ps();
+    __m128 AlphaScale = _mm_set1_ps(255.0f);
+    __m128i ColorMask = _mm_set1_epi32(0x00FFFFFF);
+    for(u32 i = 0; i < System->Count; i += 4)
+    {
+        __m128 VelocityX = _mm_mul_ps(_mm_loadu_ps(System->VelocityX + i), Damping4);
+        __m128 VelocityY = _mm_mul_ps(_mm_loadu_ps(System->VelocityY + i), Damping4);
+        __m128 PositionX = _mm_add_ps(_mm_loadu_ps(System->PositionX + i), _mm_mul_ps(VelocityX, Step));
+        __m128 PositionY = _mm_add_ps(_mm_loadu_ps(System->PositionY + i), _mm_mul_ps(VelocityY, Step));
+        __m128 Life = _mm_sub_ps(_mm_loadu_ps(System->Life + i), Step);
+        _mm_storeu_ps(System->VelocityX + i, VelocityX);
+        _mm_storeu_ps(System->VelocityY + i, VelocityY);
+        _mm_storeu_ps(System->PositionX + i, PositionX);
+        _mm_storeu_ps(System->PositionY + i, PositionY);
+        _mm_storeu_ps(System->Life + i, Life);
+
+        i32 Dead = _mm_movemask_ps(_mm_cmple_ps(Life, Zero));
+        u32 Lanes = System->Count - i;
+        if(Lanes < 4)
+        {
+            Dead &= (1 << Lanes) - 1;
+        }
+        AnyDead |= Dead;
+
+        __m128 Fraction = _mm_max_ps(_mm_mul_ps(Life, _mm_loadu_ps(System->InverseLifetime + i)), Zero);
+        __m128 Size = _mm_mul_ps(_mm_loadu_ps(System->Size + i), Fraction);
+        __m128i Alpha = _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(Fraction, AlphaScale)), 24);
+        __m128i Color = _mm_or_si128(_mm_and_si128(_mm_loadu_si128((__m128i*)(System->Color + i)), ColorMask), Alpha);
+
+        // Columns to the rows of 4 particle_instance
+        __m128 Row0 = PositionX;
+        __m128 Row1 = PositionY;
+        __m128 Row2 = Size;
+        __m128 Row3 = _mm_castsi128_ps(Color);
+        _MM_TRANSPOSE4_PS(Row0, Row1, Row2, Row3);
+        f32 *Instances = (f32*)(System->Instances + i);
+        _mm_storeu_ps(Instances, Row0);
+        _mm_storeu_ps(Instances + 4, Row1);
+        _mm_storeu_ps(Instances + 8, Row2);
+        _mm_storeu_ps(Instances + 12, Row3);
+    }
+#else
+    for(u32 i = 0; i < System->Count; i++)
+    {
+        System->VelocityX[i] *= Damping;
+        System->VelocityY[i] *= Damping;
+        System->PositionX[i] += System->VelocityX[i] * TimeStep;
+        System->PositionY[i] += System->VelocityY[i] * TimeStep;
+        System->Life[i] -= TimeStep;
+        AnyDead |= (System->Life[i] <= 0.0f);
+
+        f32 Fraction = glm::max(System->Life[i] * System->InverseLifetime[i], 0.0f);
+        particle_instance *Instance = &System->Instances[i];
+        Instance->X = System->PositionX[i];
+        Instance->Y = System->PositionY[i];
+        Instance->Size = System->Size[i] * Fraction;
+        Instance->Color = (System->Color[i] & 0x00FFFFFF) | ((u32)(Fraction * 255.0f) << 24);
+    }
+#endif
+
+    if(AnyDead)
+    {
+        PS_RemoveDead(System);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "shared.h"
+
+/*
+  Particles for explosions and hits. They are only eye candy, the
+  simulation reports where things blew up through game_events and the
+  particles never feed back into it, so they are updated with the frame
+  time and use their own random numbers, replays still match.
+
+  The pool has a fixed capacity and every attribute in its own array.
+  Live particles are [0, Count), a dead one is replaced by the last, so
+  PS_Update runs over packed arrays 4 particles at a time and nothing is
+  allocated after PS_CreateParticleSystem. PS_Update also writes the
+  instances the renderer uploads for its one instanced draw, see
+  R_DrawParticles.
+*/
+
+#define PARTICLE_CAPACITY (128 * 1024) // Multiple of 4
+
+// Per instance attributes, see particle.glsl
+struct particle_instance
+{
+    f32 X;
+    f32 Y;
+    f32 Size;
+    u32 Color; // RGBA8, alpha is the fraction of life left
+};
+
+// How a burst looks, the direction is random and the speed and life
+// of every particle random in their ranges
+struct particle_emitter
+{
+    u32 Count;
+    f32 MinSpeed;
+    f32 MaxSpeed;
+    f32 MinLife; // Seconds
+    f32 MaxLife;
+    f32 Size;
+    glm::vec3 Color;
+};
+
+struct particle_system
+{
+    f32 *PositionX;
+    f32 *PositionY;
+    f32 *VelocityX;
+    f32 *VelocityY;
+    f32 *Life; // Seconds left
+    f32 *InverseLifetime;
+    f32 *Size;
+    u32 *Color; // RGB8, the alpha byte is written by PS_Update
+    u32 Count;
+    u32 Capacity;
+
+    f32 Drag; // The velocity decays by exp(-Drag * Seconds)
+    u32 RandomState; // xorshift, the game RNG is left alone
+
+    particle_instance *Instances; // Count of them, written by PS_Update
+};
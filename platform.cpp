@@ -3,13 +3,35 @@
 #include "shared.h"
 #include "platform.h"
 
-clock *P_CreateClock()
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+clock *P_CreateClock(f64 TickRate)
 {
+    Assert(TickRate > 0.0);
+
     clock *Result = (clock*)Malloc(sizeof(clock)); Assert(Result);
     Result->DeltaTime = 0.0f;
+    Result->SecondsElapsed = 0.0f;
     Result->PerfCounterNow = SDL_GetPerformanceCounter();
     Result->PerfCounterLast = 0;
 
+    Result->TickRate = TickRate;
+    Result->TickDelta = 1.0 / TickRate;
+    Result->MaxFrameTime = 0.25;
+    Result->Accumulator = 0.0;
+    Result->SimulationTime = 0.0;
+    Result->TickCount = 0;
+
     return Result;
 }
 
@@ -21,6 +43,30 @@ void P_UpdateClock(clock *Clock)
     Clock->DeltaTime = (f64)((Clock->PerfCounterNow - Clock->PerfCounterLast)*1000.0f / (f64)SDL_GetPerformanceFrequency() );
     Clock->DeltaTime /= 1000.0f;
     Clock->SecondsElapsed += Clock->DeltaTime;
+
+    f64 FrameTime = Clock->DeltaTime;
+    if(FrameTime > Clock->MaxFrameTime) { FrameTime = Clock->MaxFrameTime; }
+    Clock->Accumulator += FrameTime;
+}
+
+// Used as while(P_TickPending(Clock)) { Simulate(); P_AdvanceTick(Clock); }
+b32 P_TickPending(clock *Clock)
+{
+    return Clock->Accumulator >= Clock->TickDelta;
+}
+
+void P_AdvanceTick(clock *Clock)
+{
+    Clock->Accumulator -= Clock->TickDelta;
+    Clock->SimulationTime += Clock->TickDelta;
+    Clock->TickCount++;
+}
+
+// How far the real time is between the last tick and the next one,
+// in [0, 1), used to interpolate the rendered transforms
+f32 P_TickAlpha(clock *Clock)
+{
+    return (f32)(Clock->Accumulator / Clock->TickDelta);
 }
 
 void P_ToggleFullscreen(window *Window)
@@ -100,3 +146,96 @@ window *P_CreateOpenGLWindow(char *Title, u32 Width, u32 Height)
 
     return (Result);
 }
+
+// Maps Filename read only, pages are read from disk the first time
+// they are touched. Returns false when the file can not be mapped
+b32 P_MapFile(mapped_file *Result, char *Filename)
+{
+    Assert(Result);
+    Assert(Filename);
+
+    *Result = {};
+#ifdef _WIN32
+    HANDLE File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER Size;
+    HANDLE Mapping = NULL;
+    void *Data = NULL;
+    if(GetFileSizeEx(File, &Size) && Size.QuadPart > 0)
+    {
+        Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(Mapping)
+        {
+            Data = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+    if(!Data)
+    {
+        if(Mapping) { CloseHandle(Mapping); }
+        CloseHandle(File);
+        return false;
+    }
+
+    Result->Data = (u8*)Data;
+    Result->Size = (u64)Size.QuadPart;
+    Result->File = File;
+    Result->Mapping = Mapping;
+#else
+    int File = open(Filename, O_RDONLY);
+    if(File == -1)
+    {
+        return false;
+    }
+
+    struct stat Stat;
+    void *Data = MAP_FAILED;
+    if(fstat(File, &Stat) == 0 && Stat.st_size > 0)
+    {
+        Data = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    }
+    // The mapping keeps the file open
+    close(File);
+    if(Data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    Result->Data = (u8*)Data;
+    Result->Size = (u64)Stat.st_size;
+#endif
+
+    return true;
+}
+
+void P_UnmapFile(mapped_file *File)
+{
+    Assert(File);
+
+    if(File->Data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(File->Data);
+        CloseHandle((HANDLE)File->Mapping);
+        CloseHandle((HANDLE)File->File);
+#else
+        munmap(File->Data, (size_t)File->Size);
+#endif
+    }
+    *File = {};
+}
+
+// Succeeds when the directory already exists
+b32 P_CreateDirectory(char *Path)
+{
+    Assert(Path);
+
+#ifdef _WIN32
+    return CreateDirectoryA(Path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(Path, 0755) == 0 || errno == EEXIST;
+#endif
+}
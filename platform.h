@@ -15,4 +15,22 @@ struct clock
     u64 PerfCounterLast;
     f64 DeltaTime;
     f64 SecondsElapsed;
+
+    // Fixed timestep, the game is simulated in TickDelta steps and
+    // the renderer interpolates between the last two ticks
+    f64 TickRate;
+    f64 TickDelta;
+    f64 MaxFrameTime; // Longer frames are clamped so a hitch does not queue a burst of ticks
+    f64 Accumulator;  // Real time not simulated yet
+    f64 SimulationTime;
+    u64 TickCount;
+};
+
+// A whole file mapped read only, see P_MapFile
+struct mapped_file
+{
+    u8 *Data;
+    u64 Size;
+    void *File;    // Windows only, the file and mapping handles
+    void *Mapping;
 };
@@ -19,6 +19,13 @@ void RandomSeed(u32 Input)
     _State = Input;
 }
 
+// The whole generator state, RandomSeed(RandomGetState()) restores it
+inline
+u32 RandomGetState()
+{
+    return _State;
+}
+
 inline
 u32 RandomU32()
 {
@@ -2,20 +2,16 @@
 
 /*
   1- Render to offscreen framebuffer
-  2- Extract pixels that are higher than 1.0f to secondary color buffer
-  3- Blurr that secondary color buffer
-  4- Merge secondary color buffer into regular buffer
-  5- Display merged colorbuffer to screen
+  2- Extract the bright pixels into a half resolution texture
+  3- Blurr it down a chain of smaller mips and add them back up
+  4- Merge the blurred mip into the offscreen color buffer
+  5- Display merged colorbuffer to screen, then draw the UI over it
 */
 
 // STB Libs
 #define STB_IMAGE_IMPLEMENTATION
 #include "external/stb_image.h"
 
-// Freetype
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 #include "shared.h"
 #include "renderer.h"
 #include "entity.h"
@@ -23,12 +19,15 @@
 // Renderer settings
 global f32 RendererExposure = 2.0f;
 global i32 VSync = 0; // Vsync, 0 disabled, 1 enabled, -1 adaptive vsync
-global b32 EnableBloom = 1; // NOTE: This turns off a boolean in the bloom glsl shader.
-global u32 BlurPassCount = 6; // How many times should we blurr the image
+global b32 EnableBloom = 1; // NOTE: The bloom passes are culled from the frame graph while off
+global u32 BloomMipCount = 6; // Levels of the bloom mip chain, every level blurs twice as wide
 global glm::vec4 BackgroundColor = glm::vec4(0.01f, 0.01f, 0.01f, 1.0f);
 global glm::vec4 MenuBackgroundColor = glm::vec4(0.005f, 0.005f, 0.005f, 1.0f);
 global f32 BrightnessThreshold = 0.1f;
+global f32 ParticleBrightness = 4.0f; // HDR scale of the particle colors, well over the threshold so they bloom
 global f32 CameraSpeed = 7.0f;
+global b32 EnableShaderCache = 1; // Linked programs are saved and loaded on the next run, see R_LoadProgramBinary
+global char *ShaderCacheDirectory = "shadercache";
 
 void R_UpdateCamera(renderer *Renderer, camera *Camera)
 {
@@ -46,24 +45,399 @@ void R_UpdateCamera(renderer *Renderer, camera *Camera)
 
 }
 
+global shader_program ShaderPrograms[SHADER_MAX_PROGRAMS];
+global u32 ShaderProgramCount;
+
+// Reads back the active uniforms and uniform blocks of a linked program
+// into the program table. Uniform blocks named CameraMatrices are bound
+// to the camera UBO binding point here, 3.3 can't set it in the glsl
+void R_ReflectShader(u32 Program, char *Filename)
+{
+    if(Program == 0)
+    {
+        return;
+    }
+    if(ShaderProgramCount == SHADER_MAX_PROGRAMS)
+    {
+        printf("%s: Too many shader programs, uniforms can't be cached\n", Filename);
+        return;
+    }
+
+    shader_program *Shader = &ShaderPrograms[ShaderProgramCount++];
+    Shader->Handle = Program;
+    Shader->Filename = Filename;
+
+    i32 ActiveUniforms = 0;
+    glGetProgramiv(Program, GL_ACTIVE_UNIFORMS, &ActiveUniforms);
+    for(i32 i = 0; i < ActiveUniforms; i++)
+    {
+        char Name[SHADER_MAX_NAME] = {0};
+        i32 Length = 0;
+        i32 Size = 0;
+        GLenum Type = 0;
+        glGetActiveUniform(Program, i, SHADER_MAX_NAME, &Length, &Size, &Type, Name);
+
+        // Members of uniform blocks have no location, they are set
+        // through the block's buffer
+        i32 Location = glGetUniformLocation(Program, Name);
+        if(Location == -1)
+        {
+            continue;
+        }
+        if(Shader->UniformCount == SHADER_MAX_UNIFORMS)
+        {
+            printf("%s: Too many uniforms, %s is not cached\n", Filename, Name);
+            continue;
+        }
+
+        shader_uniform *Uniform = &Shader->Uniforms[Shader->UniformCount++];
+        strncpy(Uniform->Name, Name, SHADER_MAX_NAME - 1);
+        Uniform->Location = Location;
+        Uniform->Type = Type;
+    }
+
+    i32 ActiveBlocks = 0;
+    glGetProgramiv(Program, GL_ACTIVE_UNIFORM_BLOCKS, &ActiveBlocks);
+    for(i32 i = 0; i < ActiveBlocks && Shader->BlockCount < SHADER_MAX_BLOCKS; i++)
+    {
+        shader_block *Block = &Shader->Blocks[Shader->BlockCount++];
+        glGetActiveUniformBlockName(Program, i, SHADER_MAX_NAME, NULL, Block->Name);
+        glGetActiveUniformBlockiv(Program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &Block->DataSize);
+        Block->Index = i;
+
+        if(strcmp(Block->Name, "CameraMatrices") == 0)
+        {
+            glUniformBlockBinding(Program, Block->Index, 0);
+        }
+    }
+}
+
+shader_program *R_GetShaderProgram(u32 Program)
+{
+    for(u32 i = 0; i < ShaderProgramCount; i++)
+    {
+        if(ShaderPrograms[i].Handle == Program)
+        {
+            return &ShaderPrograms[i];
+        }
+    }
+    return NULL;
+}
+
+// Looks up a uniform by name, call it once at startup and keep the handle
+uniform R_GetUniform(u32 Program, char *Name)
+{
+    Assert(Name);
+
+    uniform Result = {};
+    shader_program *Shader = R_GetShaderProgram(Program);
+    if(Shader)
+    {
+        for(u32 i = 0; i < Shader->UniformCount; i++)
+        {
+            if(strcmp(Shader->Uniforms[i].Name, Name) == 0)
+            {
+                Result.Uniform = &Shader->Uniforms[i];
+                break;
+            }
+        }
+    }
+    return Result;
+}
+
+// Remembers the value and returns false when it is the one already
+// uploaded, so the setters skip the glUniform call
+b32 R_UniformChanged(uniform Uniform, void *Value, size_t Size)
+{
+    shader_uniform *Cached = Uniform.Uniform;
+    if(!Cached)
+    {
+        return false;
+    }
+    Assert(Size <= sizeof(Cached->Value));
+    if(Cached->HasValue && memcmp(Cached->Value, Value, Size) == 0)
+    {
+        return false;
+    }
+    memcpy(Cached->Value, Value, Size);
+    Cached->HasValue = true;
+    return true;
+}
+
+// The program owning the uniform has to be the active one
+void R_SetUniform(uniform Uniform, i32 Value)
+{
+    Assert(!Uniform.Uniform || Uniform.Uniform->Type == GL_INT || Uniform.Uniform->Type == GL_BOOL || Uniform.Uniform->Type == GL_SAMPLER_2D);
+    if(R_UniformChanged(Uniform, &Value, sizeof(Value)))
+    {
+        glUniform1i(Uniform.Uniform->Location, Value);
+    }
+}
+
+void R_SetUniform(uniform Uniform, f32 Value)
+{
+    Assert(!Uniform.Uniform || Uniform.Uniform->Type == GL_FLOAT);
+    if(R_UniformChanged(Uniform, &Value, sizeof(Value)))
+    {
+        glUniform1f(Uniform.Uniform->Location, Value);
+    }
+}
+
+void R_SetUniform(uniform Uniform, glm::vec2 Value)
+{
+    Assert(!Uniform.Uniform || Uniform.Uniform->Type == GL_FLOAT_VEC2);
+    if(R_UniformChanged(Uniform, &Value, sizeof(Value)))
+    {
+        glUniform2f(Uniform.Uniform->Location, Value.x, Value.y);
+    }
+}
+
+void R_SetUniform(uniform Uniform, glm::vec3 Value)
+{
+    Assert(!Uniform.Uniform || Uniform.Uniform->Type == GL_FLOAT_VEC3);
+    if(R_UniformChanged(Uniform, &Value, sizeof(Value)))
+    {
+        glUniform3f(Uniform.Uniform->Location, Value.x, Value.y, Value.z);
+    }
+}
+
+void R_SetUniform(uniform Uniform, glm::mat4 *Value)
+{
+    Assert(!Uniform.Uniform || Uniform.Uniform->Type == GL_FLOAT_MAT4);
+    if(R_UniformChanged(Uniform, glm::value_ptr(*Value), sizeof(glm::mat4)))
+    {
+        glUniformMatrix4fv(Uniform.Uniform->Location, 1, GL_FALSE, glm::value_ptr(*Value));
+    }
+}
+
+global gl_state GLState; // A new context has everything bound to 0, like this
+
+void R_SetActiveShader(u32 Shader)
+{
+    if(GLState.Program != Shader)
+    {
+        glUseProgram(Shader);
+        GLState.Program = Shader;
+    }
+}
+
+void R_BindVertexArray(u32 VertexArray)
+{
+    if(GLState.VertexArray != VertexArray)
+    {
+        glBindVertexArray(VertexArray);
+        GLState.VertexArray = VertexArray;
+    }
+}
+
+void R_BindTexture(u32 Unit, u32 Texture)
+{
+    Assert(Unit < GL_STATE_TEXTURE_UNITS);
+    if(GLState.Textures[Unit] != Texture)
+    {
+        if(GLState.ActiveTexture != Unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + Unit);
+            GLState.ActiveTexture = Unit;
+        }
+        glBindTexture(GL_TEXTURE_2D, Texture);
+        GLState.Textures[Unit] = Texture;
+    }
+}
+
+void R_SetBlend(u32 Mode)
+{
+    if(GLState.BlendMode == Mode)
+    {
+        return;
+    }
+
+    if(Mode == BlendMode_None)
+    {
+        glDisable(GL_BLEND);
+    }
+    else
+    {
+        if(GLState.BlendMode == BlendMode_None)
+        {
+            glEnable(GL_BLEND);
+        }
+        if(GLState.BlendFunc != Mode)
+        {
+            if(Mode == BlendMode_Alpha)
+            {
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+            else
+            {
+                glBlendFunc(GL_ONE, GL_ONE);
+            }
+            GLState.BlendFunc = Mode;
+        }
+    }
+    GLState.BlendMode = Mode;
+}
+
+// GL unbinds a deleted texture and may hand its name out again, so it
+// can't stay in the state cache
+void R_DeleteTexture(u32 *Texture)
+{
+    for(u32 i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+    {
+        if(GLState.Textures[i] == *Texture)
+        {
+            GLState.Textures[i] = 0;
+        }
+    }
+    glDeleteTextures(1, Texture);
+    *Texture = 0;
+}
+
 void R_DrawUnitQuad(renderer *Renderer)
 {
-    glBindVertexArray(Renderer->UnitQuadVAO);
+    R_BindVertexArray(Renderer->UnitQuadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4); Renderer->CurrentDrawCallsPerFrame++;
-    glBindVertexArray(0);
 }
 
-u32 R_CreateShader(char *Filename)
+// Put in front of the defines and the source of every stage
+global char *VertexShaderHeader = "#version 330 core\n#define VERTEX_SHADER\n";
+global char *FragmentShaderHeader = "#version 330 core\n#define FRAGMENT_SHADER\n";
+
+// FNV-1a, includes the terminator so "ab" + "c" and "a" + "bc" differ
+u64 R_HashString(u64 Hash, const char *String)
 {
-    Assert(Filename);
+    do
+    {
+        Hash = (Hash ^ (u8)*String) * 0x100000001B3ull;
+    } while(*String++);
+    return Hash;
+}
+
+u64 R_ShaderCacheKey(renderer *Renderer, char *Defines, char *Source)
+{
+    u64 Key = 0xCBF29CE484222325ull;
+    Key = R_HashString(Key, (const char*)Renderer->HardwareVendor);
+    Key = R_HashString(Key, (const char*)Renderer->HardwareModel);
+    Key = R_HashString(Key, (const char*)Renderer->OpenGLVersion);
+    Key = R_HashString(Key, VertexShaderHeader);
+    Key = R_HashString(Key, FragmentShaderHeader);
+    Key = R_HashString(Key, Defines);
+    Key = R_HashString(Key, Source);
+    return Key;
+}
 
+void R_ProgramBinaryPath(u64 Key, char *Path, size_t PathSize)
+{
+    snprintf(Path, PathSize, "%s/%016llx.bin", ShaderCacheDirectory, (unsigned long long)Key);
+}
+
+// Returns 0 when the program is not in the cache or the driver rejects
+// the binary, a driver update can do that even when the version string
+// stays the same
+u32 R_LoadProgramBinary(renderer *Renderer, u64 Key)
+{
+    if(!Renderer->ProgramBinaries)
+    {
+        return 0;
+    }
+
+    char Path[256];
+    R_ProgramBinaryPath(Key, Path, sizeof(Path));
+    FILE *File = fopen(Path, "rb");
+    if(!File)
+    {
+        return 0;
+    }
+
+    // A truncated or corrupt file can claim any size, it has to fit in
+    // what is left after the header
+    fseek(File, 0, SEEK_END);
+    u64 FileSize = (u64)ftell(File);
+    fseek(File, 0, SEEK_SET);
+
+    shader_cache_header Header;
+    u8 *Binary = NULL;
+    b32 Valid = fread(&Header, sizeof(Header), 1, File) == 1 &&
+                Header.Magic == SHADER_CACHE_MAGIC && Header.Key == Key &&
+                Header.Size > 0 && Header.Size <= FileSize - sizeof(Header);
+    if(Valid)
+    {
+        Binary = (u8*)Malloc(Header.Size);
+        Valid = fread(Binary, Header.Size, 1, File) == 1;
+    }
+    fclose(File);
+
+    u32 Result = 0;
+    if(Valid)
+    {
+        Result = glCreateProgram();
+        glProgramBinary(Result, Header.BinaryFormat, Binary, (GLsizei)Header.Size);
+        i32 IsLinked = 0;
+        glGetProgramiv(Result, GL_LINK_STATUS, &IsLinked);
+        if(IsLinked == GL_FALSE)
+        {
+            // An unknown binary format is an error, not just a failed link
+            while(glGetError() != GL_NO_ERROR) {}
+            glDeleteProgram(Result);
+            Result = 0;
+        }
+    }
+    if(Binary)
+    {
+        Free(Binary);
+    }
+
+    return Result;
+}
+
+void R_SaveProgramBinary(renderer *Renderer, u32 Program, u64 Key)
+{
+    if(!Renderer->ProgramBinaries)
+    {
+        return;
+    }
+
+    i32 Length = 0;
+    glGetProgramiv(Program, GL_PROGRAM_BINARY_LENGTH, &Length);
+    if(Length <= 0)
+    {
+        return;
+    }
+
+    shader_cache_header Header = {};
+    Header.Magic = SHADER_CACHE_MAGIC;
+    Header.Key = Key;
+    u8 *Binary = (u8*)Malloc(Length);
+    GLenum BinaryFormat = 0;
+    glGetProgramBinary(Program, Length, &Length, &BinaryFormat, Binary);
+    Header.BinaryFormat = BinaryFormat;
+    Header.Size = (u32)Length;
+
+    char Path[256];
+    R_ProgramBinaryPath(Key, Path, sizeof(Path));
+    FILE *File = fopen(Path, "wb");
+    if(File)
+    {
+        fwrite(&Header, sizeof(Header), 1, File);
+        fwrite(Binary, Length, 1, File);
+        fclose(File);
+    }
+    else
+    {
+        printf("Could not write shader cache file: %s\n", Path);
+    }
+    Free(Binary);
+}
+
+// Compiles both stages of the source and links them, returns 0 on errors
+u32 R_CompileProgram(renderer *Renderer, char *Filename, char *Defines, char *SourceFile)
+{
     u32 Result;
-    char *SourceFile = ReadTextFile(Filename);
 
     // Compile Vertex Shader
     u32 VertexShaderObject = glCreateShader(GL_VERTEX_SHADER);
-    char *VertexSource[2] = {"#version 330 core\n#define VERTEX_SHADER\n", SourceFile};
-    glShaderSource(VertexShaderObject, 2, VertexSource, NULL);
+    char *VertexSource[3] = {VertexShaderHeader, Defines, SourceFile};
+    glShaderSource(VertexShaderObject, 3, VertexSource, NULL);
     glCompileShader(VertexShaderObject);
     i32 Compiled;
     glGetShaderiv(VertexShaderObject, GL_COMPILE_STATUS, &Compiled);
@@ -78,8 +452,8 @@ u32 R_CreateShader(char *Filename)
 
     // Compile Fragment Shader
     u32 FragmentShaderObject = glCreateShader(GL_FRAGMENT_SHADER);
-    char *FragmentSource[2] = {"#version 330 core\n#define FRAGMENT_SHADER\n", SourceFile};
-    glShaderSource(FragmentShaderObject, 2, FragmentSource, NULL);
+    char *FragmentSource[3] = {FragmentShaderHeader, Defines, SourceFile};
+    glShaderSource(FragmentShaderObject, 3, FragmentSource, NULL);
     glCompileShader(FragmentShaderObject);
     // i32 Compiled;
     glGetShaderiv(FragmentShaderObject, GL_COMPILE_STATUS, &Compiled);
@@ -94,6 +468,10 @@ u32 R_CreateShader(char *Filename)
 
     // Link program
     Result = glCreateProgram();
+    if(Renderer->ProgramBinaries)
+    {
+        glProgramParameteri(Result, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(Result, VertexShaderObject);
     glAttachShader(Result, FragmentShaderObject);
     glLinkProgram(Result);
@@ -112,198 +490,1003 @@ u32 R_CreateShader(char *Filename)
 
     glDeleteShader(VertexShaderObject);
     glDeleteShader(FragmentShaderObject);
-    Free(SourceFile);
 
     return Result;
 }
 
-void R_SetUniform(u32 Shader, char *Name, i32 Value)
+// The source comes from the asset archive when the renderer has one,
+// otherwise from the file. Returns NULL when it can't be read
+char *R_ReadShaderSource(renderer *Renderer, char *Filename, b32 *FromArchive)
 {
-    Assert(Name);
-    glUniform1i(glGetUniformLocation(Shader, Name), Value);
-}
+    *FromArchive = false;
+    if(Renderer->Archive)
+    {
+        asset_handle Asset = A_FindAsset(Renderer->Archive, Filename);
+        if(Asset.Entry && Asset.Entry->Type == ArchiveEntry_Shader && Asset.Entry->Size > 0 && Asset.Data[Asset.Entry->Size - 1] == 0)
+        {
+            *FromArchive = true;
+            return (char*)Asset.Data;
+        }
+    }
 
-void R_SetUniform(u32 Shader, char *Name, f32 Value)
-{
-    Assert(Name);
-    glUniform1f(glGetUniformLocation(Shader, Name), Value);
+    char *Result = ReadTextFile(Filename);
+    if(!Result)
+    {
+        printf("Could not read shader file: %s\n", Filename);
+    }
+    return Result;
 }
 
-void R_SetUniform(u32 Shader, char *Name, glm::mat4 *Value)
+// Defines is inserted after the #version line, so one source can be
+// compiled into variants. The linked program is loaded from the shader
+// cache when it was compiled before
+u32 R_CreateProgram(renderer *Renderer, char *Filename, char *Defines, char *Source)
 {
-    Assert(Name);
-    glUniformMatrix4fv(glGetUniformLocation(Shader, Name), 1, GL_FALSE, glm::value_ptr(*Value));
-}
+    u64 Key = R_ShaderCacheKey(Renderer, Defines, Source);
+    u32 Result = R_LoadProgramBinary(Renderer, Key);
+    if(Result)
+    {
+        Renderer->ProgramsLoaded++;
+    }
+    else
+    {
+        Result = R_CompileProgram(Renderer, Filename, Defines, Source);
+        if(Result)
+        {
+            R_SaveProgramBinary(Renderer, Result, Key);
+        }
+        Renderer->ProgramsCompiled++;
+    }
 
-void R_SetUniform(u32 Shader, char *Name, glm::mat4 Value)
-{
-    Assert(Name);
-    glUniformMatrix4fv(glGetUniformLocation(Shader, Name), 1, GL_FALSE, glm::value_ptr(Value));
-}
+    R_ReflectShader(Result, Filename);
 
-void R_SetUniform(u32 Shader, char *Name, f32 X, f32 Y, f32 Z)
-{
-    Assert(Name);
-    glUniform3f(glGetUniformLocation(Shader, Name), X, Y, Z);
+    return Result;
 }
 
-void R_SetUniform(u32 Shader, char *Name, glm::vec3 Value)
+u32 R_CreateShaderVariant(renderer *Renderer, char *Filename, char *Defines)
 {
-    Assert(Name);
-    glUniform3f(glGetUniformLocation(Shader, Name), Value.x, Value.y, Value.z);
+    Assert(Renderer);
+    Assert(Filename);
+    Assert(Defines);
+
+    b32 FromArchive;
+    char *Source = R_ReadShaderSource(Renderer, Filename, &FromArchive);
+    if(!Source)
+    {
+        return 0;
+    }
+
+    u32 Result = R_CreateProgram(Renderer, Filename, Defines, Source);
+
+    if(!FromArchive)
+    {
+        Free(Source);
+    }
+
+    return Result;
 }
 
-void R_BeginFrame(renderer *Renderer)
+u32 R_CreateShader(renderer *Renderer, char *Filename)
 {
-    // NOTE: We need to clear the color buffer black, or else
-    // the extracted brightness texture has another color
-    // besides black, making the whole background glow
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClearColor(Renderer->BackgroundColor.r, Renderer->BackgroundColor.g, Renderer->BackgroundColor.b, Renderer->BackgroundColor.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glBindFramebuffer(GL_FRAMEBUFFER, Renderer->Framebuffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    return R_CreateShaderVariant(Renderer, Filename, "");
 }
 
-void R_EndFrame(renderer *Renderer)
+// Reads the names after the first "#pragma keywords" of the source
+void R_ParseShaderKeywords(shader_permutations *Permutations, char *Source)
 {
-    // Blur bright fragments with two-pass Gaussian Blur
-    // --------------------------------------------------
-    b32 Horizontal = true, FirstIteration = true;
-    glUseProgram(Renderer->Shaders.Blur);
-    for (u32 i = 0; i < BlurPassCount; i++)
+    char *At = strstr(Source, "#pragma keywords");
+    if(!At)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, Renderer->PingPongFBO[Horizontal]);
-        R_SetUniform(Renderer->Shaders.Blur, "Horizontal", Horizontal);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, FirstIteration ? Renderer->BrightnessBuffer : Renderer->PingPongBuffer[!Horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
-        R_DrawUnitQuad(Renderer);
-        Horizontal = !Horizontal;
-        if (FirstIteration)
-        {
-            FirstIteration = false;
-        }
+        return;
     }
-    // Render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
-    // --------------------------------------------------------------------------------------------------------------------------
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(Renderer->Shaders.Bloom);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, Renderer->ColorBuffer);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, Renderer->PingPongBuffer[!Horizontal]);
-    R_SetUniform(Renderer->Shaders.Bloom, "Bloom", EnableBloom);
-    R_SetUniform(Renderer->Shaders.Bloom, "Exposure", Renderer->Exposure);
-    R_DrawUnitQuad(Renderer);
+    At += strlen("#pragma keywords");
 
-    SDL_GL_SwapWindow(Renderer->Window->Handle);
+    while(*At && *At != '\n' && *At != '\r')
+    {
+        if(*At == ' ' || *At == '\t')
+        {
+            At++;
+            continue;
+        }
 
-    Renderer->PreviousDrawCallsPerFrame = Renderer->CurrentDrawCallsPerFrame;
-    Renderer->CurrentDrawCallsPerFrame = 0;
+        char *Start = At;
+        while(*At && *At != ' ' && *At != '\t' && *At != '\n' && *At != '\r')
+        {
+            At++;
+        }
+        size_t Length = At - Start;
+        if(Permutations->KeywordCount == SHADER_MAX_KEYWORDS || Length >= SHADER_KEYWORD_LENGTH)
+        {
+            printf("%s: Too many keywords or keyword too long\n", Permutations->Filename);
+            return;
+        }
+        char *Keyword = Permutations->Keywords[Permutations->KeywordCount++];
+        memcpy(Keyword, Start, Length);
+        Keyword[Length] = 0;
+    }
 }
 
-void R_ResizeRenderer(renderer *Renderer, i32 Width, i32 Height)
+// Compiles the combinations of keywords in Keys, the source is read once
+// for all of them
+void R_CreateShaderPermutations(renderer *Renderer, shader_permutations *Permutations, char *Filename, u32 *Keys, u32 KeyCount)
 {
-    /*
-      This function deletes and recreates the opengl textures that we
-      are using/rendering to. Framebuffers do not need to be resized,
-      only the textures. The following textures are deleted and
-      recreated to reflect the new width and height.
-
-      u32 ColorBuffer;
-      u32 BrightnessBuffer;
-      u32 DepthStencilRenderbuffer;
-      u32 PingPongBuffer[2];
-    */
-
     Assert(Renderer);
-    Assert(Width > 0);
-    Assert(Height > 0);
-
-    // Delete old texture and depth+stencil renderbuffer
-    glDeleteTextures(1, &Renderer->ColorBuffer);
-    glDeleteTextures(1, &Renderer->BrightnessBuffer);
-    glDeleteRenderbuffers(1, &Renderer->DepthStencilRenderbuffer);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, Renderer->Framebuffer);
-    // Colorbuffer
-    glGenTextures(1, &Renderer->ColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, Renderer->ColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Width, Height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // BrightnessBuffer
-    glGenTextures(1, &Renderer->BrightnessBuffer);
-    glBindTexture(GL_TEXTURE_2D, Renderer->BrightnessBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Width, Height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // Renderbuffer
-    glGenRenderbuffers(1, &Renderer->DepthStencilRenderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, Renderer->DepthStencilRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
-    // Attach Buffers to Framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Renderer->ColorBuffer, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, Renderer->BrightnessBuffer, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, Renderer->DepthStencilRenderbuffer);
-    // Tell opengl we are rendering to multiple buffers
-    u32 Attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, Attachments);
+    Assert(Permutations);
+    Assert(Filename);
 
-    // Check if framebuffer is complete
-    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    *Permutations = {};
+    Permutations->Filename = Filename;
+
+    b32 FromArchive;
+    char *Source = R_ReadShaderSource(Renderer, Filename, &FromArchive);
+    if(!Source)
     {
-        printf("Framebuffer not complete, exiting!\n");
-        exit(-1);
+        return;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    R_ParseShaderKeywords(Permutations, Source);
 
-    { // SUBSECTION: PingPongFramebuffers
-        glDeleteTextures(1, &Renderer->PingPongBuffer[0]);
-        glDeleteTextures(1, &Renderer->PingPongBuffer[1]);
-
-        glGenTextures(2, Renderer->PingPongBuffer);
-        for (u32 i = 0; i < 2; i++)
+    for(u32 i = 0; i < KeyCount; i++)
+    {
+        u32 Key = Keys[i];
+        if(Key >= (1u << Permutations->KeywordCount))
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, Renderer->PingPongFBO[i]);
-            glBindTexture(GL_TEXTURE_2D, Renderer->PingPongBuffer[i]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, Width, Height, 0, GL_RGB, GL_FLOAT, NULL);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Renderer->PingPongBuffer[i], 0);
-            if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            printf("%s: Key %u uses a keyword the shader does not declare\n", Filename, Key);
+            continue;
+        }
+
+        char Defines[SHADER_MAX_KEYWORDS * (SHADER_KEYWORD_LENGTH + 9)] = {0};
+        for(u32 Keyword = 0; Keyword < Permutations->KeywordCount; Keyword++)
+        {
+            if(Key & (1u << Keyword))
+            {
+                strcat(Defines, "#define ");
+                strcat(Defines, Permutations->Keywords[Keyword]);
+                strcat(Defines, "\n");
+            }
+        }
+        Permutations->Programs[Key] = R_CreateProgram(Renderer, Filename, Defines, Source);
+    }
+
+    if(!FromArchive)
+    {
+        Free(Source);
+    }
+}
+
+// Program of a combination of keywords, 0 when it was not compiled
+u32 R_ShaderPermutation(shader_permutations *Permutations, u32 Key)
+{
+    Assert(Key < SHADER_MAX_PERMUTATIONS);
+    return Permutations->Programs[Key];
+}
+
+// Name based setters for setup code, draw code keeps a uniform handle
+void R_SetUniform(u32 Shader, char *Name, i32 Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), Value);
+}
+
+void R_SetUniform(u32 Shader, char *Name, f32 Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), Value);
+}
+
+void R_SetUniform(u32 Shader, char *Name, glm::mat4 *Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), Value);
+}
+
+void R_SetUniform(u32 Shader, char *Name, glm::mat4 Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), &Value);
+}
+
+void R_SetUniform(u32 Shader, char *Name, glm::vec2 Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), Value);
+}
+
+void R_SetUniform(u32 Shader, char *Name, f32 X, f32 Y, f32 Z)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), glm::vec3(X, Y, Z));
+}
+
+void R_SetUniform(u32 Shader, char *Name, glm::vec3 Value)
+{
+    R_SetUniform(R_GetUniform(Shader, Name), Value);
+}
+
+// Sort key, from the most to the least significant bits: 8 bits of
+// layer, 8 of shader, 24 of texture and 24 of depth. The key only
+// groups draws, the state cache decides what really gets bound, so GL
+// names that don't fit only cost merged draws
+u64 R_SortKey(u32 Layer, u32 Shader, u32 Texture, f32 Depth)
+{
+    // Floats sort like unsigned integers once the negative ones have
+    // every bit flipped and the positive ones their sign bit set
+    u32 DepthBits;
+    memcpy(&DepthBits, &Depth, sizeof(DepthBits));
+    DepthBits = (DepthBits & 0x80000000) ? ~DepthBits : (DepthBits | 0x80000000);
+
+    return ((u64)(Layer & 0xFF) << 56) |
+           ((u64)(Shader & 0xFF) << 48) |
+           ((u64)(Texture & 0xFFFFFF) << 24) |
+           (u64)(DepthBits >> 8);
+}
+
+// Grows a command buffer array to hold at least Needed elements
+void *R_Grow(void *Array, u32 *Capacity, u32 Needed, size_t ElementSize, u32 InitialCapacity)
+{
+    if(Needed > *Capacity)
+    {
+        u32 NewCapacity = *Capacity ? *Capacity : InitialCapacity;
+        while(NewCapacity < Needed)
+        {
+            NewCapacity *= 2;
+        }
+        Array = Realloc(Array, NewCapacity * ElementSize); Assert(Array);
+        *Capacity = NewCapacity;
+    }
+    return Array;
+}
+
+void R_PushCommand(renderer *Renderer, u64 Key, u32 Type, u32 Index)
+{
+    command_buffer *Buffer = &Renderer->Commands;
+    if(Buffer->Count == Buffer->Capacity)
+    {
+        u32 Capacity = Buffer->Capacity;
+        Buffer->Commands = (render_command*)R_Grow(Buffer->Commands, &Capacity, Buffer->Count + 1, sizeof(render_command), COMMAND_BUFFER_INITIAL_CAPACITY);
+        Buffer->SortBuffer = (render_command*)R_Grow(Buffer->SortBuffer, &Buffer->Capacity, Buffer->Count + 1, sizeof(render_command), COMMAND_BUFFER_INITIAL_CAPACITY);
+    }
+    Buffer->Commands[Buffer->Count++] = {Key, Type, Index};
+}
+
+// Makes the text shader of the font active
+void R_UseTextShader(renderer *Renderer, font *Font, glm::vec2 Offset)
+{
+    if(Font->DistanceField)
+    {
+        R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Text, Text_DistanceField));
+        R_SetUniform(Renderer->Uniforms.TextDistanceFieldOffset, Offset);
+    }
+    else
+    {
+        R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Text, 0));
+        R_SetUniform(Renderer->Uniforms.TextOffset, Offset);
+    }
+}
+
+// Stable radix sort on the keys, one pass per byte. A pass is skipped
+// when every key has the same byte, usually most of them are
+void R_SortCommands(command_buffer *Buffer)
+{
+    render_command *Source = Buffer->Commands;
+    render_command *Dest = Buffer->SortBuffer;
+    for(u32 Shift = 0; Shift < 64; Shift += 8)
+    {
+        u32 Offsets[256] = {};
+        for(u32 i = 0; i < Buffer->Count; i++)
+        {
+            Offsets[(Source[i].Key >> Shift) & 0xFF]++;
+        }
+        if(Offsets[(Source[0].Key >> Shift) & 0xFF] == Buffer->Count)
+        {
+            continue;
+        }
+
+        u32 Total = 0;
+        for(u32 i = 0; i < 256; i++)
+        {
+            u32 Count = Offsets[i];
+            Offsets[i] = Total;
+            Total += Count;
+        }
+        for(u32 i = 0; i < Buffer->Count; i++)
+        {
+            Dest[Offsets[(Source[i].Key >> Shift) & 0xFF]++] = Source[i];
+        }
+
+        render_command *Temp = Source;
+        Source = Dest;
+        Dest = Temp;
+    }
+    Buffer->Commands = Source;
+    Buffer->SortBuffer = Dest;
+}
+
+// Sorts and draws the commands recorded since the last submit, up to
+// LastLayer, into the bound framebuffer. Runs of sprites sharing a
+// texture and of strings sharing a font become one draw call each.
+// Called by the passes of R_EndFrame
+void R_SubmitCommands(renderer *Renderer, u32 LastLayer = Layer_UI)
+{
+    Assert(Renderer);
+
+    command_buffer *Buffer = &Renderer->Commands;
+    if(Buffer->Count == 0)
+    {
+        return;
+    }
+
+    R_SortCommands(Buffer);
+
+    // The layer is the top byte of the key, so the layers left for a
+    // later submit are the end of the sorted commands
+    u32 End = 0;
+    while(End < Buffer->Count && (Buffer->Commands[End].Key >> 56) <= LastLayer)
+    {
+        End++;
+    }
+
+    // Gather the instances and vertices in submission order, so every
+    // run is one range of the GPU buffers
+    u32 SpriteCount = 0;
+    u32 VertexCount = 0;
+    for(u32 i = 0; i < End; i++)
+    {
+        render_command *Command = &Buffer->Commands[i];
+        if(Command->Type == RenderCommand_Sprite)
+        {
+            Buffer->SpriteUpload[SpriteCount++] = Buffer->Sprites[Command->Index].Instance;
+        }
+        else if(Command->Type == RenderCommand_Text)
+        {
+            text_command *Text = &Buffer->Texts[Command->Index];
+            memcpy(Buffer->TextUpload + VertexCount, Buffer->TextVertices + Text->First, Text->Count * sizeof(text_vertex));
+            VertexCount += Text->Count;
+        }
+    }
+
+    // Orphan the buffers so we don't wait on the draws of the last submit
+    if(SpriteCount > 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer->SpriteInstanceBuffer);
+        while(Buffer->SpriteBufferCapacity < SpriteCount)
+        {
+            Buffer->SpriteBufferCapacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, Buffer->SpriteBufferCapacity * sizeof(sprite_instance), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, SpriteCount * sizeof(sprite_instance), Buffer->SpriteUpload);
+    }
+    if(VertexCount > 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, Renderer->TextVertexBuffer);
+        while(Buffer->TextBufferCapacity < VertexCount)
+        {
+            Buffer->TextBufferCapacity *= 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, Buffer->TextBufferCapacity * sizeof(text_vertex), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, VertexCount * sizeof(text_vertex), Buffer->TextUpload);
+    }
+
+    R_SetBlend(BlendMode_Alpha);
+
+    u32 SpriteOffset = 0;
+    u32 VertexOffset = 0;
+    u32 i = 0;
+    while(i < End)
+    {
+        render_command *Command = &Buffer->Commands[i];
+        u32 RunEnd = i + 1;
+        switch(Command->Type)
+        {
+            case RenderCommand_Sprite:
+            {
+                u32 Texture = Buffer->Sprites[Command->Index].Texture;
+                while(RunEnd < End && Buffer->Commands[RunEnd].Type == RenderCommand_Sprite &&
+                      Buffer->Sprites[Buffer->Commands[RunEnd].Index].Texture == Texture)
+                {
+                    RunEnd++;
+                }
+                u32 InstanceCount = RunEnd - i;
+
+                R_SetActiveShader(Renderer->Shaders.Sprite);
+                R_BindVertexArray(Buffer->SpriteVAO);
+                R_BindTexture(0, Texture);
+
+                // GL 3.3 has no base instance, so instead of an offset in
+                // the draw call every run points the instance attributes
+                // at its own range
+                size_t Base = SpriteOffset * sizeof(sprite_instance);
+                glBindBuffer(GL_ARRAY_BUFFER, Buffer->SpriteInstanceBuffer);
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(sprite_instance), (void*)(Base + offsetof(sprite_instance, Position)));
+                glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(sprite_instance), (void*)(Base + offsetof(sprite_instance, Size)));
+                glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(sprite_instance), (void*)(Base + offsetof(sprite_instance, Rotation)));
+                glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(sprite_instance), (void*)(Base + offsetof(sprite_instance, UVRect)));
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, InstanceCount); Renderer->CurrentDrawCallsPerFrame++;
+
+                SpriteOffset += InstanceCount;
+                break;
+            }
+            case RenderCommand_Text:
+            {
+                font *Font = Buffer->Texts[Command->Index].Font;
+                u32 RunVertices = Buffer->Texts[Command->Index].Count;
+                while(RunEnd < End && Buffer->Commands[RunEnd].Type == RenderCommand_Text &&
+                      Buffer->Texts[Buffer->Commands[RunEnd].Index].Font == Font)
+                {
+                    RunVertices += Buffer->Texts[Buffer->Commands[RunEnd].Index].Count;
+                    RunEnd++;
+                }
+
+                R_UseTextShader(Renderer, Font, glm::vec2(0.0f));
+                R_BindVertexArray(Renderer->TextVAO);
+                R_BindTexture(0, Font->Atlas);
+                glDrawArrays(GL_TRIANGLES, VertexOffset, RunVertices); Renderer->CurrentDrawCallsPerFrame++;
+
+                VertexOffset += RunVertices;
+                break;
+            }
+            case RenderCommand_TextMesh:
+            {
+                // The meshes are laid out at the origin and moved in the shader
+                text_mesh_draw *Draw = &Buffer->MeshDraws[Command->Index];
+                text_mesh *Mesh = &Renderer->TextCache.Meshes[Draw->Mesh];
+
+                R_UseTextShader(Renderer, Mesh->Font, Draw->Position);
+                R_BindVertexArray(Renderer->TextCache.VAO);
+                R_BindTexture(0, Mesh->Font->Atlas);
+                glDrawArrays(GL_TRIANGLES, Draw->Mesh * TEXT_CACHE_MAX_VERTICES, Mesh->VertexCount); Renderer->CurrentDrawCallsPerFrame++;
+                break;
+            }
+            case RenderCommand_Particles:
+            {
+                particle_system *System = Buffer->ParticleDraws[Command->Index];
+
+                // Orphaned like the sprite buffer, the instances are
+                // only read by this draw
+                glBindBuffer(GL_ARRAY_BUFFER, Buffer->ParticleInstanceBuffer);
+                if(Buffer->ParticleBufferCapacity < System->Count)
+                {
+                    Buffer->ParticleBufferCapacity = System->Capacity;
+                }
+                glBufferData(GL_ARRAY_BUFFER, Buffer->ParticleBufferCapacity * sizeof(particle_instance), NULL, GL_STREAM_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, System->Count * sizeof(particle_instance), System->Instances);
+
+                R_SetActiveShader(Renderer->Shaders.Particle);
+                R_SetUniform(Renderer->Uniforms.ParticleBrightness, ParticleBrightness);
+                R_BindVertexArray(Buffer->ParticleVAO);
+
+                // Added over everything drawn before, without the depth
+                // test the transparent corners of the sprites under
+                // them don't cut them
+                R_SetBlend(BlendMode_Additive);
+                glDisable(GL_DEPTH_TEST);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, System->Count); Renderer->CurrentDrawCallsPerFrame++;
+                glEnable(GL_DEPTH_TEST);
+                R_SetBlend(BlendMode_Alpha);
+                break;
+            }
+            default:
             {
-                printf("PingPong Framebuffer %d is not complete, exiting!\n", i);
+                InvalidCodePath;
+                break;
             }
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        i = RunEnd;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if(End < Buffer->Count)
+    {
+        // The data of the commands left is kept until they are drawn
+        Buffer->Count -= End;
+        memmove(Buffer->Commands, Buffer->Commands + End, Buffer->Count * sizeof(render_command));
+        return;
+    }
+
+    Buffer->Count = 0;
+    Buffer->SpriteCount = 0;
+    Buffer->TextCount = 0;
+    Buffer->TextVertexCount = 0;
+    Buffer->MeshDrawCount = 0;
+    Buffer->ParticleDrawCount = 0;
+}
+
+// Render graph
+// ------------
+
+// Declares a texture passes can read and write, it only gets a GL
+// texture if a pass that survives culling writes it
+u32 R_AddGraphTexture(render_graph *Graph, i32 Width, i32 Height, GLenum InternalFormat, b32 DepthStencil = false)
+{
+    Assert(Graph->TextureCount < RENDER_GRAPH_MAX_TEXTURES);
+
+    u32 Result = Graph->TextureCount++;
+    graph_texture *Texture = &Graph->Textures[Result];
+    *Texture = {};
+    Texture->Width = Width;
+    Texture->Height = Height;
+    Texture->InternalFormat = InternalFormat;
+    Texture->DepthStencil = DepthStencil;
+    return (Result);
+}
+
+// Passes run in the order they are added
+u32 R_AddPass(render_graph *Graph, char *Name, render_pass_function *Execute, u32 Output, u32 BlendMode, b32 Enabled = true)
+{
+    Assert(Graph->PassCount < RENDER_GRAPH_MAX_PASSES);
+    Assert(Output < Graph->TextureCount);
+
+    u32 Result = Graph->PassCount++;
+    render_pass *Pass = &Graph->Passes[Result];
+    *Pass = {};
+    Pass->Name = Name;
+    Pass->Execute = Execute;
+    Pass->Output = Output;
+    Pass->BlendMode = BlendMode;
+    Pass->Enabled = Enabled;
+    return (Result);
+}
+
+void R_PassReads(render_graph *Graph, u32 PassIndex, u32 Texture)
+{
+    render_pass *Pass = &Graph->Passes[PassIndex];
+    Assert(Pass->InputCount < RENDER_PASS_MAX_INPUTS);
+    Assert(Texture < Graph->TextureCount);
+    Pass->Inputs[Pass->InputCount++] = Texture;
+}
+
+// Clears the passes and textures of the last frame, the backbuffer is
+// always graph texture 0
+void R_ResetGraph(render_graph *Graph, i32 Width, i32 Height)
+{
+    Graph->PassCount = 0;
+    Graph->TextureCount = 0;
+    R_AddGraphTexture(Graph, Width, Height, GL_RGBA8);
+}
+
+void R_CreateTransientTexture(transient_texture *Transient, graph_texture *Texture)
+{
+    Transient->Width = Texture->Width;
+    Transient->Height = Texture->Height;
+    Transient->InternalFormat = Texture->InternalFormat;
+    Transient->DepthStencil = Texture->DepthStencil;
+
+    // R11F_G11F_B10F has no alpha to upload from
+    GLenum Format = (Texture->InternalFormat == GL_R11F_G11F_B10F) ? GL_RGB : GL_RGBA;
+    glGenTextures(1, &Transient->Handle);
+    R_BindTexture(0, Transient->Handle);
+    glTexImage2D(GL_TEXTURE_2D, 0, Texture->InternalFormat, Texture->Width, Texture->Height, 0, Format, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &Transient->Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, Transient->Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Transient->Handle, 0);
+    if(Texture->DepthStencil)
+    {
+        glGenRenderbuffers(1, &Transient->DepthStencilRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, Transient->DepthStencilRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Texture->Width, Texture->Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, Transient->DepthStencilRenderbuffer);
     }
 
-    glViewport(0, 0, Width, Height);
+    // Check if framebuffer is complete
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        printf("Framebuffer not complete, exiting!\n");
+        exit(-1);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-renderer *R_CreateRenderer(window *Window)
+void R_DeleteTransientTexture(transient_texture *Transient)
+{
+    R_DeleteTexture(&Transient->Handle);
+    glDeleteFramebuffers(1, &Transient->Framebuffer);
+    if(Transient->DepthStencilRenderbuffer)
+    {
+        glDeleteRenderbuffers(1, &Transient->DepthStencilRenderbuffer);
+    }
+    *Transient = {};
+}
+
+// Culls the passes, then hands every texture still written a pool
+// texture of the same size and format. A pool texture is shared by
+// graph textures whose passes do not overlap, and kept for the next
+// frames, so a steady frame creates no GL objects
+void R_CompileGraph(render_graph *Graph)
+{
+    Graph->Frame++;
+
+    // Walking back from the last pass, a pass is needed when it draws
+    // to the window or a later needed pass reads its output
+    u32 Readers[RENDER_GRAPH_MAX_TEXTURES] = {};
+    for(u32 i = Graph->PassCount; i > 0; i--)
+    {
+        render_pass *Pass = &Graph->Passes[i - 1];
+        Pass->Culled = !Pass->Enabled || (Pass->Output != GRAPH_BACKBUFFER && Readers[Pass->Output] == 0);
+        if(!Pass->Culled)
+        {
+            for(u32 Input = 0; Input < Pass->InputCount; Input++)
+            {
+                Readers[Pass->Inputs[Input]]++;
+            }
+        }
+    }
+
+    for(u32 i = 0; i < Graph->TextureCount; i++)
+    {
+        Graph->Textures[i].Written = false;
+        Graph->Textures[i].Transient = GRAPH_NONE;
+    }
+    for(u32 i = 0; i < Graph->PassCount; i++)
+    {
+        render_pass *Pass = &Graph->Passes[i];
+        if(Pass->Culled)
+        {
+            continue;
+        }
+
+        Graph->Textures[Pass->Output].Written = true;
+        Graph->Textures[Pass->Output].LastPass = i;
+        for(u32 Input = 0; Input < Pass->InputCount; Input++)
+        {
+            graph_texture *Texture = &Graph->Textures[Pass->Inputs[Input]];
+            if(Texture->Written)
+            {
+                Texture->LastPass = i;
+            }
+        }
+    }
+
+    for(u32 i = 0; i < Graph->PassCount; i++)
+    {
+        render_pass *Pass = &Graph->Passes[i];
+        graph_texture *Texture = &Graph->Textures[Pass->Output];
+        if(Pass->Culled || Pass->Output == GRAPH_BACKBUFFER || Texture->Transient != GRAPH_NONE)
+        {
+            continue;
+        }
+
+        u32 Empty = GRAPH_NONE;
+        u32 Idle = GRAPH_NONE; // Not used this frame, given up when the pool is full
+        for(u32 Slot = 0; Slot < TRANSIENT_POOL_SIZE; Slot++)
+        {
+            transient_texture *Transient = &Graph->Pool[Slot];
+            if(!Transient->Handle)
+            {
+                Empty = (Empty == GRAPH_NONE) ? Slot : Empty;
+                continue;
+            }
+
+            b32 Free = Transient->LastFrame != Graph->Frame || Transient->BusyUntil < i;
+            if(Free &&
+               Transient->Width == Texture->Width &&
+               Transient->Height == Texture->Height &&
+               Transient->InternalFormat == Texture->InternalFormat &&
+               Transient->DepthStencil == Texture->DepthStencil)
+            {
+                Texture->Transient = Slot;
+                break;
+            }
+            if(Transient->LastFrame != Graph->Frame)
+            {
+                Idle = Slot;
+            }
+        }
+
+        if(Texture->Transient == GRAPH_NONE)
+        {
+            if(Empty == GRAPH_NONE && Idle != GRAPH_NONE)
+            {
+                R_DeleteTransientTexture(&Graph->Pool[Idle]);
+                Empty = Idle;
+            }
+            if(Empty == GRAPH_NONE)
+            {
+                printf("Transient texture pool is full, pass %s culled\n", Pass->Name);
+                Pass->Culled = true;
+                continue;
+            }
+            R_CreateTransientTexture(&Graph->Pool[Empty], Texture);
+            Texture->Transient = Empty;
+        }
+
+        Graph->Pool[Texture->Transient].LastFrame = Graph->Frame;
+        Graph->Pool[Texture->Transient].BusyUntil = Texture->LastPass;
+    }
+
+    // Textures of an old window size, or of passes that have been
+    // disabled for a while
+    for(u32 Slot = 0; Slot < TRANSIENT_POOL_SIZE; Slot++)
+    {
+        transient_texture *Transient = &Graph->Pool[Slot];
+        if(Transient->Handle && Graph->Frame - Transient->LastFrame > TRANSIENT_MAX_IDLE_FRAMES)
+        {
+            R_DeleteTransientTexture(Transient);
+        }
+    }
+}
+
+// GL texture of a graph texture, 0 when it was not written this frame
+u32 R_GraphTexture(render_graph *Graph, u32 Texture)
+{
+    u32 Result = 0;
+    if(Graph->Textures[Texture].Transient != GRAPH_NONE)
+    {
+        Result = Graph->Pool[Graph->Textures[Texture].Transient].Handle;
+    }
+    return (Result);
+}
+
+void R_BindGraphTarget(renderer *Renderer, u32 Texture)
+{
+    render_graph *Graph = &Renderer->Graph;
+    u32 Framebuffer = 0;
+    if(Texture != GRAPH_BACKBUFFER)
+    {
+        Assert(Graph->Textures[Texture].Transient != GRAPH_NONE);
+        Framebuffer = Graph->Pool[Graph->Textures[Texture].Transient].Framebuffer;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glViewport(0, 0, Graph->Textures[Texture].Width, Graph->Textures[Texture].Height);
+}
+
+// GPU timers
+// ----------
+
+// Reads back the queries of a frame issued GPU_TIMER_FRAMES frames ago.
+// If the GPU is somehow still behind the frame is dropped, waiting for
+// it would stall the CPU
+void R_ReadGPUTimers(gpu_timers *Timers, gpu_timer_frame *Frame)
+{
+    Frame->Pending = false;
+    if(Frame->Count == 0)
+    {
+        return;
+    }
+
+    // Queries finish in order, the last one being done means all are
+    u32 Available = 0;
+    glGetQueryObjectuiv(Frame->Queries[Frame->Count - 1], GL_QUERY_RESULT_AVAILABLE, &Available);
+    if(!Available)
+    {
+        return;
+    }
+
+    Timers->Count = Frame->Count;
+    Timers->TotalMilliseconds = 0.0f;
+    Timers->FramesRead++;
+    for(u32 i = 0; i < Frame->Count; i++)
+    {
+        u64 Nanoseconds = 0;
+        glGetQueryObjectui64v(Frame->Queries[i], GL_QUERY_RESULT, &Nanoseconds);
+        Timers->Names[i] = Frame->Names[i];
+        Timers->Milliseconds[i] = (f32)((f64)Nanoseconds / 1000000.0);
+        Timers->TotalMilliseconds += Timers->Milliseconds[i];
+
+        if(Timers->Log)
+        {
+            fprintf(Timers->Log, "%u,%u,%s,%.4f\n", Timers->FramesRead, i, Frame->Names[i], Timers->Milliseconds[i]);
+        }
+    }
+}
+
+// Starts writing every frame's pass times to a CSV file
+b32 R_OpenGPUTimerLog(renderer *Renderer, char *Filename)
+{
+    gpu_timers *Timers = &Renderer->GPUTimers;
+    Timers->Log = fopen(Filename, "w");
+    if(!Timers->Log)
+    {
+        printf("Could not open GPU timer log %s\n", Filename);
+        return false;
+    }
+
+    fprintf(Timers->Log, "frame,pass,name,ms\n");
+    return true;
+}
+
+void R_CloseGPUTimerLog(renderer *Renderer)
+{
+    gpu_timers *Timers = &Renderer->GPUTimers;
+    if(Timers->Log)
+    {
+        fclose(Timers->Log);
+        Timers->Log = NULL;
+    }
+}
+
+void R_ExecuteGraph(renderer *Renderer)
+{
+    render_graph *Graph = &Renderer->Graph;
+    gpu_timers *Timers = &Renderer->GPUTimers;
+    gpu_timer_frame *Frame = &Timers->Frames[Timers->Current];
+    if(Frame->Pending)
+    {
+        R_ReadGPUTimers(Timers, Frame);
+    }
+    Frame->Count = 0;
+
+    for(u32 i = 0; i < Graph->PassCount; i++)
+    {
+        render_pass *Pass = &Graph->Passes[i];
+        if(Pass->Culled)
+        {
+            continue;
+        }
+
+        glBeginQuery(GL_TIME_ELAPSED, Frame->Queries[Frame->Count]);
+        R_BindGraphTarget(Renderer, Pass->Output);
+        R_SetBlend(Pass->BlendMode);
+        for(u32 Input = 0; Input < Pass->InputCount; Input++)
+        {
+            R_BindTexture(Input, R_GraphTexture(Graph, Pass->Inputs[Input]));
+        }
+        Pass->Execute(Renderer, Pass);
+        glEndQuery(GL_TIME_ELAPSED);
+        Frame->Names[Frame->Count++] = Pass->Name;
+    }
+
+    Frame->Pending = true;
+    Timers->Current = (Timers->Current + 1) % GPU_TIMER_FRAMES;
+}
+
+// Frame passes
+// ------------
+
+void R_ScenePass(renderer *Renderer, render_pass *Pass)
+{
+    // Everything under the UI goes into the HDR scene
+    R_SubmitCommands(Renderer, Layer_Overlay);
+}
+
+// Bloom, the bright pixels of the scene at half resolution are blurred
+// down the mip chain and back up, every level adding a blur twice as
+// wide
+void R_BloomThresholdPass(renderer *Renderer, render_pass *Pass)
+{
+    R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Kawase, Kawase_Threshold));
+    R_SetUniform(Renderer->Uniforms.BloomThresholdBrightnessThreshold, BrightnessThreshold);
+    R_DrawUnitQuad(Renderer);
+}
+
+void R_BloomDownsamplePass(renderer *Renderer, render_pass *Pass)
+{
+    graph_texture *Output = &Renderer->Graph.Textures[Pass->Output];
+    R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Kawase, Kawase_Downsample));
+    R_SetUniform(Renderer->Uniforms.BloomDownsampleHalfPixel, glm::vec2(0.5f / Output->Width, 0.5f / Output->Height));
+    R_DrawUnitQuad(Renderer);
+}
+
+void R_BloomUpsamplePass(renderer *Renderer, render_pass *Pass)
+{
+    graph_texture *Output = &Renderer->Graph.Textures[Pass->Output];
+    R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Kawase, Kawase_Upsample));
+    R_SetUniform(Renderer->Uniforms.BloomUpsampleHalfPixel, glm::vec2(0.5f / Output->Width, 0.5f / Output->Height));
+    R_DrawUnitQuad(Renderer);
+}
+
+// Render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+void R_CompositePass(renderer *Renderer, render_pass *Pass)
+{
+    b32 Bloom = Pass->InputCount > 1 && Renderer->Graph.Textures[Pass->Inputs[1]].Written;
+    if(Bloom)
+    {
+        R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Bloom, Bloom_Bloom));
+        // Level 0 ends up with the sum of every level
+        R_SetUniform(Renderer->Uniforms.BloomStrength, 1.0f / Renderer->BloomMipCount);
+        R_SetUniform(Renderer->Uniforms.BloomExposure, Renderer->Exposure);
+    }
+    else
+    {
+        R_SetActiveShader(R_ShaderPermutation(&Renderer->Shaders.Bloom, 0));
+        R_SetUniform(Renderer->Uniforms.TonemapExposure, Renderer->Exposure);
+    }
+    R_DrawUnitQuad(Renderer);
+}
+
+// The UI is drawn over the tonemapped image and doesn't bloom
+void R_UIPass(renderer *Renderer, render_pass *Pass)
+{
+    glClear(GL_DEPTH_BUFFER_BIT);
+    R_SubmitCommands(Renderer);
+}
+
+// Declares this frame's passes, sized to the window. With EnableBloom
+// off the bloom passes are culled and the frame is the scene, the
+// tonemap and the UI
+void R_BuildFrameGraph(renderer *Renderer)
+{
+    render_graph *Graph = &Renderer->Graph;
+    i32 Width = Renderer->Window->Width;
+    i32 Height = Renderer->Window->Height;
+    R_ResetGraph(Graph, Width, Height);
+
+    Renderer->SceneColor = R_AddGraphTexture(Graph, Width, Height, GL_RGBA16F, true);
+    Renderer->ScenePass = R_AddPass(Graph, "Scene", R_ScenePass, Renderer->SceneColor, BlendMode_Alpha);
+
+    // Level 0 is half the window size and every level is half the one
+    // before, R11F_G11F_B10F is enough for blurred light and half the
+    // size of RGBA16F
+    u32 Mips[BLOOM_MAX_MIPS];
+    i32 MipWidth = Width / 2;
+    i32 MipHeight = Height / 2;
+    Renderer->BloomMipCount = 0;
+    while(Renderer->BloomMipCount < BloomMipCount && Renderer->BloomMipCount < BLOOM_MAX_MIPS && MipWidth >= 2 && MipHeight >= 2)
+    {
+        Mips[Renderer->BloomMipCount++] = R_AddGraphTexture(Graph, MipWidth, MipHeight, GL_R11F_G11F_B10F);
+        MipWidth /= 2;
+        MipHeight /= 2;
+    }
+
+    if(Renderer->BloomMipCount > 0)
+    {
+        u32 Pass = R_AddPass(Graph, "Bloom threshold", R_BloomThresholdPass, Mips[0], BlendMode_None, EnableBloom);
+        R_PassReads(Graph, Pass, Renderer->SceneColor);
+        for(u32 i = 1; i < Renderer->BloomMipCount; i++)
+        {
+            Pass = R_AddPass(Graph, "Bloom downsample", R_BloomDownsamplePass, Mips[i], BlendMode_None, EnableBloom);
+            R_PassReads(Graph, Pass, Mips[i - 1]);
+        }
+        for(u32 i = Renderer->BloomMipCount - 1; i > 0; i--)
+        {
+            Pass = R_AddPass(Graph, "Bloom upsample", R_BloomUpsamplePass, Mips[i - 1], BlendMode_Additive, EnableBloom);
+            R_PassReads(Graph, Pass, Mips[i]);
+        }
+    }
+
+    u32 Composite = R_AddPass(Graph, "Composite", R_CompositePass, GRAPH_BACKBUFFER, BlendMode_None);
+    R_PassReads(Graph, Composite, Renderer->SceneColor);
+    if(Renderer->BloomMipCount > 0)
+    {
+        R_PassReads(Graph, Composite, Mips[0]);
+    }
+
+    R_AddPass(Graph, "UI", R_UIPass, GRAPH_BACKBUFFER, BlendMode_Alpha);
+
+    R_CompileGraph(Graph);
+}
+
+void R_BeginFrame(renderer *Renderer)
+{
+    R_BuildFrameGraph(Renderer);
+
+    // The scene target is bound for the whole frame, draws submitted
+    // before R_EndFrame land in it
+    // NOTE: The background color is dim enough to stay under the
+    // bloom threshold, or else the whole background would glow
+    R_BindGraphTarget(Renderer, Renderer->SceneColor);
+    glClearColor(Renderer->BackgroundColor.r, Renderer->BackgroundColor.g, Renderer->BackgroundColor.b, Renderer->BackgroundColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void R_EndFrame(renderer *Renderer)
+{
+    R_ExecuteGraph(Renderer);
+
+    // The glyph cells and text meshes drawn this frame can be replaced
+    Renderer->Commands.FrameCount++;
+
+    SDL_GL_SwapWindow(Renderer->Window->Handle);
+
+    Renderer->PreviousDrawCallsPerFrame = Renderer->CurrentDrawCallsPerFrame;
+    Renderer->CurrentDrawCallsPerFrame = 0;
+}
+
+renderer *R_CreateRenderer(window *Window, archive *Archive = NULL)
 {
     renderer *Result = (renderer*)Malloc(sizeof(renderer));
     Result->Window = Window;
+    Result->Archive = Archive;
     Result->CurrentDrawCallsPerFrame = 0;
     Result->PreviousDrawCallsPerFrame = 0;
     Result->BackgroundColor = BackgroundColor;
 
+    // Loose textures get their mips built on the CPU, see R_CreateTexture
+    // and A_RunJob
+    R_InitMipmaps();
+
     { // SECTION: OpenGL "Configuration"
         glFrontFace(GL_CCW);
         glEnable(GL_MULTISAMPLE);
         glEnable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_BLEND);
+        R_SetBlend(BlendMode_Alpha);
 
         // Vsync, 0 disabled, 1 enabled, -1 adaptive vsync
         SDL_GL_SetSwapInterval(VSync);
@@ -313,55 +1496,90 @@ renderer *R_CreateRenderer(window *Window)
         Result->OpenGLVersion = glGetString(GL_VERSION);
         Result->GLSLVersion = glGetString(GL_SHADING_LANGUAGE_VERSION);
 
+        // Needs GL 4.1 or ARB_get_program_binary, and drivers may
+        // support it without any binary format
+        i32 BinaryFormatCount = 0;
+        if(EnableShaderCache && GLAD_GL_ARB_get_program_binary)
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &BinaryFormatCount);
+        }
+        Result->ProgramBinaries = (BinaryFormatCount > 0) && P_CreateDirectory(ShaderCacheDirectory);
+
         Result->Exposure = RendererExposure;
     }
     glViewport(0, 0, Window->Width, Window->Height);
 
     { // SUBSECTION: Shader compilation
-        Result->Shaders.Blur = R_CreateShader("shaders/blur.glsl");
-        glUseProgram(Result->Shaders.Blur);
-        R_SetUniform(Result->Shaders.Blur, "Image", 0);
+        // Bloom mip chain passes, the threshold pass reads the scene
+        // and the others the mip above or below
+        u32 KawaseKeys[] = {Kawase_Threshold, Kawase_Downsample, Kawase_Upsample};
+        R_CreateShaderPermutations(Result, &Result->Shaders.Kawase, "shaders/kawase.glsl", KawaseKeys, ArrayCount(KawaseKeys));
+        for(u32 i = 0; i < ArrayCount(KawaseKeys); i++)
+        {
+            u32 Shader = R_ShaderPermutation(&Result->Shaders.Kawase, KawaseKeys[i]);
+            R_SetActiveShader(Shader);
+            R_SetUniform(Shader, "Image", 0);
+        }
+
+        // Without bloom the composite only tonemaps
+        u32 BloomKeys[] = {0, Bloom_Bloom};
+        R_CreateShaderPermutations(Result, &Result->Shaders.Bloom, "shaders/bloom.glsl", BloomKeys, ArrayCount(BloomKeys));
+        for(u32 i = 0; i < ArrayCount(BloomKeys); i++)
+        {
+            u32 Shader = R_ShaderPermutation(&Result->Shaders.Bloom, BloomKeys[i]);
+            R_SetActiveShader(Shader);
+            R_SetUniform(Shader, "Scene", 0);
+            R_SetUniform(Shader, "BloomBlur", 1);
+        }
 
-        Result->Shaders.Bloom = R_CreateShader("shaders/bloom.glsl");
-        glUseProgram(Result->Shaders.Bloom);
-        R_SetUniform(Result->Shaders.Bloom, "Scene", 0);
-        R_SetUniform(Result->Shaders.Bloom, "BloomBlur", 1);
+        u32 TextKeys[] = {0, Text_DistanceField};
+        R_CreateShaderPermutations(Result, &Result->Shaders.Text, "shaders/text.glsl", TextKeys, ArrayCount(TextKeys));
+        for(u32 i = 0; i < ArrayCount(TextKeys); i++)
+        {
+            u32 Shader = R_ShaderPermutation(&Result->Shaders.Text, TextKeys[i]);
+            R_SetActiveShader(Shader);
+            R_SetUniform(Shader, "Text", 0);
+        }
 
-        Result->Shaders.Hdr = R_CreateShader("shaders/hdr.glsl");
-        glUseProgram(Result->Shaders.Hdr);
-        R_SetUniform(Result->Shaders.Hdr, "HDRBuffer", 0);
+        Result->Shaders.Sprite = R_CreateShader(Result, "shaders/sprite.glsl");
+        R_SetActiveShader(Result->Shaders.Sprite);
+        R_SetUniform(Result->Shaders.Sprite, "Image", 0);
 
-        Result->Shaders.Texture = R_CreateShader("shaders/texture.glsl");
-        glUseProgram(Result->Shaders.Texture);
-        R_SetUniform(Result->Shaders.Texture, "Image", 0);
+        Result->Shaders.Particle = R_CreateShader(Result, "shaders/particle.glsl");
 
-        Result->Shaders.Ball = R_CreateShader("shaders/ball.glsl");
-        glUseProgram(Result->Shaders.Texture);
-        R_SetUniform(Result->Shaders.Texture, "Image", 0);
+        if(Result->ProgramBinaries)
+        {
+            printf("%u programs loaded from the shader cache, %u compiled\n", Result->ProgramsLoaded, Result->ProgramsCompiled);
+        }
+    }
 
-        Result->Shaders.Text = R_CreateShader("shaders/text.glsl");
-        glUseProgram(Result->Shaders.Text);
-        R_SetUniform(Result->Shaders.Text, "Text", 0);
+    { // SUBSECTION: Uniform handles used by the draw code
+        shader_permutations *Kawase = &Result->Shaders.Kawase;
+        shader_permutations *Bloom = &Result->Shaders.Bloom;
+        shader_permutations *Text = &Result->Shaders.Text;
+        Result->Uniforms.BloomThresholdBrightnessThreshold = R_GetUniform(R_ShaderPermutation(Kawase, Kawase_Threshold), "BrightnessThreshold");
+        Result->Uniforms.BloomDownsampleHalfPixel = R_GetUniform(R_ShaderPermutation(Kawase, Kawase_Downsample), "HalfPixel");
+        Result->Uniforms.BloomUpsampleHalfPixel = R_GetUniform(R_ShaderPermutation(Kawase, Kawase_Upsample), "HalfPixel");
+        Result->Uniforms.BloomStrength = R_GetUniform(R_ShaderPermutation(Bloom, Bloom_Bloom), "BloomStrength");
+        Result->Uniforms.BloomExposure = R_GetUniform(R_ShaderPermutation(Bloom, Bloom_Bloom), "Exposure");
+        Result->Uniforms.TonemapExposure = R_GetUniform(R_ShaderPermutation(Bloom, 0), "Exposure");
+        Result->Uniforms.TextOffset = R_GetUniform(R_ShaderPermutation(Text, 0), "Offset");
+        Result->Uniforms.TextDistanceFieldOffset = R_GetUniform(R_ShaderPermutation(Text, Text_DistanceField), "Offset");
+        Result->Uniforms.ParticleBrightness = R_GetUniform(Result->Shaders.Particle, "Brightness");
     }
 
     { // SUBSECTION: Upload vertex data to GPU
-        // Upload Quad Data to the GPU
-        glGenVertexArrays(1, &Result->QuadVAO);
+        // Upload Quad Data to the GPU, the sprite VAO reads it
         glGenBuffers(1, &Result->QuadVBO);
-        glBindVertexArray(Result->QuadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, Result->QuadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(QuadVertices__), &QuadVertices__, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
 
         // Unit Quad, it's needed to render the final image, if
         // regular quad is used, then half the renderable screen/space
         // is used
         glGenVertexArrays(1, &Result->UnitQuadVAO);
         glGenBuffers(1, &Result->UnitQuadVBO);
-        glBindVertexArray(Result->UnitQuadVAO);
+        R_BindVertexArray(Result->UnitQuadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, Result->UnitQuadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(UnitQuadVertices__), &UnitQuadVertices__, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -369,38 +1587,94 @@ renderer *R_CreateRenderer(window *Window)
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
 
-        // Upload Text Data to GPU
+        // Text vertex buffer, interleaved text_vertex filled every
+        // submit by R_SubmitCommands
         glGenVertexArrays(1, &Result->TextVAO);
-        glBindVertexArray(Result->TextVAO);
+        R_BindVertexArray(Result->TextVAO);
         glGenBuffers(1, &Result->TextVertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, Result->TextVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(f32) * 6 * 3, NULL, GL_DYNAMIC_DRAW); // 6 Vertices, 3 floats each
+        Result->Commands.TextBufferCapacity = TEXT_BUFFER_INITIAL_CAPACITY;
+        glBufferData(GL_ARRAY_BUFFER, Result->Commands.TextBufferCapacity * sizeof(text_vertex), NULL, GL_STREAM_DRAW);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(f32), 0);
-        glGenBuffers(1, &Result->TextTexCoordsBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, Result->TextTexCoordsBuffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(f32) * 6 * 2, TextTexCoords__, GL_STATIC_DRAW); // 6 Vertices, 2 floats(UV) each
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, Position));
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(f32), 0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, UV));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, Color));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-    }
+        R_BindVertexArray(0);
+
+        // Retained text meshes, same layout, written only when a mesh
+        // is built
+        glGenVertexArrays(1, &Result->TextCache.VAO);
+        R_BindVertexArray(Result->TextCache.VAO);
+        glGenBuffers(1, &Result->TextCache.VertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Result->TextCache.VertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, TEXT_CACHE_SIZE * TEXT_CACHE_MAX_VERTICES * sizeof(text_vertex), NULL, GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, UV));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(text_vertex), (void*)offsetof(text_vertex, Color));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        R_BindVertexArray(0);
 
-    { // SECTION: Uniform Buffer Object for the Camera Matrices
+        // Sprites, the quad vertices come from QuadVBO and the
+        // sprite_instance attributes advance once per instance
+        command_buffer *Buffer = &Result->Commands;
+        glGenVertexArrays(1, &Buffer->SpriteVAO);
+        R_BindVertexArray(Buffer->SpriteVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, Result->QuadVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
+        glGenBuffers(1, &Buffer->SpriteInstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer->SpriteInstanceBuffer);
+        Buffer->SpriteBufferCapacity = SPRITE_BUFFER_INITIAL_CAPACITY;
+        glBufferData(GL_ARRAY_BUFFER, Buffer->SpriteBufferCapacity * sizeof(sprite_instance), NULL, GL_STREAM_DRAW);
+        for(u32 Location = 2; Location <= 5; Location++)
+        {
+            glEnableVertexAttribArray(Location);
+            glVertexAttribDivisor(Location, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        R_BindVertexArray(0);
+
+        // Particles, the same quad with particle_instance attributes.
+        // Every draw uploads from the start of the buffer, so they are
+        // set once here
+        glGenVertexArrays(1, &Buffer->ParticleVAO);
+        R_BindVertexArray(Buffer->ParticleVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, Result->QuadVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
+        glGenBuffers(1, &Buffer->ParticleInstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer->ParticleInstanceBuffer);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(particle_instance), (void*)offsetof(particle_instance, X));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(particle_instance), (void*)offsetof(particle_instance, Color));
+        glVertexAttribDivisor(3, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        R_BindVertexArray(0);
+    }
 
-        u32 UniformBlockIndexTextureShader;
-        u32 UniformBlockIndexTextShader;
+    { // SECTION: GPU timer queries
+        for(u32 i = 0; i < GPU_TIMER_FRAMES; i++)
+        {
+            glGenQueries(RENDER_GRAPH_MAX_PASSES, Result->GPUTimers.Frames[i].Queries);
+        }
+    }
 
-        // glGetUniformBlockIndex gets the index of the uniform
-        // buffer. With newer version of opengl you can set the index
-        // in the glsl uniform declaration. Since we are using 3.3
-        // sadly we cannot use this feature.
-        UniformBlockIndexTextureShader = glGetUniformBlockIndex(Result->Shaders.Texture, "CameraMatrices");
-        UniformBlockIndexTextShader = glGetUniformBlockIndex(Result->Shaders.Text, "CameraMatrices");
-        // Sets a uniform block to a specific binding point
-        glUniformBlockBinding(Result->Shaders.Texture, UniformBlockIndexTextureShader, 0);
-        glUniformBlockBinding(Result->Shaders.Text, UniformBlockIndexTextShader, 0);
+    { // SECTION: Uniform Buffer Object for the Camera Matrices
 
+        // The CameraMatrices block of every shader was bound to
+        // binding point 0 by R_ReflectShader
         glGenBuffers(1,&Result->UniformCameraBuffer);
         glBindBuffer(GL_UNIFORM_BUFFER, Result->UniformCameraBuffer);
         glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 3, NULL, GL_STATIC_DRAW);
@@ -409,77 +1683,11 @@ renderer *R_CreateRenderer(window *Window)
         glBindBufferBase(GL_UNIFORM_BUFFER, 0, Result->UniformCameraBuffer);
     }
 
-    { // SECTION: HDR+Bloom setup
-        // Main Framebuffer
-        glGenFramebuffers(1, &Result->Framebuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, Result->Framebuffer);
-
-        // Colorbuffer texture attachment
-        glGenTextures(1, &Result->ColorBuffer);
-        glBindTexture(GL_TEXTURE_2D, Result->ColorBuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Window->Width, Window->Height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        // BrightnessBuffer, Texture attachment needed to store every
-        // HDR color > 1.0f. This buffer is needed for Bloom
-        glGenTextures(1, &Result->BrightnessBuffer);
-        glBindTexture(GL_TEXTURE_2D, Result->BrightnessBuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Window->Width, Window->Height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-        glGenRenderbuffers(1, &Result->DepthStencilRenderbuffer);
-        glBindRenderbuffer(GL_RENDERBUFFER, Result->DepthStencilRenderbuffer);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Window->Width, Window->Height);
-
-        // Attach Buffers to Framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Result->ColorBuffer, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, Result->BrightnessBuffer, 0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, Result->DepthStencilRenderbuffer);
-        // Tell opengl we are rendering to multiple buffers
-        u32 Attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-        glDrawBuffers(2, Attachments);
-
-        // Check if framebuffer is complete
-        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        {
-            printf("Framebuffer not complete, exiting!\n");
-            exit(-1);
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        { // SUBSECTION: PingPong Framebuffers creation
-
-            glGenFramebuffers(2, Result->PingPongFBO);
-            glGenTextures(2, Result->PingPongBuffer);
-            for (u32 i = 0; i < 2; i++)
-            {
-                glBindFramebuffer(GL_FRAMEBUFFER, Result->PingPongFBO[i]);
-                glBindTexture(GL_TEXTURE_2D, Result->PingPongBuffer[i]);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, Window->Width, Window->Height, 0, GL_RGB, GL_FLOAT, NULL);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Result->PingPongBuffer[i], 0);
-                if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-                {
-                    printf("PingPong Framebuffer %d is not complete, exiting!\n", i);
-                }
-            }
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-    }
-
     return (Result);
 }
 
-font *R_CreateFont(renderer *Renderer, char *Filename, i32 Width, i32 Height)
+// Data is the font file already in memory, or NULL to read Filename
+font *R_CreateFontFromMemory(renderer *Renderer, char *Filename, u8 *Data, u64 DataSize, i32 Width, i32 Height, b32 DistanceField)
 {
     // TODO(Jorge): Program freezes when Filename is incorrect, handle error graciously
     Assert(Renderer);
@@ -491,67 +1699,54 @@ font *R_CreateFont(renderer *Renderer, char *Filename, i32 Width, i32 Height)
     Result->Filename = Filename;
     Result->Width = Width;
     Result->Height = Height;
+    Result->DistanceField = DistanceField;
+    Result->GlyphSize = DistanceField ? FontDistanceFieldSize : Height;
+    Result->GlyphScale = (f32)Height / (f32)Result->GlyphSize;
 
-    FT_Library FT;
-    FT_Face Face;
-    if(FT_Init_FreeType(&FT) == 0)
+    if(FT_Init_FreeType(&Result->Library) == 0)
     {
-        if(FT_New_Face(FT, Result->Filename, 0, &Face) == 0)
+        FT_Error Error = Data ? FT_New_Memory_Face(Result->Library, Data, (FT_Long)DataSize, 0, &Result->Face) : FT_New_Face(Result->Library, Result->Filename, 0, &Result->Face);
+        if(Error == 0)
         {
-            // Once we've loaded the face, we should define the font size we'd like to extract from this face
-            FT_Set_Pixel_Sizes(Face, Result->Width, Result->Height);
-
-            // Disable byte-alignment restriction
-            glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // NOTE: Do we need to set it back to default?
-
-            for(u8 CurrentChar = 0; CurrentChar < 255; CurrentChar++)
+            // Once we've loaded the face, we should define the font size we'd like to extract from this face.
+            // Nothing is rasterized here, see R_GetGlyph
+            FT_Face Face = Result->Face;
+            R_SetGlyphPixelSize(Face, DistanceField, Result->Width, Result->Height);
+            R_GlyphCellSize(Face, DistanceField, &Result->CellWidth, &Result->CellHeight);
+            Result->AtlasWidth = Result->CellWidth * GLYPH_CACHE_COLUMNS;
+            Result->AtlasHeight = Result->CellHeight * GLYPH_CACHE_ROWS;
+            Result->CellPixels = (u8*)Malloc(Result->CellWidth * Result->CellHeight);
+
+            for(u32 i = 0; i < GLYPH_HASH_SIZE; i++)
             {
-                // Load character glyph
-                if(FT_Load_Char(Face, CurrentChar, FT_LOAD_RENDER) == 0)
-                {
-                    // Generate Texture
-                    u32 Texture;
-                    glGenTextures(1, &Texture);
-                    glBindTexture(GL_TEXTURE_2D, Texture);
-                    glTexImage2D(GL_TEXTURE_2D,
-                                 0,
-                                 GL_RED,
-                                 Face->glyph->bitmap.width,
-                                 Face->glyph->bitmap.rows,
-                                 0,
-                                 GL_RED,
-                                 GL_UNSIGNED_BYTE,
-                                 Face->glyph->bitmap.buffer);
-
-                    // Set Texture Options
-                    // NOTE: What's better? clamp to edge or clamp to border?
-                    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                    // Now store character for later use
-                    character Character =
-                    {
-                        Texture,
-                        glm::ivec2(Face->glyph->bitmap.width, Face->glyph->bitmap.rows),
-                        glm::ivec2(Face->glyph->bitmap_left, Face->glyph->bitmap_top),
-                        (u32)Face->glyph->advance.x,
-                    };
-
-                    Result->Characters[CurrentChar] = Character;
-                }
-                else
-                {
-                    printf("FT_Load_Char: Error, Freetype Failed to load Glyph %c\n", CurrentChar);
-                }
+                Result->HashTable[i] = GLYPH_NONE;
+            }
+            // Free cells are taken from the tail of the LRU list, start
+            // it at cell 0 so the atlas fills from the top
+            for(u32 i = 0; i < GLYPH_CACHE_SIZE; i++)
+            {
+                Result->Glyphs[i].NextInHash = GLYPH_NONE;
+                Result->Glyphs[i].LruPrev = (i == GLYPH_CACHE_SIZE - 1) ? GLYPH_NONE : (u16)(i + 1);
+                Result->Glyphs[i].LruNext = (i == 0) ? GLYPH_NONE : (u16)(i - 1);
             }
+            Result->LruHead = GLYPH_CACHE_SIZE - 1;
+            Result->LruTail = 0;
+
+            // Every cell upload covers the whole cell, so the atlas
+            // does not need clearing
+            glGenTextures(1, &Result->Atlas);
+            R_BindTexture(0, Result->Atlas);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, Result->AtlasWidth, Result->AtlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            R_BindTexture(0, 0);
         }
         else
         {
             printf("FT_New_Face failed miserably while loading font %s\n", Result->Filename);
+            FT_Done_FreeType(Result->Library);
             Free(Result);
             return NULL;
         }
@@ -562,13 +1757,28 @@ font *R_CreateFont(renderer *Renderer, char *Filename, i32 Width, i32 Height)
         Free(Result);
         return NULL;
     }
-    // Destroy a given FreeType library object and all of its children, including resources, drivers, faces, sizes, etc.
-    FT_Done_FreeType(FT);
-    // glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // NOTE: Do we need to reset it?
 
     return Result;
 }
 
+font *R_CreateFont(renderer *Renderer, char *Filename, i32 Width, i32 Height, b32 DistanceField = false)
+{
+    return R_CreateFontFromMemory(Renderer, Filename, NULL, 0, Width, Height, DistanceField);
+}
+
+// The face reads the archive mapping, it has to stay mapped while the
+// font is used
+font *R_CreateFont(renderer *Renderer, asset_handle Asset, i32 Width, i32 Height, b32 DistanceField = false)
+{
+    if(!Asset.Entry || Asset.Entry->Type != ArchiveEntry_Font)
+    {
+        printf("Could not load archive font\n");
+        return NULL;
+    }
+
+    return R_CreateFontFromMemory(Renderer, Asset.Entry->Name, Asset.Data, Asset.Entry->Size, Width, Height, DistanceField);
+}
+
 u32 R_CompileShaderObject(const char *Source, GLenum ShaderType)
 {
     Assert(Source);
@@ -654,6 +1864,7 @@ u32 R_CreateShader(char *VertexFile, char *FragmentFile)
             // Use the infoLog as you see fit.
             printf("SHADER PROGRAM FAILED TO COMPILE\\LINK\n");
             printf("%s\n", InfoLog);
+            Result = 0;
         }
 
     }
@@ -664,12 +1875,65 @@ u32 R_CreateShader(char *VertexFile, char *FragmentFile)
     Free(VertexSource);
     Free(FragmentSource);
 
+    R_ReflectShader(Result, VertexFile);
+
     return (Result);
 }
 
-void R_SetActiveShader(u32 Shader)
+// Picks the GL formats for the ChannelCount of Texture
+b32 R_SetTextureFormat(texture *Texture, char *Filename)
+{
+    if(Texture->ChannelCount == 3)
+    {
+        Texture->Format = GL_RGB;
+        Texture->InternalFormat = GL_SRGB;
+    }
+    else if(Texture->ChannelCount == 4)
+    {
+        Texture->Format = GL_RGBA;
+        // NOTE: If anything looks weird when drawing textures,
+        // maybe toggle between GL_SRGB and GL_SRGB_ALPHA. I'm to
+        // lazy to check opengl docs right now.
+        // Texture->InternalFormat = GL_SRGB;
+        Texture->InternalFormat = GL_SRGB_ALPHA;
+    }
+    else
+    {
+        fprintf(stderr, "%s Texture format is not GL_RGB or GL_RGBA\n", Filename);
+        return false;
+    }
+
+    return true;
+}
+
+// Creates the GL texture from a whole mip chain, see R_BuildMipChain.
+// Pixels is an offset into the bound GL_PIXEL_UNPACK_BUFFER when there
+// is one, see asset.cpp. Nothing waits on the GPU, the mips are not
+// generated by the driver
+void R_UploadTexture(texture *Texture, u8 *Pixels, i32 MipCount)
 {
-    glUseProgram(Shader);
+    glGenTextures(1, &Texture->Handle);
+    R_BindTexture(0, Texture->Handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // NOTE(Jorge): Set custom MipMaps filtering values here!
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MipCount - 1);
+
+    // Rows are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    i32 Width = Texture->Width;
+    i32 Height = Texture->Height;
+    for(i32 Level = 0; Level < MipCount; Level++)
+    {
+        // REMINDER: Textures to be used for data should not be uploaded as GL_SRGB!
+        // NOTE: InternalFormat is the format we want to store the data, Format is the input format
+        glTexImage2D(GL_TEXTURE_2D, Level, Texture->InternalFormat, Width, Height, 0, Texture->Format, GL_UNSIGNED_BYTE, Pixels);
+        Pixels += (u64)Width * Height * Texture->ChannelCount;
+        Width = (Width > 1) ? Width / 2 : 1;
+        Height = (Height > 1) ? Height / 2 : 1;
+    }
 }
 
 texture *R_CreateTexture(char *Filename)
@@ -684,43 +1948,21 @@ texture *R_CreateTexture(char *Filename)
     u8 *Data = stbi_load(Filename, &Result->Width, &Result->Height, &Result->ChannelCount, RequestedChannelCount);
     if(Data)
     {
-        glGenTextures(1, &Result->Handle);
-        glBindTexture(GL_TEXTURE_2D, Result->Handle);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        if(Result->ChannelCount == 3)
-        {
-            Result->Format = GL_RGB;
-            Result->InternalFormat = GL_SRGB;
-        }
-        else if(Result->ChannelCount == 4)
-        {
-            Result->Format = GL_RGBA;
-            // NOTE: If anything looks weird when drawing textures,
-            // maybe toggle between GL_SRGB and GL_SRGB_ALPHA. I'm to
-            // lazy to check opengl docs right now.
-            // Result->InternalFormat = GL_SRGB;
-            Result->InternalFormat = GL_SRGB_ALPHA;
-        }
-        else
+        if(!R_SetTextureFormat(Result, Filename))
         {
-            fprintf(stderr, "%s Texture format is not GL_RGB or GL_RGBA\n", Filename);
             stbi_image_free(Data);
-            return 0;
+            return Result;
         }
 
-        i32 MipMapDetailLevel = 0;
-        // REMINDER: Textures to be used for data should not be uploaded as GL_SRGB!
-        // NOTE: InternalFormat is the format we want to store the data, Format is the input format
-        glTexImage2D(GL_TEXTURE_2D, MipMapDetailLevel, Result->InternalFormat, Result->Width, Result->Height, 0, Result->Format, GL_UNSIGNED_BYTE, Data);
-        // NOTE(Jorge): Set custom MipMaps filtering values here!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
+        i32 MipCount;
+        u64 Size = R_MipChainSize(Result->Width, Result->Height, Result->ChannelCount, &MipCount);
+        u8 *Pixels = (u8*)Malloc(Size);
+        memcpy(Pixels, Data, (u64)Result->Width * Result->Height * Result->ChannelCount);
         stbi_image_free(Data);
+
+        R_BuildMipChain(Pixels, Result->Width, Result->Height, Result->ChannelCount, MipCount);
+        R_UploadTexture(Result, Pixels, MipCount);
+        Free(Pixels);
     }
     else
     {
@@ -730,79 +1972,494 @@ texture *R_CreateTexture(char *Filename)
     return Result;
 }
 
-void R_DrawTexture(renderer *Renderer, texture *Texture, glm::vec3 Position, glm::vec3 Size, glm::vec3 RotationAxis, f32 RotationAngle)
+// Archive textures are stored decoded with every mip level, see
+// archive.h, and are uploaded straight from the mapping. Like the
+// file overload the texture has no GL texture when it can't be used
+texture *R_CreateTexture(asset_handle Asset)
+{
+    texture *Result = (texture*)Malloc(sizeof(texture));
+
+    archive_entry *Entry = Asset.Entry;
+    if(!Entry || Entry->Type != ArchiveEntry_Texture)
+    {
+        printf("Could not load archive texture\n");
+        return Result;
+    }
+
+    Result->Width = Entry->Width;
+    Result->Height = Entry->Height;
+    Result->ChannelCount = Entry->ChannelCount;
+    if(!R_SetTextureFormat(Result, Entry->Name))
+    {
+        return Result;
+    }
+
+    R_UploadTexture(Result, Asset.Data, Entry->MipCount);
+
+    return Result;
+}
+
+// Records a textured quad, drawn by the next R_SubmitCommands together
+// with every other sprite of the same texture
+void R_PushSprite(renderer *Renderer, u32 Layer, texture *Texture, glm::vec3 Position, glm::vec2 Size, glm::vec2 Rotation, glm::vec4 UVRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f))
+{
+    Assert(Renderer);
+    Assert(Texture);
+
+    command_buffer *Buffer = &Renderer->Commands;
+    if(Buffer->SpriteCount == Buffer->SpriteCapacity)
+    {
+        u32 Capacity = Buffer->SpriteCapacity;
+        Buffer->Sprites = (sprite_command*)R_Grow(Buffer->Sprites, &Capacity, Buffer->SpriteCount + 1, sizeof(sprite_command), SPRITE_BUFFER_INITIAL_CAPACITY);
+        Buffer->SpriteUpload = (sprite_instance*)R_Grow(Buffer->SpriteUpload, &Buffer->SpriteCapacity, Buffer->SpriteCount + 1, sizeof(sprite_instance), SPRITE_BUFFER_INITIAL_CAPACITY);
+    }
+
+    u32 Index = Buffer->SpriteCount++;
+    sprite_command *Sprite = &Buffer->Sprites[Index];
+    Sprite->Instance.Position = Position;
+    Sprite->Instance.Size = Size;
+    Sprite->Instance.Rotation = Rotation;
+    Sprite->Instance.UVRect = UVRect;
+    Sprite->Texture = Texture->Handle;
+
+    R_PushCommand(Renderer, R_SortKey(Layer, Renderer->Shaders.Sprite, Texture->Handle, Position.z), RenderCommand_Sprite, Index);
+}
+
+void R_DrawTexture(renderer *Renderer, texture *Texture, glm::vec3 Position, glm::vec3 Size, glm::vec2 Rotation, u32 Layer = Layer_World)
+{
+    R_PushSprite(Renderer, Layer, Texture, Position, glm::vec2(Size), Rotation);
+}
+
+// Every live particle of the system in one instanced draw, with the
+// instances PS_Update wrote. They are added over the world in the HDR
+// scene, so they bloom
+void R_DrawParticles(renderer *Renderer, particle_system *System, u32 Layer = Layer_Overlay)
+{
+    Assert(Renderer);
+    Assert(System);
+
+    if(System->Count == 0)
+    {
+        return;
+    }
+
+    command_buffer *Buffer = &Renderer->Commands;
+    if(Buffer->ParticleDrawCount == Buffer->ParticleDrawCapacity)
+    {
+        Buffer->ParticleDraws = (particle_system**)R_Grow(Buffer->ParticleDraws, &Buffer->ParticleDrawCapacity, Buffer->ParticleDrawCount + 1, sizeof(particle_system*), 4);
+    }
+    u32 Index = Buffer->ParticleDrawCount++;
+    Buffer->ParticleDraws[Index] = System;
+
+    R_PushCommand(Renderer, R_SortKey(Layer, Renderer->Shaders.Particle, 0, 0.0f), RenderCommand_Particles, Index);
+}
+
+// Moves the glyph to the front of the LRU list
+void R_TouchGlyph(font *Font, u16 Index)
+{
+    glyph *Glyph = &Font->Glyphs[Index];
+    if(Font->LruHead == Index)
+    {
+        return;
+    }
+
+    // Unlink, it is not the head so it has a previous one
+    Font->Glyphs[Glyph->LruPrev].LruNext = Glyph->LruNext;
+    if(Glyph->LruNext != GLYPH_NONE)
+    {
+        Font->Glyphs[Glyph->LruNext].LruPrev = Glyph->LruPrev;
+    }
+    else
+    {
+        Font->LruTail = Glyph->LruPrev;
+    }
+
+    Glyph->LruPrev = GLYPH_NONE;
+    Glyph->LruNext = Font->LruHead;
+    Font->Glyphs[Font->LruHead].LruPrev = Index;
+    Font->LruHead = Index;
+}
+
+u32 R_GlyphHash(u32 Codepoint, u32 PixelSize)
+{
+    return ((Codepoint * 2654435761u) ^ (PixelSize * 40503u)) & (GLYPH_HASH_SIZE - 1);
+}
+
+// Uploads a whole cell of pixels into the atlas and points the UVRect
+// of the glyph at it
+void R_UploadGlyphCell(font *Font, u16 Index, u8 *CellPixels)
+{
+    character *Character = &Font->Glyphs[Index].Character;
+    i32 CellX = (Index % GLYPH_CACHE_COLUMNS) * Font->CellWidth;
+    i32 CellY = (Index / GLYPH_CACHE_COLUMNS) * Font->CellHeight;
+    Character->UVRect = glm::vec4((f32)(CellX + FontAtlasPadding) / Font->AtlasWidth,
+                                  (f32)(CellY + FontAtlasPadding) / Font->AtlasHeight,
+                                  (f32)Character->Size.x / Font->AtlasWidth,
+                                  (f32)Character->Size.y / Font->AtlasHeight);
+
+    // Disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    R_BindTexture(0, Font->Atlas);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, CellX, CellY, Font->CellWidth, Font->CellHeight, GL_RED, GL_UNSIGNED_BYTE, CellPixels);
+}
+
+// Rasterizes the glyph with FreeType and uploads it into its cell of
+// the atlas
+void R_RasterizeGlyph(font *Font, u16 Index)
+{
+    glyph *Glyph = &Font->Glyphs[Index];
+    R_RasterizeGlyphPixels(Font->Face, Glyph->Codepoint, Font->DistanceField, Font->CellPixels, Font->CellWidth, Font->CellHeight, &Glyph->Character);
+    R_UploadGlyphCell(Font, Index, Font->CellPixels);
+    Font->GlyphsRasterized++;
+}
+
+// Gives the free cell Index to the glyph and links it into the hash table
+void R_InsertGlyph(font *Font, u16 Index, u32 Codepoint, u32 PixelSize)
+{
+    glyph *Glyph = &Font->Glyphs[Index];
+    u32 Hash = R_GlyphHash(Codepoint, PixelSize);
+    Glyph->Codepoint = Codepoint;
+    Glyph->PixelSize = PixelSize;
+    Glyph->Used = true;
+    Glyph->NextInHash = Font->HashTable[Hash];
+    Font->HashTable[Hash] = Index;
+}
+
+// Fills the glyph cache of a distance field font with the glyphs the
+// pack tool rasterized, so they are not rasterized when first drawn.
+// Glyphs that are not in the set are still rasterized on demand
+void R_LoadGlyphSet(font *Font, asset_handle Asset)
+{
+    Assert(Font);
+
+    if(!Asset.Entry || Asset.Entry->Type != ArchiveEntry_Glyphs || Asset.Entry->Size < sizeof(archive_glyph_set))
+    {
+        return;
+    }
+
+    archive_glyph_set *Set = (archive_glyph_set*)Asset.Data;
+    u64 CellSize = (u64)Set->CellWidth * Set->CellHeight;
+    if(!Font->DistanceField ||
+       Set->GlyphSize != Font->GlyphSize ||
+       Set->Spread != FontDistanceFieldSpread ||
+       Set->Oversample != FontDistanceFieldOversample ||
+       Set->CellWidth != Font->CellWidth ||
+       Set->CellHeight != Font->CellHeight ||
+       sizeof(archive_glyph_set) + Set->GlyphCount * (sizeof(archive_glyph) + CellSize) > Asset.Entry->Size)
+    {
+        printf("%s was rasterized with other settings, its glyphs are rasterized on demand\n", Asset.Entry->Name);
+        return;
+    }
+
+    archive_glyph *Glyphs = (archive_glyph*)(Set + 1);
+    u8 *Cells = (u8*)(Glyphs + Set->GlyphCount);
+    for(u32 i = 0; i < Set->GlyphCount; i++)
+    {
+        // Free cells are at the tail of the LRU list
+        u16 Index = Font->LruTail;
+        glyph *Glyph = &Font->Glyphs[Index];
+        if(Glyph->Used)
+        {
+            break;
+        }
+
+        R_InsertGlyph(Font, Index, Glyphs[i].Codepoint, (u32)Font->GlyphSize);
+        Glyph->Character.Size = glm::ivec2(Glyphs[i].Width, Glyphs[i].Height);
+        Glyph->Character.Bearing = glm::ivec2(Glyphs[i].BearingX, Glyphs[i].BearingY);
+        Glyph->Character.Advance = Glyphs[i].Advance;
+        R_UploadGlyphCell(Font, Index, Cells + i * CellSize);
+        R_TouchGlyph(Font, Index);
+    }
+}
+
+// Marks the glyph as drawn this frame, its cell is kept until R_EndFrame
+// drew the quads reading it
+void R_UseGlyph(renderer *Renderer, font *Font, u16 Index)
+{
+    R_TouchGlyph(Font, Index);
+    Font->Glyphs[Index].LastFrame = Renderer->Commands.FrameCount;
+}
+
+// Returns the glyph from the cache, rasterizing it on a miss. The cells
+// drawn this frame are never replaced, when they are all taken the
+// glyph is returned without a cell, see font.Overflow
+glyph *R_GetGlyph(renderer *Renderer, font *Font, u32 Codepoint)
+{
+    u32 PixelSize = (u32)Font->GlyphSize;
+    u32 Hash = R_GlyphHash(Codepoint, PixelSize);
+    for(u16 i = Font->HashTable[Hash]; i != GLYPH_NONE; i = Font->Glyphs[i].NextInHash)
+    {
+        glyph *Glyph = &Font->Glyphs[i];
+        if(Glyph->Codepoint == Codepoint && Glyph->PixelSize == PixelSize)
+        {
+            R_UseGlyph(Renderer, Font, i);
+            return Glyph;
+        }
+    }
+
+    u16 Index = Font->LruTail;
+    glyph *Glyph = &Font->Glyphs[Index];
+    if(Glyph->Used && Glyph->LastFrame == Renderer->Commands.FrameCount)
+    {
+        // Drawn glyphs go to the front of the LRU list, so the frame
+        // uses every cell. The glyph keeps its advance and is left out
+        // until a later frame has a cell for it
+        glyph *Overflow = &Font->Overflow;
+        R_RasterizeGlyphPixels(Font->Face, Codepoint, Font->DistanceField, Font->CellPixels, Font->CellWidth, Font->CellHeight, &Overflow->Character);
+        Overflow->Character.Size = glm::ivec2(0);
+        Overflow->Codepoint = Codepoint;
+        Overflow->PixelSize = PixelSize;
+        return Overflow;
+    }
+
+    if(Glyph->Used)
+    {
+        Font->GlyphsEvicted++;
+
+        u16 *Link = &Font->HashTable[R_GlyphHash(Glyph->Codepoint, Glyph->PixelSize)];
+        while(*Link != Index)
+        {
+            Link = &Font->Glyphs[*Link].NextInHash;
+        }
+        *Link = Glyph->NextInHash;
+    }
+
+    R_InsertGlyph(Font, Index, Codepoint, PixelSize);
+    R_RasterizeGlyph(Font, Index);
+
+    R_UseGlyph(Renderer, Font, Index);
+    return Glyph;
+}
+
+// Starts a text command for the font, its vertices follow at the end
+// of TextVertices
+text_command *R_PushTextCommand(renderer *Renderer, font *Font)
 {
-    // glUseProgram(Renderer->Shaders.Texture);
-    glm::mat4 Model = glm::mat4(1.0f);
-    Model = glm::translate(Model, Position);
-    Model = glm::rotate(Model, glm::radians(RotationAngle), glm::normalize(glm::vec3(0.0f, 0.0f, 1.0f)));
-    Model = glm::scale(Model, Size);
-    R_SetUniform(Renderer->Shaders.Texture, "Model", Model);
+    command_buffer *Buffer = &Renderer->Commands;
+    Buffer->Texts = (text_command*)R_Grow(Buffer->Texts, &Buffer->TextCapacity, Buffer->TextCount + 1, sizeof(text_command), COMMAND_BUFFER_INITIAL_CAPACITY);
+
+    u32 Index = Buffer->TextCount++;
+    text_command *Text = &Buffer->Texts[Index];
+    Text->Font = Font;
+    Text->First = Buffer->TextVertexCount;
+    Text->Count = 0;
+
+    u32 Shader = R_ShaderPermutation(&Renderer->Shaders.Text, Font->DistanceField ? Text_DistanceField : 0);
+    R_PushCommand(Renderer, R_SortKey(Layer_UI, Shader, Font->Atlas, 0.0f), RenderCommand_Text, Index);
+    return Text;
+}
+
 
-    R_SetUniform(Renderer->Shaders.Texture, "BrightnessThreshold", BrightnessThreshold);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, Texture->Handle);
-    glBindVertexArray(Renderer->QuadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    Renderer->CurrentDrawCallsPerFrame++;
-    glBindVertexArray(0);
+// Writes the 6 vertices of the glyph quad and advances the pen
+void R_LayoutGlyph(character *Ch, glm::vec2 *Position, glm::vec2 Scale, glm::vec3 Color, text_vertex *Vertex)
+{
+    f32 XPos = Position->x + Ch->Bearing.x * Scale.x;
+    f32 YPos = Position->y - (Ch->Size.y - Ch->Bearing.y) * Scale.y;
+
+    f32 W = Ch->Size.x * Scale.x;
+    f32 H = Ch->Size.y * Scale.y;
+
+    // The glyph bitmap starts at its top row, so the top of the
+    // quad samples the top of the rect in the atlas
+    f32 U0 = Ch->UVRect.x;
+    f32 V0 = Ch->UVRect.y;
+    f32 U1 = Ch->UVRect.x + Ch->UVRect.z;
+    f32 V1 = Ch->UVRect.y + Ch->UVRect.w;
+
+    *Vertex++ = {glm::vec2(XPos,     YPos + H), glm::vec2(U0, V0), Color};
+    *Vertex++ = {glm::vec2(XPos,     YPos),     glm::vec2(U0, V1), Color};
+    *Vertex++ = {glm::vec2(XPos + W, YPos),     glm::vec2(U1, V1), Color};
+    *Vertex++ = {glm::vec2(XPos,     YPos + H), glm::vec2(U0, V0), Color};
+    *Vertex++ = {glm::vec2(XPos + W, YPos),     glm::vec2(U1, V1), Color};
+    *Vertex++ = {glm::vec2(XPos + W, YPos + H), glm::vec2(U1, V0), Color};
+
+    // Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+    Position->x += (Ch->Advance >> 6) * Scale.x; // Bitshift by 6 to get value in pixels (2^6 = 64)
 }
 
+// Lays out the UTF-8 string into the command buffer, drawn by the next
+// R_SubmitCommands in one draw call with the other strings of the font
 void R_DrawText2D(renderer *Renderer, char *Text, font *Font, glm::vec2 Position, glm::vec2 Scale, glm::vec3 Color)
 {
     Assert(Renderer);
     Assert(Text);
     Assert(Font);
 
-    glUseProgram(Renderer->Shaders.Text);
-    glm::mat4 Identity = glm::mat4(1.0f);
-    R_SetUniform(Renderer->Shaders.Text, "Model", Identity);
-    R_SetUniform(Renderer->Shaders.Text, "TextColor", Color);
-    f32 TextBrightnessThreshold = 1.0f;
-    R_SetUniform(Renderer->Shaders.Text, "BrightnessThreshold", TextBrightnessThreshold);
-
-    glActiveTexture(GL_TEXTURE0); // TODO: Read why do we need to activate textures! NOTE: read this https://community.khronos.org/t/when-to-use-glactivetexture/64913
-    glBindVertexArray(Renderer->TextVAO);
+    command_buffer *Buffer = &Renderer->Commands;
+    text_command *Command = NULL;
+    Scale *= Font->GlyphScale;
 
     // Iterate through all the characters in string
-    for(char *Ptr = Text; *Ptr != '\0'; Ptr++)
+    u8 *Ptr = (u8*)Text;
+    while(*Ptr != '\0')
     {
-        character Ch = Font->Characters[*Ptr];
+        u32 Codepoint = DecodeUTF8(&Ptr);
+
+        character *Ch = &R_GetGlyph(Renderer, Font, Codepoint)->Character;
+        if(!Command)
+        {
+            Command = R_PushTextCommand(Renderer, Font);
+        }
+
+        if(Buffer->TextVertexCount + 6 > Buffer->TextVertexCapacity)
+        {
+            u32 Capacity = Buffer->TextVertexCapacity;
+            Buffer->TextVertices = (text_vertex*)R_Grow(Buffer->TextVertices, &Capacity, Buffer->TextVertexCount + 6, sizeof(text_vertex), TEXT_BUFFER_INITIAL_CAPACITY);
+            Buffer->TextUpload = (text_vertex*)R_Grow(Buffer->TextUpload, &Buffer->TextVertexCapacity, Buffer->TextVertexCount + 6, sizeof(text_vertex), TEXT_BUFFER_INITIAL_CAPACITY);
+        }
 
-        f32 XPos = Position.x + Ch.Bearing.x * Scale.x;
-        f32 YPos = Position.y - (Ch.Size.y - Ch.Bearing.y) * Scale.y;
+        R_LayoutGlyph(Ch, &Position, Scale, Color, Buffer->TextVertices + Buffer->TextVertexCount);
+        Buffer->TextVertexCount += 6;
+        Command->Count += 6;
+    }
+}
 
-        f32 W = Ch.Size.x * Scale.x;
-        f32 H = Ch.Size.y * Scale.y;
+u64 R_TextMeshHash(char *Text, font *Font, glm::vec2 Scale, glm::vec3 Color)
+{
+    // FNV-1a over the string, then the rest of the key
+    u64 Hash = 14695981039346656037ull;
+    for(u8 *Ptr = (u8*)Text; *Ptr != '\0'; Ptr++)
+    {
+        Hash = (Hash ^ *Ptr) * 1099511628211ull;
+    }
 
-        // printf("W: %2.2f\tH: %2.2f\n", W, H);
+    u32 Key[6];
+    memcpy(&Key[0], &Scale, sizeof(glm::vec2));
+    memcpy(&Key[2], &Color, sizeof(glm::vec3));
+    Key[5] = (u32)(uintptr_t)Font;
+    for(u32 i = 0; i < 6; i++)
+    {
+        Hash = (Hash ^ Key[i]) * 1099511628211ull;
+    }
+    return Hash;
+}
 
-        // Update VBO for each character
-        // TODO: Move QuadVertices to the bottom of renderer.h
-        f32 QuadVertices[6][3] =
+// Lays the string out at the origin into its part of the retained
+// vertex buffer
+void R_BuildTextMesh(renderer *Renderer, u32 Index)
+{
+    text_cache *Cache = &Renderer->TextCache;
+    text_mesh *Mesh = &Cache->Meshes[Index];
+
+    text_vertex Vertices[TEXT_CACHE_MAX_VERTICES];
+    glm::vec2 Position = glm::vec2(0.0f);
+    glm::vec2 Scale = Mesh->Scale * Mesh->Font->GlyphScale;
+    u32 Count = 0;
+    Mesh->GlyphCount = 0;
+    Mesh->Incomplete = false;
+    u8 *Ptr = (u8*)Mesh->Text;
+    while(*Ptr != '\0')
+    {
+        u32 Codepoint = DecodeUTF8(&Ptr);
+        glyph *Glyph = R_GetGlyph(Renderer, Mesh->Font, Codepoint);
+        if(Glyph == &Mesh->Font->Overflow)
+        {
+            Mesh->Incomplete = true;
+        }
+        else
         {
-            { XPos,     YPos + H, 0.0f},
-            { XPos,     YPos,     0.0f},
-            { XPos + W, YPos,     0.0f},
-            { XPos,     YPos + H, 0.0f},
-            { XPos + W, YPos,     0.0f},
-            { XPos + W, YPos + H, 0.0f}
-        };
+            Mesh->Glyphs[Mesh->GlyphCount++] = (u16)(Glyph - Mesh->Font->Glyphs);
+        }
+        R_LayoutGlyph(&Glyph->Character, &Position, Scale, Mesh->Color, Vertices + Count);
+        Count += 6;
+    }
 
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, Ch.TextureID);
-        glBindBuffer(GL_ARRAY_BUFFER, Renderer->TextVertexBuffer); // Update content of Vertex buffer
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(QuadVertices), QuadVertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // Evictions while laying it out never move its own glyphs, they
+    // are drawn this frame
+    Mesh->VertexCount = Count;
+    Mesh->FontEvictions = Mesh->Font->GlyphsEvicted;
+    Cache->MeshesBuilt++;
 
-        // Render  Quad
-        glDrawArrays(GL_TRIANGLES, 0, 6); Renderer->CurrentDrawCallsPerFrame++;
-        // Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        Position.x += (Ch.Advance >> 6) * Scale.x; // Bitshift by 6 to get value in pixels (2^6 = 64)
+    glBindBuffer(GL_ARRAY_BUFFER, Cache->VertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, Index * TEXT_CACHE_MAX_VERTICES * sizeof(text_vertex), Count * sizeof(text_vertex), Vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Like R_DrawText2D, for strings that stay the same for many frames.
+// Their quads are kept on the GPU and drawn by the next R_SubmitCommands
+// with one draw call each, a string seen last frame costs a hash, a
+// lookup and marking its glyphs as drawn
+void R_DrawTextRetained(renderer *Renderer, char *Text, font *Font, glm::vec2 Position, glm::vec2 Scale, glm::vec3 Color)
+{
+    Assert(Renderer);
+    Assert(Text);
+    Assert(Font);
+
+    size_t Length = strlen(Text);
+    if(Length > TEXT_CACHE_MAX_LENGTH)
+    {
+        R_DrawText2D(Renderer, Text, Font, Position, Scale, Color);
+        return;
+    }
+
+    text_cache *Cache = &Renderer->TextCache;
+
+    u64 Hash = R_TextMeshHash(Text, Font, Scale, Color);
+    u32 Index = TEXT_CACHE_SIZE;
+    u32 Oldest = 0;
+    for(u32 i = 0; i < TEXT_CACHE_SIZE; i++)
+    {
+        text_mesh *Mesh = &Cache->Meshes[i];
+        if(Mesh->Used && Mesh->Hash == Hash && Mesh->Font == Font && Mesh->Scale == Scale && Mesh->Color == Color && strcmp(Mesh->Text, Text) == 0)
+        {
+            Index = i;
+            break;
+        }
+
+        // Free meshes first, then the one drawn the longest ago
+        text_mesh *OldestMesh = &Cache->Meshes[Oldest];
+        if(OldestMesh->Used && (!Mesh->Used || Mesh->LastFrame < OldestMesh->LastFrame))
+        {
+            Oldest = i;
+        }
+    }
+
+    if(Index == TEXT_CACHE_SIZE)
+    {
+        Index = Oldest;
+        text_mesh *Mesh = &Cache->Meshes[Index];
+        if(Mesh->Used && Mesh->LastFrame == Renderer->Commands.FrameCount)
+        {
+            // Every mesh is drawn this frame, the string is laid out
+            // like any other instead
+            R_DrawText2D(Renderer, Text, Font, Position, Scale, Color);
+            return;
+        }
+
+        Mesh->Used = true;
+        Mesh->Hash = Hash;
+        Mesh->Font = Font;
+        Mesh->Scale = Scale;
+        Mesh->Color = Color;
+        memcpy(Mesh->Text, Text, Length + 1);
+        R_BuildTextMesh(Renderer, Index);
+    }
+    else if(Cache->Meshes[Index].FontEvictions != Font->GlyphsEvicted || Cache->Meshes[Index].Incomplete)
+    {
+        // Some glyph of the font lost its cell, maybe one of ours, or one
+        // of ours had none
+        R_BuildTextMesh(Renderer, Index);
+    }
+    else
+    {
+        text_mesh *Mesh = &Cache->Meshes[Index];
+        for(u32 i = 0; i < Mesh->GlyphCount; i++)
+        {
+            R_UseGlyph(Renderer, Font, Mesh->Glyphs[i]);
+        }
     }
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    Cache->Meshes[Index].LastFrame = Renderer->Commands.FrameCount;
+
+    command_buffer *Buffer = &Renderer->Commands;
+    Buffer->MeshDraws = (text_mesh_draw*)R_Grow(Buffer->MeshDraws, &Buffer->MeshDrawCapacity, Buffer->MeshDrawCount + 1, sizeof(text_mesh_draw), TEXT_CACHE_SIZE);
+    u32 Draw = Buffer->MeshDrawCount++;
+    Buffer->MeshDraws[Draw] = {Index, Position};
+
+    // Sorted after the strings of R_DrawText2D in the same font, so
+    // those stay one run
+    u32 Shader = R_ShaderPermutation(&Renderer->Shaders.Text, Font->DistanceField ? Text_DistanceField : 0);
+    R_PushCommand(Renderer, R_SortKey(Layer_UI, Shader, Font->Atlas, 1.0f), RenderCommand_TextMesh, Draw);
 }
 
 void R_CalculateFPS(renderer *Renderer, clock *Clock)
@@ -865,17 +2522,22 @@ void R_ResetCamera(camera *Camera, i32 Width, i32 Height, glm::vec3 Position, gl
     Camera->Pitch = 0.0f;
 }
 
-void R_DrawEntity(renderer *Renderer, entity *Entity)
+void R_DrawEntity(renderer *Renderer, entity *Entity, u32 Layer = Layer_World)
 {
-    R_DrawTexture(Renderer, Entity->Texture, Entity->Position, Entity->Size, glm::vec3(0.0f, 0.0f, 1.0f), Entity->Angle);
+    f32 Alpha = Renderer->InterpolationAlpha;
+    glm::vec3 Position = Lerp(Entity->PreviousPosition, Entity->Position, Alpha);
+    glm::vec2 Rotation = RotationLerp(Entity->PreviousRotation, Entity->Rotation, Alpha);
+    R_PushSprite(Renderer, Layer, Entity->Texture, Position, glm::vec2(Entity->Size), Rotation);
 }
 
-void R_DrawEntityList(renderer *Renderer, entity_list *List)
+void R_DrawEntityList(renderer *Renderer, entity_list *List, u32 Layer = Layer_World)
 {
-    for(entity_node *Node = List->Head;
-        Node != NULL;
-        Node = Node->Next)
+    f32 Alpha = Renderer->InterpolationAlpha;
+    for(u32 i = 0; i < List->Count; i++)
     {
-        R_DrawEntity(Renderer, Node->Entity);
+        entity *Entity = &List->Entities[i];
+        glm::vec3 Position = Lerp(Entity->PreviousPosition, Entity->Position, Alpha);
+        glm::vec2 Rotation = RotationLerp(Entity->PreviousRotation, Entity->Rotation, Alpha);
+        R_PushSprite(Renderer, Layer, Entity->Texture, Position, glm::vec2(Entity->Size), Rotation);
     }
 }
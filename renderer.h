@@ -2,10 +2,370 @@
 
 #include "shared.h"
 #include "platform.h"
+#include "archive.h"
+#include "glyph.h"
+#include "particle.h"
+
+struct texture;
+struct font;
+
+// Draws are recorded into the command buffer during the frame and
+// submitted by R_EndFrame, sorted by a 64 bit key so the ones sharing a
+// shader and texture end up next to each other and are merged into one
+// draw call, see R_SortKey and R_SubmitCommands
+#define COMMAND_BUFFER_INITIAL_CAPACITY 1024
+#define SPRITE_BUFFER_INITIAL_CAPACITY 256
+#define TEXT_BUFFER_INITIAL_CAPACITY 1024
+
+// Layers are drawn in order, everything in a layer is sorted by shader,
+// texture and then back to front
+enum render_layer
+{
+    Layer_Background,
+    Layer_World,
+    Layer_Overlay,
+    Layer_UI,
+};
+
+enum render_command_type
+{
+    RenderCommand_Sprite,
+    RenderCommand_Text,
+    RenderCommand_TextMesh,
+    RenderCommand_Particles,
+};
+
+struct render_command
+{
+    u64 Key;
+    u32 Type;  // render_command_type
+    u32 Index; // Into the array of its type in the command buffer
+};
+
+struct sprite_instance
+{
+    glm::vec3 Position;
+    glm::vec2 Size;
+    glm::vec2 Rotation; // (cos, sin)
+    glm::vec4 UVRect;   // Offset in xy, size in zw
+};
+
+struct sprite_command
+{
+    sprite_instance Instance;
+    u32 Texture;
+};
+
+struct text_vertex
+{
+    glm::vec2 Position;
+    glm::vec2 UV;
+    glm::vec3 Color;
+};
+
+// One string laid out by R_DrawText2D
+struct text_command
+{
+    font *Font;
+    u32 First; // In TextVertices
+    u32 Count;
+};
+
+// One string drawn by R_DrawTextRetained
+struct text_mesh_draw
+{
+    u32 Mesh;
+    glm::vec2 Position;
+};
+
+struct command_buffer
+{
+    render_command *Commands;
+    render_command *SortBuffer;
+    u32 Count;
+    u32 Capacity;
+
+    sprite_command *Sprites;
+    sprite_instance *SpriteUpload; // Sprites in submission order
+    u32 SpriteCount;
+    u32 SpriteCapacity;
+
+    text_command *Texts;
+    u32 TextCount;
+    u32 TextCapacity;
+
+    text_vertex *TextVertices;
+    text_vertex *TextUpload; // TextVertices in submission order
+    u32 TextVertexCount;
+    u32 TextVertexCapacity;
+
+    text_mesh_draw *MeshDraws;
+    u32 MeshDrawCount;
+    u32 MeshDrawCapacity;
+
+    particle_system **ParticleDraws;
+    u32 ParticleDrawCount;
+    u32 ParticleDrawCapacity;
+
+    // GPU side, grown when a submit needs more
+    u32 SpriteVAO;
+    u32 SpriteInstanceBuffer;
+    u32 SpriteBufferCapacity; // In instances
+    u32 ParticleVAO;
+    u32 ParticleInstanceBuffer;
+    u32 ParticleBufferCapacity; // In instances
+    u32 TextBufferCapacity; // In vertices
+
+    u32 FrameCount; // R_EndFrame calls
+};
+
+// Last GL state set through the R_ state functions, they skip the GL
+// call when nothing changes. Everything that binds a program, texture
+// or vertex array has to go through them
+#define GL_STATE_TEXTURE_UNITS 2
+
+enum blend_mode
+{
+    BlendMode_None,
+    BlendMode_Alpha,
+    BlendMode_Additive,
+};
+
+struct gl_state
+{
+    u32 Program;
+    u32 VertexArray;
+    u32 ActiveTexture; // Unit index
+    u32 Textures[GL_STATE_TEXTURE_UNITS];
+    u32 BlendMode;
+    u32 BlendFunc; // blend_mode of the last glBlendFunc, kept while blending is disabled
+};
+
+// Strings drawn with R_DrawTextRetained keep their glyph quads in a
+// GPU buffer between frames, keyed by font, string, scale and color,
+// and are only laid out again when one of those changes. Every mesh
+// owns TEXT_CACHE_MAX_VERTICES of the buffer
+#define TEXT_CACHE_SIZE 64
+#define TEXT_CACHE_MAX_LENGTH 96 // Bytes, longer strings go through R_DrawText2D
+#define TEXT_CACHE_MAX_VERTICES (TEXT_CACHE_MAX_LENGTH * 6)
+
+struct text_mesh
+{
+    u64 Hash;
+    font *Font;
+    glm::vec2 Scale;
+    glm::vec3 Color;
+    char Text[TEXT_CACHE_MAX_LENGTH + 1];
+    u32 VertexCount;
+    u32 FontEvictions; // Font->GlyphsEvicted when built, its glyph cells may have moved since if different
+    u16 Glyphs[TEXT_CACHE_MAX_LENGTH]; // Cells it reads, kept for as long as it is drawn
+    u32 GlyphCount;
+    b32 Incomplete; // Some glyph had no cell when built, see R_GetGlyph
+    u32 LastFrame; // Like glyph.LastFrame
+    b32 Used;
+};
+
+struct text_cache
+{
+    u32 VAO;
+    u32 VertexBuffer;
+    text_mesh Meshes[TEXT_CACHE_SIZE];
+    u32 MeshesBuilt;
+};
+
+// Active uniforms and uniform blocks of every program are read back
+// after linking, draw code sets uniforms through handles resolved once
+// with R_GetUniform instead of looking them up by name
+#define SHADER_MAX_PROGRAMS 16
+#define SHADER_MAX_UNIFORMS 16
+#define SHADER_MAX_BLOCKS 4
+#define SHADER_MAX_NAME 32
+
+struct shader_uniform
+{
+    char Name[SHADER_MAX_NAME];
+    i32 Location;
+    GLenum Type;
+    f32 Value[16]; // Last value uploaded, big enough for a mat4
+    b32 HasValue;
+};
+
+struct shader_block
+{
+    char Name[SHADER_MAX_NAME];
+    u32 Index;
+    i32 DataSize;
+};
+
+struct shader_program
+{
+    u32 Handle;
+    char *Filename;
+    shader_uniform Uniforms[SHADER_MAX_UNIFORMS];
+    u32 UniformCount;
+    shader_block Blocks[SHADER_MAX_BLOCKS];
+    u32 BlockCount;
+};
+
+// A glsl file declares its feature keywords on one line,
+//     #pragma keywords THRESHOLD DOWNSAMPLE UPSAMPLE
+// which the GL compiler ignores, and every combination the draw code
+// uses is compiled up front with those keywords #defined, so a feature
+// that is off is compiled out instead of branched over per fragment.
+// A combination is picked by key, bit i set for the i-th keyword, see
+// R_ShaderPermutation
+#define SHADER_MAX_KEYWORDS 4
+#define SHADER_MAX_PERMUTATIONS (1 << SHADER_MAX_KEYWORDS)
+#define SHADER_KEYWORD_LENGTH 32
+
+struct shader_permutations
+{
+    char *Filename;
+    char Keywords[SHADER_MAX_KEYWORDS][SHADER_KEYWORD_LENGTH];
+    u32 KeywordCount;
+    u32 Programs[SHADER_MAX_PERMUTATIONS]; // By key, 0 when not compiled
+};
+
+// Keys of the renderer's shaders, in the order of their #pragma keywords
+enum kawase_keyword
+{
+    Kawase_Threshold = 1 << 0,
+    Kawase_Downsample = 1 << 1,
+    Kawase_Upsample = 1 << 2,
+};
+
+enum bloom_keyword
+{
+    Bloom_Bloom = 1 << 0, // Adds the blurred mip chain before tonemapping
+};
+
+enum text_keyword
+{
+    Text_DistanceField = 1 << 0,
+};
+
+// Linked programs saved with glGetProgramBinary, one file per program
+// named after its key. The key hashes the source, the defines and the
+// GL vendor, renderer and version strings, so a new driver or an edit
+// to a shader misses the cache. See R_LoadProgramBinary
+#define SHADER_CACHE_MAGIC 0x48535047 // "GPSH"
+
+struct shader_cache_header
+{
+    u32 Magic;
+    u32 BinaryFormat;
+    u64 Key;
+    u32 Size; // Of the binary that follows
+    u32 Reserved;
+};
+
+// Setting a handle whose uniform the compiler removed does nothing
+struct uniform
+{
+    shader_uniform *Uniform;
+};
+
+// Post processing is declared every frame as a graph of passes, each
+// reading textures and writing one, see R_BuildFrameGraph. Disabled
+// passes and passes whose output nothing reads are culled, and the
+// textures of the passes left come from a pool of transient textures
+// that are reused across frames while their size still fits the window
+#define RENDER_GRAPH_MAX_PASSES 32
+#define RENDER_GRAPH_MAX_TEXTURES 16
+#define RENDER_PASS_MAX_INPUTS GL_STATE_TEXTURE_UNITS
+#define TRANSIENT_POOL_SIZE 16
+#define TRANSIENT_MAX_IDLE_FRAMES 4 // Pool textures unused for longer are deleted
+#define GRAPH_BACKBUFFER 0 // Graph texture of the window, there is no texture behind it
+#define GRAPH_NONE 0xFFFFFFFF
+
+#define BLOOM_MAX_MIPS 8
+
+// Every pass that runs is timed on the GPU with a GL_TIME_ELAPSED
+// query. A frame's queries are read back GPU_TIMER_FRAMES frames
+// later, when the GPU is long done with them, so reading never stalls
+#define GPU_TIMER_FRAMES 4
+
+struct gpu_timer_frame
+{
+    u32 Queries[RENDER_GRAPH_MAX_PASSES];
+    char *Names[RENDER_GRAPH_MAX_PASSES];
+    u32 Count;
+    b32 Pending; // Issued and not read back yet
+};
+
+struct gpu_timers
+{
+    gpu_timer_frame Frames[GPU_TIMER_FRAMES];
+    u32 Current; // Frame the next queries are issued into
+
+    // Last frame read back, in pass order
+    char *Names[RENDER_GRAPH_MAX_PASSES];
+    f32 Milliseconds[RENDER_GRAPH_MAX_PASSES];
+    u32 Count;
+    f32 TotalMilliseconds;
+    u32 FramesRead;
+
+    FILE *Log; // CSV, a row per pass of every frame read back
+};
+
+struct renderer;
+struct render_pass;
+typedef void render_pass_function(renderer *Renderer, render_pass *Pass);
+
+struct graph_texture
+{
+    i32 Width;
+    i32 Height;
+    GLenum InternalFormat;
+    b32 DepthStencil;
+
+    // Set by R_CompileGraph
+    b32 Written; // By a pass that was not culled, otherwise the texture is never created
+    u32 LastPass;
+    u32 Transient; // Into render_graph.Pool
+};
+
+struct render_pass
+{
+    char *Name;
+    render_pass_function *Execute;
+    u32 Inputs[RENDER_PASS_MAX_INPUTS]; // Bound to texture units in order, 0 when not written
+    u32 InputCount;
+    u32 Output;
+    u32 BlendMode;
+    b32 Enabled;
+    b32 Culled;
+};
+
+struct transient_texture
+{
+    u32 Handle;
+    u32 Framebuffer;
+    u32 DepthStencilRenderbuffer;
+    i32 Width;
+    i32 Height;
+    GLenum InternalFormat;
+    b32 DepthStencil;
+
+    u32 LastFrame; // Graph frame it was last handed out
+    u32 BusyUntil; // Last pass of its graph texture during LastFrame
+};
+
+struct render_graph
+{
+    render_pass Passes[RENDER_GRAPH_MAX_PASSES];
+    u32 PassCount;
+    graph_texture Textures[RENDER_GRAPH_MAX_TEXTURES];
+    u32 TextureCount;
+
+    transient_texture Pool[TRANSIENT_POOL_SIZE];
+    u32 Frame;
+};
 
 struct renderer
 {
     window *Window;
+    archive *Archive; // Shaders are read from it when set, see R_CreateShaderVariant
 
     // Settings
     f32 Exposure;
@@ -21,32 +381,49 @@ struct renderer
     u32 DrawableWidth;
     u32 DrawableHeight;
 
-    u32 QuadVAO;
     u32 QuadVBO;
     u32 TextVAO;
     u32 TextVertexBuffer;
-    u32 TextTexCoordsBuffer;
     u32 UnitQuadVAO;
     u32 UnitQuadVBO;
 
     struct Shaders
     {
-        u32 Blur; // Does not use Uniform Buffer object for Camera
-        u32 Bloom; // Does not use Uniform Buffer object for Camera
-        u32 Hdr; // Does not use Uniform Buffer object for Camera
-        u32 Texture;
-        u32 Text;
-        u32 Ball;
+        shader_permutations Kawase; // Do not use Uniform Buffer object for Camera
+        shader_permutations Bloom; // Tonemap, does not use Uniform Buffer object for Camera
+        shader_permutations Text;
+        u32 Sprite;
+        u32 Particle;
     } Shaders;
 
-    u32 Framebuffer;
-    u32 ColorBuffer;
-    u32 BrightnessBuffer;
-    u32 DepthStencilRenderbuffer;
+    // Resolved once after the shaders are created
+    struct Uniforms
+    {
+        uniform BloomThresholdBrightnessThreshold;
+        uniform BloomDownsampleHalfPixel;
+        uniform BloomUpsampleHalfPixel;
+        uniform BloomStrength;
+        uniform BloomExposure;
+        uniform TonemapExposure; // bloom.glsl without Bloom_Bloom
+        uniform TextOffset;
+        uniform TextDistanceFieldOffset;
+        uniform ParticleBrightness;
+    } Uniforms;
+
+    b32 ProgramBinaries; // The driver can save and load linked programs, see ShaderCacheDirectory
+    u32 ProgramsLoaded; // From the cache at startup
+    u32 ProgramsCompiled;
+
+    command_buffer Commands;
+    text_cache TextCache;
+
     u32 UniformCameraBuffer;
-    u32 Attachments[2];
-    u32 PingPongFBO[2];
-    u32 PingPongBuffer[2];
+
+    render_graph Graph;
+    u32 SceneColor; // Graph texture the scene layers are drawn to
+    u32 ScenePass;
+    u32 BloomMipCount; // Levels of the bloom mip chain declared this frame
+    gpu_timers GPUTimers;
 
     // These variables correspond to the FPS counter
     f32 FPS; // AverageFPS
@@ -56,6 +433,10 @@ struct renderer
 
     u32 PreviousDrawCallsPerFrame;
     u32 CurrentDrawCallsPerFrame;
+
+    // Set every frame from the clock, entities are drawn this far
+    // between their previous and current simulation transforms
+    f32 InterpolationAlpha = 1.0f;
 };
 
 struct camera
@@ -88,12 +469,26 @@ struct texture
     GLenum Format;
 };
 
-struct character
+// Glyphs are rasterized the first time they are drawn, into a cell of
+// the font atlas. When every cell is taken the least recently used
+// glyph gives its cell up, unless it is drawn this frame, see R_GetGlyph
+#define GLYPH_CACHE_COLUMNS 16
+#define GLYPH_CACHE_ROWS 16
+#define GLYPH_CACHE_SIZE (GLYPH_CACHE_COLUMNS * GLYPH_CACHE_ROWS)
+#define GLYPH_HASH_SIZE 512 // Power of two
+#define GLYPH_NONE 0xFFFF
+
+struct glyph
 {
-    u32 TextureID;
-    glm::ivec2 Size;    // Size of glyph
-    glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
-    u32 Advance;        // Offset to advance to next glyph
+    u32 Codepoint;
+    u32 PixelSize;
+    character Character;
+    b32 Used; // Otherwise the cell is free
+
+    u16 NextInHash;
+    u16 LruPrev; // Towards the most recently used
+    u16 LruNext; // Towards the least recently used
+    u32 LastFrame; // Commands.FrameCount when last drawn, its cell is kept while equal
 };
 
 struct font
@@ -101,7 +496,32 @@ struct font
     char *Filename;
     i32 Width;
     i32 Height;
-    character Characters[256];
+
+    // Kept alive to rasterize glyphs on demand
+    FT_Library Library;
+    FT_Face Face;
+
+    // Distance field fonts store every glyph once, at
+    // FontDistanceFieldSize, and draw it sharp at any scale. Width
+    // and Height are then only the size drawn at a scale of 1
+    b32 DistanceField;
+    i32 GlyphSize;  // Pixel size of the glyphs in the atlas
+    f32 GlyphScale; // Height / GlyphSize
+
+    u32 Atlas; // GLYPH_CACHE_COLUMNS x GLYPH_CACHE_ROWS cells, GL_RED
+    i32 AtlasWidth;
+    i32 AtlasHeight;
+    i32 CellWidth;
+    i32 CellHeight;
+    u8 *CellPixels; // Staging for one cell upload
+
+    glyph Glyphs[GLYPH_CACHE_SIZE]; // Glyph i lives in cell i
+    u16 HashTable[GLYPH_HASH_SIZE];
+    u16 LruHead; // Most recently used
+    u16 LruTail; // Next to be evicted
+    glyph Overflow; // Metrics of a glyph that found every cell drawn this frame, no pixels
+    u32 GlyphsRasterized;
+    u32 GlyphsEvicted;
 };
 
 f32 UnitQuadVertices__[] =
@@ -121,13 +541,3 @@ f32 QuadVertices__[] =
     0.5f,  0.5f, 0.0f, 1.0f, 1.0f,
     0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
 };
-
-f32 TextTexCoords__[6][2] =
-{
-    {0.0, 0.0f},
-    {0.0f, 1.0f},
-    {1.0, 1.0},
-    {0.0, 0.0},
-    {1.0, 1.0},
-    {1.0, 0.0},
-};
@@ -0,0 +1,515 @@
+#pragma once
+
+/*
+  Input recording and playback. The game is deterministic given the
+  RNG seed, the tick rate and the game_input of every tick, so that is
+  all a replay stores, see replay.h for the file layout. Recording
+  and playing back happen one tick at a time, right before
+  SimulateGameTick.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "shared.h"
+#include "replay.h"
+#include "game.h"
+#include "entity.h"
+
+global u32 ReplayKeyframeInterval = 600; // Ticks between keyframes, 10 seconds at 60 Hz
+
+// ------ Buffer writing
+
+void RP_Reserve(replay_buffer *Buffer, u32 Size)
+{
+    if(Buffer->Size + Size <= Buffer->Capacity)
+    {
+        return;
+    }
+
+    u32 NewCapacity = Buffer->Capacity ? Buffer->Capacity * 2 : Kilobytes(64);
+    while(NewCapacity < Buffer->Size + Size)
+    {
+        NewCapacity *= 2;
+    }
+    Buffer->Data = (u8*)Realloc(Buffer->Data, NewCapacity); Assert(Buffer->Data);
+    Buffer->Capacity = NewCapacity;
+}
+
+void RP_WriteBytes(replay_buffer *Buffer, void *Data, u32 Size)
+{
+    RP_Reserve(Buffer, Size);
+    memcpy(Buffer->Data + Buffer->Size, Data, Size);
+    Buffer->Size += Size;
+}
+
+void RP_WriteU8(replay_buffer *Buffer, u8 Value)
+{
+    RP_WriteBytes(Buffer, &Value, sizeof(Value));
+}
+
+void RP_WriteU32(replay_buffer *Buffer, u32 Value)
+{
+    RP_WriteBytes(Buffer, &Value, sizeof(Value));
+}
+
+void RP_WriteF32(replay_buffer *Buffer, f32 Value)
+{
+    RP_WriteBytes(Buffer, &Value, sizeof(Value));
+}
+
+// 7 bits per byte, the high bit says another byte follows
+void RP_WriteVarint(replay_buffer *Buffer, u32 Value)
+{
+    while(Value >= 0x80)
+    {
+        RP_WriteU8(Buffer, (u8)(Value | 0x80));
+        Value >>= 7;
+    }
+    RP_WriteU8(Buffer, (u8)Value);
+}
+
+// Maps small negative and positive deltas to small unsigned values
+u32 RP_ZigZag(i32 Value)
+{
+    return ((u32)Value << 1) ^ (u32)(Value >> 31);
+}
+
+i32 RP_UnZigZag(u32 Value)
+{
+    return (i32)(Value >> 1) ^ -(i32)(Value & 1);
+}
+
+// ------ Stream reading, reads past the end of the stream return zeros
+
+void RP_ReadBytes(replay *Replay, void *Data, u32 Size)
+{
+    if(Replay->Offset + Size > Replay->Stream.Size)
+    {
+        memset(Data, 0, Size);
+        Replay->Offset = Replay->Stream.Size;
+        return;
+    }
+    memcpy(Data, Replay->Stream.Data + Replay->Offset, Size);
+    Replay->Offset += Size;
+}
+
+u8 RP_ReadU8(replay *Replay)
+{
+    u8 Result;
+    RP_ReadBytes(Replay, &Result, sizeof(Result));
+    return Result;
+}
+
+u32 RP_ReadU32(replay *Replay)
+{
+    u32 Result;
+    RP_ReadBytes(Replay, &Result, sizeof(Result));
+    return Result;
+}
+
+f32 RP_ReadF32(replay *Replay)
+{
+    f32 Result;
+    RP_ReadBytes(Replay, &Result, sizeof(Result));
+    return Result;
+}
+
+u32 RP_ReadVarint(replay *Replay)
+{
+    u32 Result = 0;
+    for(u32 Shift = 0; Shift < 32; Shift += 7)
+    {
+        u8 Byte = RP_ReadU8(Replay);
+        Result |= (u32)(Byte & 0x7F) << Shift;
+        if(!(Byte & 0x80))
+        {
+            break;
+        }
+    }
+    return Result;
+}
+
+// ------ Game state snapshots, written into the keyframes
+
+// Only the fields that carry over from one tick to the next, the
+// acceleration is zero between ticks and the collider is rebuilt from
+// the transform
+void RP_WriteEntity(replay_buffer *Buffer, entity *Entity)
+{
+    RP_WriteBytes(Buffer, &Entity->Position, sizeof(Entity->Position));
+    RP_WriteBytes(Buffer, &Entity->Velocity, sizeof(Entity->Velocity));
+    RP_WriteBytes(Buffer, &Entity->Direction, sizeof(Entity->Direction));
+    RP_WriteBytes(Buffer, &Entity->Size, sizeof(Entity->Size));
+    RP_WriteBytes(Buffer, &Entity->Rotation, sizeof(Entity->Rotation));
+    RP_WriteF32(Buffer, Entity->Speed);
+    RP_WriteF32(Buffer, Entity->Drag);
+    RP_WriteU8(Buffer, (u8)Entity->Type);
+    RP_WriteU8(Buffer, (u8)Entity->Collider.Type);
+}
+
+void RP_ReadEntity(replay *Replay, entity *Entity)
+{
+    RP_ReadBytes(Replay, &Entity->Position, sizeof(Entity->Position));
+    RP_ReadBytes(Replay, &Entity->Velocity, sizeof(Entity->Velocity));
+    RP_ReadBytes(Replay, &Entity->Direction, sizeof(Entity->Direction));
+    RP_ReadBytes(Replay, &Entity->Size, sizeof(Entity->Size));
+    RP_ReadBytes(Replay, &Entity->Rotation, sizeof(Entity->Rotation));
+    Entity->Speed = RP_ReadF32(Replay);
+    Entity->Drag = RP_ReadF32(Replay);
+    Entity->Type = (entity_type)RP_ReadU8(Replay);
+    Entity->Collider.Type = (collider_type)RP_ReadU8(Replay);
+    Entity->Acceleration = glm::vec3(0.0f);
+}
+
+void RP_WriteEntityList(replay_buffer *Buffer, entity_list *List)
+{
+    RP_WriteU32(Buffer, List->Count);
+    for(u32 i = 0; i < List->Count; i++)
+    {
+        RP_WriteEntity(Buffer, &List->Entities[i]);
+    }
+}
+
+void RP_ReadEntityList(replay *Replay, entity_list *List)
+{
+    E_EmptyList(List);
+
+    u32 Count = RP_ReadU32(Replay);
+    for(u32 i = 0; i < Count && Replay->Offset < Replay->Stream.Size; i++)
+    {
+        entity Saved = {};
+        RP_ReadEntity(Replay, &Saved);
+
+        // Pushed in the same dense order, so the grid and the batch
+        // see the entities in the same order as when recording
+        entity *Entity = E_PushEntity(List, E_MakeEntity(GameEntityTexture(Saved.Type), Saved.Position, Saved.Direction, Saved.Size,
+                                                         Saved.Rotation, Saved.Speed, Saved.Drag, Saved.Type, Saved.Collider.Type));
+        Entity->Direction = Saved.Direction; // E_MakeEntity normalizes it again, keep the exact bits
+        Entity->Velocity = Saved.Velocity;
+        E_UpdateColliderTransform(Entity);
+    }
+}
+
+// Everything SimulateGameTick reads besides its input
+void RP_WriteGameState(replay_buffer *Buffer)
+{
+    RP_WriteU32(Buffer, RandomGetState());
+    RP_WriteU32(Buffer, GameTick);
+    RP_WriteU32(Buffer, PlayerScore);
+    RP_WriteU32(Buffer, PlayerLives);
+    RP_WriteEntity(Buffer, Player);
+    RP_WriteEntityList(Buffer, Enemies);
+    RP_WriteEntityList(Buffer, Bullets);
+}
+
+void RP_ReadGameState(replay *Replay)
+{
+    u32 RandomState = RP_ReadU32(Replay);
+    if(RandomState) { RandomSeed(RandomState); }
+    GameTick = RP_ReadU32(Replay);
+    PlayerScore = RP_ReadU32(Replay);
+    PlayerLives = RP_ReadU32(Replay);
+    RP_ReadEntity(Replay, Player);
+    E_UpdateColliderTransform(Player);
+    E_SavePreviousTransform(Player);
+    RP_ReadEntityList(Replay, Enemies);
+    RP_ReadEntityList(Replay, Bullets);
+    CurrentState = State_Game;
+}
+
+// ------ Recording
+
+replay *RP_CreateRecording(u32 Seed)
+{
+    replay *Result = (replay*)Malloc(sizeof(replay)); Assert(Result);
+    *Result = {};
+
+    Result->Recording = true;
+    Result->Header.Magic = REPLAY_MAGIC;
+    Result->Header.Version = REPLAY_VERSION;
+    Result->Header.Seed = Seed;
+    Result->Header.KeyframeInterval = ReplayKeyframeInterval;
+    Result->Header.TickRate = SimulationTickRate;
+    Result->Header.EnemySpawnsPerSecond = EnemySpawnsPerSecond;
+
+    return Result;
+}
+
+void RP_MouseBits(game_input *Input, u32 *Bits)
+{
+    memcpy(Bits, &Input->MouseWorldPosition, sizeof(u32) * 3);
+}
+
+// Call right before SimulateGameTick with the input it is about to
+// read, Reset tells that GameReset was called since the last tick
+void RP_RecordTick(replay *Replay, game_input *Input, b32 Reset)
+{
+    Assert(Replay->Recording);
+
+    u32 Mouse[3];
+    RP_MouseBits(Input, Mouse);
+    b32 Keyframe = (Replay->Tick % Replay->Header.KeyframeInterval) == 0;
+    b32 MouseChanged = Mouse[0] != Replay->Mouse[0] || Mouse[1] != Replay->Mouse[1] || Mouse[2] != Replay->Mouse[2];
+
+    i32 MoveX = (i32)Input->Move.x + 1;
+    i32 MoveY = (i32)Input->Move.y + 1;
+    MoveX = MoveX < 0 ? 0 : (MoveX > 2 ? 2 : MoveX);
+    MoveY = MoveY < 0 ? 0 : (MoveY > 2 ? 2 : MoveY);
+
+    u8 Flags = (u8)(MoveX | (MoveY << ReplayTick_MoveYShift));
+    if(Input->Fire)   { Flags |= ReplayTick_Fire; }
+    if(Reset)         { Flags |= ReplayTick_Reset; }
+    if(MouseChanged)  { Flags |= ReplayTick_MouseChanged; }
+    if(Keyframe)      { Flags |= ReplayTick_Keyframe; }
+
+    if(Keyframe)
+    {
+        if(Replay->Header.KeyframeCount == Replay->KeyframeCapacity)
+        {
+            Replay->KeyframeCapacity = Replay->KeyframeCapacity ? Replay->KeyframeCapacity * 2 : 64;
+            Replay->Keyframes = (replay_keyframe*)Realloc(Replay->Keyframes, sizeof(replay_keyframe) * Replay->KeyframeCapacity); Assert(Replay->Keyframes);
+            Assert(Replay->Keyframes);
+        }
+        replay_keyframe *New = &Replay->Keyframes[Replay->Header.KeyframeCount++];
+        New->Tick = Replay->Tick;
+        New->Offset = Replay->Stream.Size;
+    }
+
+    RP_WriteU8(&Replay->Stream, Flags);
+
+    if(Keyframe)
+    {
+        // Absolute mouse position and the game state, decoding and
+        // simulating can start here
+        RP_WriteU32(&Replay->Stream, Mouse[0]);
+        RP_WriteU32(&Replay->Stream, Mouse[1]);
+        RP_WriteU32(&Replay->Stream, Mouse[2]);
+
+        Replay->Scratch.Size = 0;
+        RP_WriteGameState(&Replay->Scratch);
+        RP_WriteU32(&Replay->Stream, Replay->Scratch.Size);
+        RP_WriteBytes(&Replay->Stream, Replay->Scratch.Data, Replay->Scratch.Size);
+    }
+    else if(MouseChanged)
+    {
+        for(u32 i = 0; i < 3; i++)
+        {
+            RP_WriteVarint(&Replay->Stream, RP_ZigZag((i32)(Mouse[i] - Replay->Mouse[i])));
+        }
+    }
+
+    Replay->Mouse[0] = Mouse[0];
+    Replay->Mouse[1] = Mouse[1];
+    Replay->Mouse[2] = Mouse[2];
+    Replay->Tick++;
+    Replay->Header.TickCount = Replay->Tick;
+}
+
+b32 RP_SaveReplay(replay *Replay, char *Filename)
+{
+    Assert(Replay->Recording);
+
+    FILE *File = fopen(Filename, "wb");
+    if(!File)
+    {
+        printf("Could not write replay file: %s\n", Filename);
+        return false;
+    }
+
+    Replay->Header.StreamSize = Replay->Stream.Size;
+    b32 Result = fwrite(&Replay->Header, sizeof(Replay->Header), 1, File) == 1;
+    if(Replay->Stream.Size)
+    {
+        Result = Result && fwrite(Replay->Stream.Data, Replay->Stream.Size, 1, File) == 1;
+    }
+    if(Replay->Header.KeyframeCount)
+    {
+        Result = Result && fwrite(Replay->Keyframes, sizeof(replay_keyframe) * Replay->Header.KeyframeCount, 1, File) == 1;
+    }
+    fclose(File);
+
+    if(!Result)
+    {
+        printf("Could not write replay file: %s\n", Filename);
+    }
+
+    return Result;
+}
+
+// ------ Playback
+
+// Returns NULL and prints the reason when the file can not be used
+replay *RP_LoadReplay(char *Filename)
+{
+    FILE *File = fopen(Filename, "rb");
+    if(!File)
+    {
+        printf("Could not open replay file: %s\n", Filename);
+        return NULL;
+    }
+
+    replay_header Header = {};
+    if(fread(&Header, sizeof(Header), 1, File) != 1 || Header.Magic != REPLAY_MAGIC)
+    {
+        printf("Not a replay file: %s\n", Filename);
+        fclose(File);
+        return NULL;
+    }
+    if(Header.Version != REPLAY_VERSION || Header.TickRate <= 0.0 || Header.KeyframeInterval == 0 || Header.Seed == 0)
+    {
+        printf("Unsupported replay file: %s\n", Filename);
+        fclose(File);
+        return NULL;
+    }
+
+    replay *Result = (replay*)Malloc(sizeof(replay)); Assert(Result);
+    *Result = {};
+    Result->Header = Header;
+
+    Result->Stream.Size = Result->Stream.Capacity = Header.StreamSize;
+    Result->Stream.Data = (u8*)Malloc(Header.StreamSize ? Header.StreamSize : 1); Assert(Result->Stream.Data);
+    Result->KeyframeCapacity = Header.KeyframeCount;
+    Result->Keyframes = (replay_keyframe*)Malloc(sizeof(replay_keyframe) * (Header.KeyframeCount ? Header.KeyframeCount : 1)); Assert(Result->Keyframes);
+
+    b32 Read = (!Header.StreamSize || fread(Result->Stream.Data, Header.StreamSize, 1, File) == 1) &&
+               (!Header.KeyframeCount || fread(Result->Keyframes, sizeof(replay_keyframe) * Header.KeyframeCount, 1, File) == 1);
+    fclose(File);
+
+    for(u32 i = 0; Read && i < Header.KeyframeCount; i++)
+    {
+        Read = Result->Keyframes[i].Offset < Header.StreamSize && Result->Keyframes[i].Tick < Header.TickCount &&
+               (i == 0 || Result->Keyframes[i].Tick > Result->Keyframes[i - 1].Tick);
+    }
+
+    if(!Read)
+    {
+        printf("Replay file is truncated or corrupt: %s\n", Filename);
+        Free(Result->Stream.Data);
+        Free(Result->Keyframes);
+        Free(Result);
+        return NULL;
+    }
+
+    return Result;
+}
+
+// Decodes the input of the next tick, applies GameReset when the
+// recording did and checks the game state against the keyframes.
+// Returns false once every tick was played.
+b32 RP_PlayTick(replay *Replay, game_input *Input, b32 *Reset)
+{
+    Assert(!Replay->Recording);
+
+    if(Replay->Tick >= Replay->Header.TickCount || Replay->Offset >= Replay->Stream.Size)
+    {
+        return false;
+    }
+
+    u8 Flags = RP_ReadU8(Replay);
+    i32 MoveX = (Flags & ReplayTick_MoveXMask);
+    i32 MoveY = (Flags & ReplayTick_MoveYMask) >> ReplayTick_MoveYShift;
+    Input->Move = glm::vec2((f32)(MoveX - 1), (f32)(MoveY - 1));
+    Input->Fire = (Flags & ReplayTick_Fire) != 0;
+    *Reset = (Flags & ReplayTick_Reset) != 0;
+
+    if(Flags & ReplayTick_Keyframe)
+    {
+        Replay->Mouse[0] = RP_ReadU32(Replay);
+        Replay->Mouse[1] = RP_ReadU32(Replay);
+        Replay->Mouse[2] = RP_ReadU32(Replay);
+        u32 StateSize = RP_ReadU32(Replay);
+
+        if(Replay->RestoreKeyframe)
+        {
+            // Seeking, the snapshot was taken after the reset so it
+            // does not have to be applied again
+            Replay->RestoreKeyframe = false;
+            RP_ReadGameState(Replay);
+        }
+        else
+        {
+            if(*Reset) { GameReset(); }
+
+            // The live game has to match the recorded one, a mismatch
+            // means the simulation is not deterministic anymore
+            Replay->Scratch.Size = 0;
+            RP_WriteGameState(&Replay->Scratch);
+            if(!Replay->Desynced &&
+               (StateSize != Replay->Scratch.Size || Replay->Offset + StateSize > Replay->Stream.Size ||
+                memcmp(Replay->Stream.Data + Replay->Offset, Replay->Scratch.Data, StateSize) != 0))
+            {
+                printf("Replay desync at tick %u\n", Replay->Tick);
+                Replay->Desynced = true;
+            }
+            Replay->Offset += StateSize;
+        }
+    }
+    else
+    {
+        if(*Reset) { GameReset(); }
+
+        if(Flags & ReplayTick_MouseChanged)
+        {
+            for(u32 i = 0; i < 3; i++)
+            {
+                Replay->Mouse[i] += (u32)RP_UnZigZag(RP_ReadVarint(Replay));
+            }
+        }
+    }
+
+    memcpy(&Input->MouseWorldPosition, Replay->Mouse, sizeof(u32) * 3);
+    Replay->Tick++;
+
+    return true;
+}
+
+// Restores the game state of the last keyframe at or before Tick and
+// simulates from there up to Tick, at full speed and without events
+void RP_Seek(replay *Replay, u32 Tick)
+{
+    Assert(!Replay->Recording);
+
+    if(Replay->Header.KeyframeCount == 0)
+    {
+        return;
+    }
+    if(Tick > Replay->Header.TickCount)
+    {
+        Tick = Replay->Header.TickCount;
+    }
+
+    // Last keyframe with Keyframe.Tick <= Tick
+    u32 Low = 0;
+    u32 High = Replay->Header.KeyframeCount;
+    while(High - Low > 1)
+    {
+        u32 Middle = (Low + High) / 2;
+        if(Replay->Keyframes[Middle].Tick <= Tick) { Low = Middle; }
+        else                                        { High = Middle; }
+    }
+
+    Replay->Offset = Replay->Keyframes[Low].Offset;
+    Replay->Tick = Replay->Keyframes[Low].Tick;
+    Replay->RestoreKeyframe = true;
+
+    f32 TimeStep = (f32)(1.0 / Replay->Header.TickRate);
+    game_input Input = {};
+    while(Replay->Tick < Tick)
+    {
+        b32 Reset;
+        if(!RP_PlayTick(Replay, &Input, &Reset)) { break; }
+
+        game_events Events = {};
+        SimulateGameTick(&Input, &Events, TimeStep);
+    }
+}
+
+// Makes the game use the settings the replay was recorded with, call
+// before GameBegin and before the clock is created
+void RP_ApplySettings(replay *Replay)
+{
+    RandomSeed(Replay->Header.Seed);
+    SimulationTickRate = Replay->Header.TickRate;
+    EnemySpawnsPerSecond = Replay->Header.EnemySpawnsPerSecond;
+}
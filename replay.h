@@ -0,0 +1,78 @@
+#pragma once
+
+#include "shared.h"
+#include "game.h"
+
+/*
+  Replay file layout, all values little endian
+
+    replay_header
+    Stream           TickCount tick records, see RP_RecordTick
+    Keyframe table   KeyframeCount replay_keyframe, used to seek
+
+  Every tick record starts with a flags byte. The mouse position is
+  stored as the difference of its float bit pattern with the previous
+  tick, zigzag and varint encoded, and skipped when it did not change.
+  Every KeyframeInterval ticks the record also carries the absolute
+  mouse position and a snapshot of the game state, so playback can
+  start decoding and simulating from there.
+*/
+
+#define REPLAY_MAGIC 0x50524C47 // "GLRP"
+#define REPLAY_VERSION 1
+
+enum replay_tick_flags
+{
+    ReplayTick_MoveXMask    = 0x03, // Move.x + 1
+    ReplayTick_MoveYShift   = 2,
+    ReplayTick_MoveYMask    = 0x0C, // Move.y + 1
+    ReplayTick_Fire         = 0x10,
+    ReplayTick_Reset        = 0x20, // GameReset was called before this tick
+    ReplayTick_MouseChanged = 0x40,
+    ReplayTick_Keyframe     = 0x80,
+};
+
+struct replay_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 Seed;
+    u32 KeyframeInterval;
+    f64 TickRate;
+    f32 EnemySpawnsPerSecond;
+    u32 TickCount;
+    u32 KeyframeCount;
+    u32 StreamSize;
+};
+
+struct replay_keyframe
+{
+    u32 Tick;
+    u32 Offset; // Of the tick record inside the stream
+};
+
+struct replay_buffer
+{
+    u8 *Data;
+    u32 Size;
+    u32 Capacity;
+};
+
+struct replay
+{
+    b32 Recording; // Otherwise playing back
+    replay_header Header;
+
+    replay_buffer Stream;
+    u32 Offset; // Read position while playing
+
+    replay_keyframe *Keyframes;
+    u32 KeyframeCapacity;
+
+    u32 Tick; // Next tick to record or play
+    u32 Mouse[3]; // Bit patterns of the previous MouseWorldPosition, the delta base
+
+    b32 RestoreKeyframe; // Set by RP_Seek, the next keyframe replaces the game state
+    b32 Desynced;
+    replay_buffer Scratch; // Snapshot of the live game state, compared against the keyframes
+};
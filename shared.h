@@ -43,6 +43,8 @@ typedef i32      b32;
 #define Assert(Expr) assert(Expr)
 #define InvalidCodePath Assert(!"InvalidCodePath")
 
+#define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
+
 #define Kilobytes(Expr) ((Expr) * 1024)
 #define Megabytes(Expr) (Kilobytes(Expr) * 1024)
 #define Gigabytes(Expr) (Megabytes(Expr) * 1024)
@@ -63,12 +65,28 @@ void *Malloc(size_t Size)
     return calloc(1, Size);
 }
 
+void *Realloc(void *Ptr, size_t Size)
+{
+    // Grows or shrinks an allocation made with Malloc, the allocation
+    // count does not change. Unlike Malloc the grown tail is not
+    // zeroed, callers initialise it themselves, like E_PushEntity
+    // does for the slots
+    if(Ptr == NULL)
+    {
+        return Malloc(Size);
+    }
+
+    return realloc(Ptr, Size);
+}
+
 void Free(void *Ptr)
 {
     AllocationCount -= 1;
     free(Ptr);
 }
 
+// The headless build does not link SDL
+#ifndef GLOW_HEADLESS
 char *ReadTextFile(char *Filename)
 {
     // IMPORTANT(Jorge): The caller of this function needs to free the allocated pointer!
@@ -103,6 +121,49 @@ char *ReadTextFile(char *Filename)
 
     return Result;
 }
+#endif
+
+// Decodes the UTF-8 sequence at *Text and moves *Text past it. A
+// malformed or truncated sequence decodes to U+FFFD and skips one byte
+u32 DecodeUTF8(u8 **Text)
+{
+    u8 *Ptr = *Text;
+    u32 Result = 0xFFFD;
+    u32 Length = 1;
+
+    if(Ptr[0] < 0x80)
+    {
+        Result = Ptr[0];
+    }
+    else
+    {
+        u32 Minimum = 0;
+        if((Ptr[0] & 0xE0) == 0xC0)      { Length = 2; Result = Ptr[0] & 0x1F; Minimum = 0x80; }
+        else if((Ptr[0] & 0xF0) == 0xE0) { Length = 3; Result = Ptr[0] & 0x0F; Minimum = 0x800; }
+        else if((Ptr[0] & 0xF8) == 0xF0) { Length = 4; Result = Ptr[0] & 0x07; Minimum = 0x10000; }
+        else                             { Length = 0; }
+
+        for(u32 i = 1; i < Length; i++)
+        {
+            if((Ptr[i] & 0xC0) != 0x80)
+            {
+                Length = 0; // Also stops at the terminating zero
+                break;
+            }
+            Result = (Result << 6) | (Ptr[i] & 0x3F);
+        }
+
+        // Overlong encodings, surrogates and values past U+10FFFF are errors too
+        if(Length == 0 || Result < Minimum || Result > 0x10FFFF || (Result >= 0xD800 && Result <= 0xDFFF))
+        {
+            Result = 0xFFFD;
+            Length = 1;
+        }
+    }
+
+    *Text = Ptr + Length;
+    return Result;
+}
 
 f32 Normalize(f32 Input, f32 Minimum, f32 Maximum)
 {
@@ -174,10 +235,52 @@ b32 Equals(f32 A, f32 B)
     return Result;
 }
 
-inline f32
-GetDirectionAngle(f32 Y, f32 X)
+// Rotations are stored as a unit complex number, x = cos(Angle) and
+// y = sin(Angle), so rotating a point is two multiply-adds and the
+// trig only runs when an angle is converted
+global glm::vec2 RotationIdentity = glm::vec2(1.0f, 0.0f);
+
+inline glm::vec2
+RotationFromAngle(f32 Degrees)
+{
+    f32 Radians = glm::radians(Degrees);
+    return glm::vec2(cosf(Radians), sinf(Radians));
+}
+
+// Rotation facing along Direction, no trig needed
+inline glm::vec2
+RotationFromDirection(glm::vec2 Direction)
+{
+    f32 LengthSquared = glm::dot(Direction, Direction);
+    if(LengthSquared <= 0.0f)
+    {
+        return RotationIdentity;
+    }
+    return Direction * (1.0f / sqrtf(LengthSquared));
+}
+
+inline glm::vec2
+Rotate(glm::vec2 Point, glm::vec2 Rotation)
+{
+    return glm::vec2(Point.x * Rotation.x - Point.y * Rotation.y,
+                     Point.x * Rotation.y + Point.y * Rotation.x);
+}
+
+// Composes two rotations, one newton step keeps the result unit length
+// so repeated composition does not drift
+inline glm::vec2
+RotationMultiply(glm::vec2 A, glm::vec2 B)
+{
+    glm::vec2 Result = Rotate(A, B);
+    return Result * (0.5f * (3.0f - glm::dot(Result, Result)));
+}
+
+// Normalized lerp, close enough to a slerp for the small steps
+// between two simulation ticks
+inline glm::vec2
+RotationLerp(glm::vec2 A, glm::vec2 B, f32 t)
 {
-    return (((f32)atan2(Y, X) * (f32)180.0f) / 3.14159265359f) + 180.0f;
+    return RotationFromDirection(A * (1.0f - t) + B * t);
 }
 
 // http://sol.gfxile.net/interpolation/, this site has a nice tutorial covering animation curves
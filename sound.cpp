@@ -53,7 +53,9 @@ sound_system *S_CreateSoundSystem()
     // }
 
     //Initialize SDL_mixer
-    if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+    // The format archive sounds are cooked in, the device may still
+    // open with another one, see S_CreateSoundEffect
+    if(Mix_OpenAudio(ARCHIVE_SOUND_FREQUENCY, MIX_DEFAULT_FORMAT, ARCHIVE_SOUND_CHANNELS, 2048) < 0)
     {
         printf( "SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError() );
         Free(Result);
@@ -83,6 +85,65 @@ sound_effect *S_CreateSoundEffect(char *Filename)
     return (Result);
 }
 
+// Archive sounds are cooked in the format S_CreateSoundSystem asks
+// for, the chunk plays the samples straight from the mapping, which has
+// to stay mapped. Mix_OpenAudio may settle on another rate, channel
+// count or sample format, then the samples are converted once into a
+// buffer that lives as long as the chunk
+sound_effect *S_CreateSoundEffect(asset_handle Asset)
+{
+    if(!Asset.Entry || Asset.Entry->Type != ArchiveEntry_Sound)
+    {
+        printf("Archive sound effect failed to load\n");
+        return NULL;
+    }
+
+    i32 Frequency, ChannelCount;
+    u16 Format;
+    if(!Mix_QuerySpec(&Frequency, &Format, &ChannelCount))
+    {
+        printf("Sound Effect %s failed to load: %s\n", Asset.Entry->Name, Mix_GetError());
+        return NULL;
+    }
+
+    SDL_AudioCVT Convert;
+    i32 NeedsConversion = SDL_BuildAudioCVT(&Convert, AUDIO_S16LSB, ARCHIVE_SOUND_CHANNELS, ARCHIVE_SOUND_FREQUENCY, Format, (u8)ChannelCount, Frequency);
+    if(NeedsConversion < 0)
+    {
+        printf("Sound Effect %s can not be converted to the device format: %s\n", Asset.Entry->Name, SDL_GetError());
+        return NULL;
+    }
+
+    u8 *Samples = Asset.Data;
+    u32 Size = (u32)Asset.Entry->Size;
+    if(NeedsConversion)
+    {
+        Convert.len = (i32)Size;
+        Convert.buf = (u8*)Malloc((size_t)Size * Convert.len_mult); Assert(Convert.buf);
+        memcpy(Convert.buf, Asset.Data, Size);
+        if(SDL_ConvertAudio(&Convert) < 0)
+        {
+            printf("Sound Effect %s can not be converted to the device format: %s\n", Asset.Entry->Name, SDL_GetError());
+            Free(Convert.buf);
+            return NULL;
+        }
+        Samples = Convert.buf;
+        Size = (u32)Convert.len_cvt;
+    }
+
+    sound_effect *Result = Mix_QuickLoad_RAW(Samples, Size);
+    if(Result == NULL)
+    {
+        printf("Sound Effect %s failed to load\n", Asset.Entry->Name);
+        if(NeedsConversion)
+        {
+            Free(Samples);
+        }
+    }
+
+    return (Result);
+}
+
 sound_music *S_CreateMusic(char *Filename)
 {
     Assert(Filename);
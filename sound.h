@@ -1,6 +1,7 @@
 #pragma once
 
 #include "shared.h"
+#include "archive.h"
 
 typedef Mix_Music sound_music;
 typedef Mix_Chunk sound_effect;